@@ -1,50 +1,49 @@
-// based on https://github.com/PaulStoffregen/Time/blob/master/examples/TimeNTP_ESP8266WiFi/TimeNTP_ESP8266WiFi.ino
 #pragma once
 
-#include <NTPClient.h>
-#include "time-common.h"
+#include <Arduino.h>
+#include <esp_sntp.h>
+#include <sys/time.h>
 
-#include <memory>
+#include "metrics.h"
+#include "time-common.h"
 
 namespace ntp {
 
-WiFiUDP ntpUDP;
-
-std::unique_ptr<NTPClient> setupNTP() {
-    auto timeClient = std::make_unique<NTPClient>(ntpUDP);
-
-    Serial.println("Setting up ntp client");
-    timeClient->setUpdateInterval(1000 * 60 * 30);
-    timeClient->begin();
-    timeClient->setTimeOffset(0);
-
-    const int num_tries = 5;
-    for (int i = 0; i < num_tries && !timeClient->update(); i++) {
-        timeClient->forceUpdate();
-        delay(1000);
-    }
-
-    Serial.println("Current time: ");
-    Serial.println(timeClient->getFormattedTime());
-
-    return std::move(timeClient);
+/*******************************
+ * NTP
+ *
+ * Uses the ESP-IDF SNTP client, which syncs on its own (lwIP) task, so
+ * nothing here blocks boot or a loop. Each completed sync updates the time
+ * service's epoch mapping; until the first one readings are stamped with time
+ * since boot.
+ *******************************/
+const char *const NTP_SERVER = "pool.ntp.org";
+const uint32_t NTP_SYNC_INTERVAL_MS = 1000 * 60 * 30;
+
+static void onTimeSync(struct timeval *tv) {
+    const uint64_t epochMS = (uint64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000;
+    buff::buff_time::timeService.setEpoch(epochMS, buff::buff_time::monotonicMS());
+
+    Serial.print("Time synced, epoch=");
+    Serial.println((unsigned long)tv->tv_sec);
 }
 
-void loopNTP(std::shared_ptr<NTPClient> timeClient) {
-    // this will trigger a time refresh if needed
-    // WARNING: this is sync and blocking
-    timeClient->update();
+static void setupNTP() {
+    Serial.println("Setting up sntp");
+    sntp_set_time_sync_notification_cb(onTimeSync);
+    sntp_set_sync_interval(NTP_SYNC_INTERVAL_MS);
+    // starts the client and returns straight away
+    configTime(0, 0, NTP_SERVER);
 }
 
-class NTPTimeWrapper : public buff::buff_time::TimeWrapper {
-   private:
-    const std::shared_ptr<NTPClient> _timeClient;
-
-   public:
-    NTPTimeWrapper(std::shared_ptr<NTPClient> timeClient): _timeClient(timeClient) {}
-    virtual unsigned long getAdjustedTimeSeconds() {
-        return _timeClient->getEpochTime();
-    }
-};
+/*******************************
+ * Metrics
+ *******************************/
+inline richiev::metrics::CallbackGauge timeSynced("buff_time_synced", "Whether the clock has been synced since boot", []() -> int32_t { return buff::buff_time::timeService.synced() ? 1 : 0; });
+inline richiev::metrics::CallbackCounter timeSyncs("buff_time_syncs_total", "Completed time syncs", []() -> uint32_t { return buff::buff_time::timeService.syncs(); });
+inline richiev::metrics::CallbackGauge timeSinceSync("buff_time_since_sync_seconds", "Time since the clock was last synced", []() -> int32_t {
+    auto &service = buff::buff_time::timeService;
+    return service.msSinceSync(service.monotonicMS()) / 1000;
+});
 
 }  // namespace ntp
@@ -2,14 +2,118 @@
 
 #include <Arduino.h>
 
+#include <atomic>
+#include <cstdint>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_timer.h>
+#endif
+
 namespace buff {
 namespace buff_time {
+
+/*******************************
+ * Monotonic clock
+ *
+ * millis() wraps every ~49 days, which reorders anything compared or sorted
+ * by it on a long running unit. This is a 64 bit millisecond count since
+ * boot that never wraps or goes backwards.
+ *******************************/
+
+// Extends a wrapping 32 bit millis() reading to 64 bits. Needs to see a
+// reading at least every ~24 days to notice the wraps, which anything on a
+// scheduled job does. Safe to call from any task.
+class WrapExtender {
+   private:
+    std::atomic<uint64_t> _last{0};
+
+   public:
+    uint64_t extend(const uint32_t nowMS) {
+        uint64_t last = _last.load(std::memory_order_relaxed);
+        while (true) {
+            const uint32_t delta = nowMS - (uint32_t)last;
+            // another task got a later reading in first, don't go backwards
+            if ((int32_t)delta < 0) return last;
+
+            const uint64_t extended = last + delta;
+            if (_last.compare_exchange_weak(last, extended, std::memory_order_relaxed)) return extended;
+        }
+    }
+};
+
+inline uint64_t monotonicMS() {
+#ifdef ARDUINO_ARCH_ESP32
+    // already 64 bit, in microseconds since boot
+    return esp_timer_get_time() / 1000;
+#else
+    static WrapExtender extender;
+    return extender.extend(millis());
+#endif
+}
+
+/*******************************
+ * Time service
+ *
+ * The monotonic clock, plus a mapping from it to epoch time that's updated in
+ * the background whenever a time sync (eg SNTP) completes. Reading the time
+ * never blocks or touches the network.
+ *
+ * Until the first sync, epoch time is just time since boot (as NTPClient
+ * used to report).
+ *******************************/
+class TimeService {
+   private:
+    // epoch ms - monotonic ms, as of the last sync
+    std::atomic<int64_t> _epochOffsetMS{0};
+    std::atomic<uint64_t> _lastSyncMonotonicMS{0};
+    std::atomic<bool> _synced{false};
+    std::atomic<uint32_t> _syncs{0};
+
+   public:
+    uint64_t monotonicMS() const { return buff_time::monotonicMS(); }
+
+    // Called from whatever did the sync, with the epoch time as of atMonotonicMS
+    void setEpoch(const uint64_t epochMS, const uint64_t atMonotonicMS) {
+        _epochOffsetMS.store((int64_t)(epochMS - atMonotonicMS), std::memory_order_relaxed);
+        _lastSyncMonotonicMS.store(atMonotonicMS, std::memory_order_relaxed);
+        _syncs.fetch_add(1, std::memory_order_relaxed);
+        _synced.store(true, std::memory_order_release);
+    }
+
+    bool synced() const { return _synced.load(std::memory_order_acquire); }
+    uint32_t syncs() const { return _syncs.load(std::memory_order_relaxed); }
+
+    // 0 if never synced
+    uint64_t msSinceSync(const uint64_t atMonotonicMS) const {
+        return synced() ? atMonotonicMS - _lastSyncMonotonicMS.load(std::memory_order_relaxed) : 0;
+    }
+
+    uint64_t epochMSAt(const uint64_t atMonotonicMS) const {
+        if (!synced()) return atMonotonicMS;
+        return atMonotonicMS + _epochOffsetMS.load(std::memory_order_relaxed);
+    }
+
+    uint64_t epochMS() const { return epochMSAt(monotonicMS()); }
+    unsigned long epochSeconds() const { return epochMS() / 1000; }
+};
+
+inline TimeService timeService;
+
+// What readings are stamped with. A view over the time service; default
+// constructed (eg in tests) it has no service and just reports millis().
 class TimeWrapper {
-    public:
+   private:
+    const TimeService *_service = nullptr;
+
+   public:
+    TimeWrapper() {}
+    explicit TimeWrapper(const TimeService &service) : _service(&service) {}
+
     virtual unsigned long getAdjustedTimeSeconds() {
-        return millis();
+        if (_service == nullptr) return millis();
+        return _service->epochSeconds();
     }
 };
 
-}
+}  // namespace buff_time
 }  // namespace buff
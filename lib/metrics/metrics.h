@@ -0,0 +1,307 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/*******************************
+ * Lightweight instrumentation registry, rendered in the Prometheus text
+ * exposition format (https://prometheus.io/docs/instrumenting/exposition_formats/)
+ *
+ * Metrics are meant to be statically allocated globals. They register
+ * themselves on construction, and recording a value is a couple of relaxed
+ * atomic adds, so they're safe to use on hot paths and across tasks.
+ *******************************/
+namespace richiev {
+namespace metrics {
+
+const size_t MAX_METRICS = 96;
+const size_t MAX_HISTOGRAM_BUCKETS = 12;
+
+// Bucket upper bounds, in micros
+const uint32_t FAST_BUCKETS_US[] = {50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000, 500000, 1000000};
+const uint32_t SLOW_BUCKETS_US[] = {100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 30000000, 60000000, 120000000, 300000000};
+
+enum MetricType {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+static const char* metricTypeName(const MetricType type) {
+    switch (type) {
+        case COUNTER:
+            return "counter";
+        case GAUGE:
+            return "gauge";
+        default:
+            return "histogram";
+    }
+}
+
+class Metric;
+
+class Registry {
+   private:
+    Metric* _metrics[MAX_METRICS] = {};
+    size_t _size = 0;
+
+   public:
+    bool add(Metric* metric) {
+        // metrics are statics, so running out is a build mistake, and
+        // they'd otherwise silently go missing from /metrics: raise MAX_METRICS
+        assert(_size < MAX_METRICS);
+        if (_size >= MAX_METRICS) return false;
+        _metrics[_size++] = metric;
+        return true;
+    }
+
+    void remove(Metric* metric) {
+        for (size_t i = 0; i < _size; i++) {
+            if (_metrics[i] == metric) {
+                _metrics[i] = _metrics[--_size];
+                return;
+            }
+        }
+    }
+
+    size_t size() const { return _size; }
+
+    inline void render(std::string& out) const;
+};
+
+inline Registry& registry() {
+    static Registry globalRegistry;
+    return globalRegistry;
+}
+
+class Metric {
+   public:
+    const char* const name;
+    const char* const help;
+    // Prometheus label pairs, eg: doser="fill"
+    const char* const labels;
+
+    Metric(const char* n, const char* h, const char* l) : name(n), help(h), labels(l) {
+        registry().add(this);
+    }
+
+    Metric(const Metric&) = delete;
+    Metric& operator=(const Metric&) = delete;
+
+    virtual ~Metric() {
+        registry().remove(this);
+    }
+
+    virtual MetricType type() const = 0;
+    virtual void render(std::string& out) const = 0;
+
+   protected:
+    void renderSample(std::string& out, const char* suffix, const char* extraLabel, const char* value) const {
+        out += name;
+        out += suffix;
+        const bool hasLabels = labels != nullptr && labels[0] != 0;
+        if (hasLabels || extraLabel != nullptr) {
+            out += '{';
+            if (hasLabels) out += labels;
+            if (hasLabels && extraLabel != nullptr) out += ',';
+            if (extraLabel != nullptr) out += extraLabel;
+            out += '}';
+        }
+        out += ' ';
+        out += value;
+        out += '\n';
+    }
+};
+
+class Counter : public Metric {
+   private:
+    std::atomic<uint32_t> _value{0};
+
+   public:
+    Counter(const char* name, const char* help, const char* labels = nullptr) : Metric(name, help, labels) {}
+
+    void increment(const uint32_t by = 1) { _value.fetch_add(by, std::memory_order_relaxed); }
+    uint32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+    MetricType type() const { return COUNTER; }
+
+    void render(std::string& out) const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u", (unsigned int)value());
+        renderSample(out, "", nullptr, buf);
+    }
+};
+
+class Gauge : public Metric {
+   private:
+    std::atomic<int32_t> _value{0};
+
+   public:
+    Gauge(const char* name, const char* help, const char* labels = nullptr) : Metric(name, help, labels) {}
+
+    void set(const int32_t v) { _value.store(v, std::memory_order_relaxed); }
+    void add(const int32_t by) { _value.fetch_add(by, std::memory_order_relaxed); }
+    int32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+    MetricType type() const { return GAUGE; }
+
+    void render(std::string& out) const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%d", (int)value());
+        renderSample(out, "", nullptr, buf);
+    }
+};
+
+// A gauge whose value is only computed when scraped, eg free heap
+class CallbackGauge : public Metric {
+   public:
+    using ValueFunctionPtr = int32_t (*)();
+
+   private:
+    const ValueFunctionPtr _valueFunc;
+
+   public:
+    CallbackGauge(const char* name, const char* help, ValueFunctionPtr valueFunc, const char* labels = nullptr) : Metric(name, help, labels), _valueFunc(valueFunc) {}
+
+    MetricType type() const { return GAUGE; }
+
+    void render(std::string& out) const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%d", (int)_valueFunc());
+        renderSample(out, "", nullptr, buf);
+    }
+};
+
+// A counter owned by something else (eg a queue's stats), read when scraped
+class CallbackCounter : public Metric {
+   public:
+    using ValueFunctionPtr = uint32_t (*)();
+
+   private:
+    const ValueFunctionPtr _valueFunc;
+
+   public:
+    CallbackCounter(const char* name, const char* help, ValueFunctionPtr valueFunc, const char* labels = nullptr) : Metric(name, help, labels), _valueFunc(valueFunc) {}
+
+    MetricType type() const { return COUNTER; }
+
+    void render(std::string& out) const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u", (unsigned int)_valueFunc());
+        renderSample(out, "", nullptr, buf);
+    }
+};
+
+// Fixed bucket histogram. Values are observed as integers (eg micros), and
+// rendered multiplied by renderScale (eg 1e-6 to report seconds).
+class Histogram : public Metric {
+   private:
+    const uint32_t* const _bounds;
+    const size_t _boundCount;
+    const double _renderScale;
+
+    // +1 for the +Inf bucket
+    std::atomic<uint32_t> _bucketCounts[MAX_HISTOGRAM_BUCKETS + 1] = {};
+    std::atomic<uint64_t> _sum{0};
+
+   public:
+    template <size_t N>
+    Histogram(const char* name, const char* help, const uint32_t (&bounds)[N], const char* labels = nullptr, const double renderScale = 1e-6) : Metric(name, help, labels), _bounds(bounds), _boundCount(N), _renderScale(renderScale) {
+        static_assert(N <= MAX_HISTOGRAM_BUCKETS, "too many histogram buckets");
+    }
+
+    void observe(const uint32_t value) {
+        size_t i = 0;
+        while (i < _boundCount && value > _bounds[i]) {
+            i++;
+        }
+        _bucketCounts[i].fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint32_t count() const {
+        uint32_t total = 0;
+        for (size_t i = 0; i <= _boundCount; i++) {
+            total += _bucketCounts[i].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+
+    MetricType type() const { return HISTOGRAM; }
+
+    void render(std::string& out) const {
+        char value[24];
+        char le[32];
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i <= _boundCount; i++) {
+            cumulative += _bucketCounts[i].load(std::memory_order_relaxed);
+            if (i < _boundCount) {
+                snprintf(le, sizeof(le), "le=\"%g\"", _bounds[i] * _renderScale);
+            } else {
+                snprintf(le, sizeof(le), "le=\"+Inf\"");
+            }
+            snprintf(value, sizeof(value), "%u", (unsigned int)cumulative);
+            renderSample(out, "_bucket", le, value);
+        }
+
+        snprintf(value, sizeof(value), "%g", sum() * _renderScale);
+        renderSample(out, "_sum", nullptr, value);
+        snprintf(value, sizeof(value), "%u", (unsigned int)cumulative);
+        renderSample(out, "_count", nullptr, value);
+    }
+};
+
+// Observes the micros spent in its scope into the given histogram (if any)
+class ScopedTimer {
+   private:
+    Histogram* const _histogram;
+    const unsigned long _startUS;
+
+   public:
+    ScopedTimer(Histogram& histogram) : _histogram(&histogram), _startUS(micros()) {}
+    ScopedTimer(Histogram* histogram) : _histogram(histogram), _startUS(micros()) {}
+
+    ~ScopedTimer() {
+        if (_histogram != nullptr) {
+            _histogram->observe(micros() - _startUS);
+        }
+    }
+};
+
+void Registry::render(std::string& out) const {
+    for (size_t i = 0; i < _size; i++) {
+        // metrics sharing a name are a single family, render them together
+        bool alreadyRendered = false;
+        for (size_t j = 0; j < i && !alreadyRendered; j++) {
+            alreadyRendered = strcmp(_metrics[j]->name, _metrics[i]->name) == 0;
+        }
+        if (alreadyRendered) continue;
+
+        out += "# HELP ";
+        out += _metrics[i]->name;
+        out += ' ';
+        out += _metrics[i]->help;
+        out += "\n# TYPE ";
+        out += _metrics[i]->name;
+        out += ' ';
+        out += metricTypeName(_metrics[i]->type());
+        out += '\n';
+
+        for (size_t j = i; j < _size; j++) {
+            if (strcmp(_metrics[j]->name, _metrics[i]->name) == 0) {
+                _metrics[j]->render(out);
+            }
+        }
+    }
+}
+
+}  // namespace metrics
+}  // namespace richiev
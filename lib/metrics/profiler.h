@@ -0,0 +1,198 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "metrics.h"
+
+/*******************************
+ * Profiler
+ *
+ * Always-on timing of the top level subsystems. Each run is timed with the
+ * CPU cycle counter (a register read, no syscalls), observed into the
+ * section's histogram, and when it's the slowest run seen so far the section
+ * also captures when it happened and what was going on (eg the measurement
+ * step), so stalls can be tracked down after the fact.
+ *
+ * The hot path is a couple of counter reads and relaxed atomic adds; the
+ * lock is only taken when a new worst case is captured.
+ *******************************/
+namespace richiev {
+namespace metrics {
+
+const size_t MAX_PROFILED_SECTIONS = 16;
+const size_t PROFILE_CONTEXT_LEN = 40;
+
+inline uint32_t cycleCount() {
+#ifdef ARDUINO_ARCH_ESP32
+    return ESP.getCycleCount();
+#else
+    return micros();
+#endif
+}
+
+inline uint32_t cyclesPerMicro() {
+#ifdef ARDUINO_ARCH_ESP32
+    static const uint32_t cpm = ESP.getCpuFreqMHz();
+    return cpm;
+#else
+    return 1;
+#endif
+}
+
+// Describes what's going on right now (eg "MEASURE/DOSE_REAGENT"), for worst case captures
+using ProfileContextFunc = void (*)(char* out, size_t size);
+
+inline ProfileContextFunc& profileContext() {
+    static ProfileContextFunc contextFunc = nullptr;
+    return contextFunc;
+}
+
+struct WorstCase {
+    uint32_t durationUS = 0;
+    unsigned long atMS = 0;
+    char context[PROFILE_CONTEXT_LEN] = {0};
+};
+
+class ProfiledSection;
+
+inline ProfiledSection** profiledSections() {
+    static ProfiledSection* sections[MAX_PROFILED_SECTIONS] = {};
+    return sections;
+}
+
+inline size_t& profiledSectionCount() {
+    static size_t count = 0;
+    return count;
+}
+
+// A histogram that also remembers its worst case
+class ProfiledSection : public Histogram {
+   private:
+    std::atomic<uint32_t> _worstUS{0};
+    mutable std::mutex _worstLock;
+    WorstCase _worst;
+    // bumped on every new worst case, so reporters can tell what's new
+    std::atomic<uint32_t> _worstVersion{0};
+
+    void capture(const uint32_t durationUS) {
+        std::lock_guard<std::mutex> guard(_worstLock);
+        // lost a race with a slower run
+        if (durationUS <= _worst.durationUS) return;
+
+        _worst.durationUS = durationUS;
+        _worst.atMS = millis();
+        _worst.context[0] = 0;
+        if (profileContext() != nullptr) {
+            profileContext()(_worst.context, sizeof(_worst.context));
+        }
+        _worstUS.store(durationUS, std::memory_order_relaxed);
+        _worstVersion.fetch_add(1, std::memory_order_relaxed);
+    }
+
+   public:
+    const char* const section;
+
+    template <size_t N>
+    ProfiledSection(const char* name, const char* help, const char* sectionName, const uint32_t (&bounds)[N], const char* labels)
+        : Histogram(name, help, bounds, labels), section(sectionName) {
+        if (profiledSectionCount() < MAX_PROFILED_SECTIONS) {
+            profiledSections()[profiledSectionCount()++] = this;
+        }
+    }
+
+    void record(const uint32_t durationUS) {
+        observe(durationUS);
+        if (durationUS > _worstUS.load(std::memory_order_relaxed)) {
+            capture(durationUS);
+        }
+    }
+
+    WorstCase worst() const {
+        std::lock_guard<std::mutex> guard(_worstLock);
+        return _worst;
+    }
+
+    uint32_t worstVersion() const { return _worstVersion.load(std::memory_order_relaxed); }
+
+    void resetWorst() {
+        std::lock_guard<std::mutex> guard(_worstLock);
+        _worst = WorstCase();
+        _worstUS.store(0, std::memory_order_relaxed);
+    }
+};
+
+// Times its scope into a section. Uses the cycle counter, falling back to
+// millis for runs long enough for it to wrap (~17s at 240MHz).
+class ProfileScope {
+   private:
+    ProfiledSection& _section;
+    const uint32_t _startCycles;
+    const unsigned long _startMS;
+
+   public:
+    explicit ProfileScope(ProfiledSection& section) : _section(section), _startCycles(cycleCount()), _startMS(millis()) {}
+
+    ~ProfileScope() {
+        const uint32_t elapsedCycles = cycleCount() - _startCycles;
+        const unsigned long elapsedMS = millis() - _startMS;
+        const uint32_t wrapMS = UINT32_MAX / cyclesPerMicro() / 1000;
+        _section.record(elapsedMS < wrapMS / 2 ? elapsedCycles / cyclesPerMicro() : elapsedMS * 1000);
+    }
+};
+
+template <typename F>
+void forEachProfiledSection(F&& f) {
+    for (size_t i = 0; i < profiledSectionCount(); i++) {
+        f(*profiledSections()[i]);
+    }
+}
+
+// One line per section, eg:
+// web count=1234 mean_us=310 worst_us=48211 worst_at_ms=3600123 context=MEASURE/DOSE_REAGENT
+inline void renderProfileReport(std::string& out) {
+    forEachProfiledSection([&out](const ProfiledSection& section) {
+        const uint32_t count = section.count();
+        const WorstCase worst = section.worst();
+        char line[160];
+        snprintf(line, sizeof(line), "%s count=%u mean_us=%u worst_us=%u worst_at_ms=%lu context=%s\n",
+                 section.section, (unsigned int)count, (unsigned int)(count > 0 ? section.sum() / count : 0),
+                 (unsigned int)worst.durationUS, worst.atMS, worst.context[0] != 0 ? worst.context : "-");
+        out += line;
+    });
+}
+
+inline uint32_t* seenStallVersions() {
+    static uint32_t versions[MAX_PROFILED_SECTIONS] = {};
+    return versions;
+}
+
+// Calls f(section, worst) for each section with a new worst case over thresholdUS
+// since the last call. Only call from one task.
+template <typename F>
+void forEachNewStall(const uint32_t thresholdUS, F&& f) {
+    uint32_t* seenVersions = seenStallVersions();
+    for (size_t i = 0; i < profiledSectionCount(); i++) {
+        const ProfiledSection& section = *profiledSections()[i];
+        const uint32_t version = section.worstVersion();
+        if (version == seenVersions[i]) continue;
+
+        seenVersions[i] = version;
+        const WorstCase worst = section.worst();
+        if (worst.durationUS >= thresholdUS) {
+            f(section, worst);
+        }
+    }
+}
+
+inline void resetProfileWorstCases() {
+    forEachProfiledSection([](ProfiledSection& section) { section.resetWorst(); });
+}
+
+}  // namespace metrics
+}  // namespace richiev
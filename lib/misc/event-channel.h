@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace richiev {
+namespace events {
+
+/*******************************
+ * Typed, synchronous publish/subscribe channel.
+ *
+ * Subscribers are called in subscription order, on the publisher's stack,
+ * with a reference to the event, so publishing never copies or encodes it.
+ * Subscribers are meant to be registered once at setup.
+ *******************************/
+template <typename T, size_t MAX_SUBSCRIBERS = 4>
+class Channel {
+   public:
+    using Subscriber = std::function<void(const T &)>;
+
+   private:
+    Subscriber _subscribers[MAX_SUBSCRIBERS];
+    size_t _subscriberCount = 0;
+
+   public:
+    bool subscribe(Subscriber subscriber) {
+        if (_subscriberCount >= MAX_SUBSCRIBERS) return false;
+        _subscribers[_subscriberCount++] = subscriber;
+        return true;
+    }
+
+    void publish(const T &event) const {
+        for (size_t i = 0; i < _subscriberCount; i++) {
+            _subscribers[i](event);
+        }
+    }
+
+    size_t subscriberCount() const { return _subscriberCount; }
+};
+
+}  // namespace events
+}  // namespace richiev
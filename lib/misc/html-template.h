@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/*******************************
+ * Compile-time parsed string templates.
+ *
+ * A template is a string literal with `{}` slots, parsed once at compile time
+ * into the literal segments between slots:
+ *
+ *   constexpr auto GREETING = RV_TEMPLATE("<b>{}</b> is {} years old");
+ *   richiev::templates::render(out, GREETING, Escaped(name), age);
+ *
+ * Passing the wrong number of values is a compile error. Values are written
+ * straight into the output string by the typed writers below, so rendering
+ * never builds intermediate strings or shares a scratch buffer.
+ *******************************/
+namespace richiev {
+namespace templates {
+
+constexpr size_t countSlots(const char *text) {
+    size_t slots = 0;
+    for (size_t i = 0; text[i] != 0; i++) {
+        if (text[i] == '{' && text[i + 1] == '}') {
+            slots++;
+            i++;
+        }
+    }
+    return slots;
+}
+
+template <size_t SLOTS>
+struct Template {
+    const char *text;
+    // segment i is the literal text before slot i, the last one trails the final slot
+    size_t segmentStart[SLOTS + 1];
+    size_t segmentLength[SLOTS + 1];
+};
+
+template <size_t SLOTS>
+constexpr Template<SLOTS> parse(const char *text) {
+    Template<SLOTS> t{text, {}, {}};
+    size_t segment = 0;
+    size_t start = 0;
+    size_t i = 0;
+    for (; text[i] != 0; i++) {
+        if (text[i] == '{' && text[i + 1] == '}') {
+            t.segmentStart[segment] = start;
+            t.segmentLength[segment] = i - start;
+            segment++;
+            i++;
+            start = i + 1;
+        }
+    }
+    t.segmentStart[segment] = start;
+    t.segmentLength[segment] = i - start;
+    return t;
+}
+
+#define RV_TEMPLATE(text) ::richiev::templates::parse<::richiev::templates::countSlots(text)>(text)
+
+/*******************************
+ * Typed values
+ *******************************/
+// Floating point value with a fixed number of decimals
+struct Fixed {
+    const double value;
+    const uint8_t decimals;
+    Fixed(const double v, const uint8_t d) : value(v), decimals(d) {}
+};
+
+// Integer zero padded to a minimum width, eg Padded(7, 2) -> "07"
+struct Padded {
+    const unsigned long value;
+    const uint8_t width;
+    Padded(const unsigned long v, const uint8_t w) : value(v), width(w) {}
+};
+
+// Seconds since epoch, rendered as UTC "YYYY-MM-DD HH:MM:SS"
+struct EpochTime {
+    const unsigned long seconds;
+    explicit EpochTime(const unsigned long s) : seconds(s) {}
+};
+
+// Untrusted text, HTML escaped on the way out
+struct Escaped {
+    const char *text;
+    const size_t length;
+    explicit Escaped(const std::string &s) : text(s.c_str()), length(s.size()) {}
+    explicit Escaped(const char *s) : text(s), length(strlen(s)) {}
+};
+
+/*******************************
+ * Writers
+ *******************************/
+inline void write(std::string &out, const char *value) { out += value; }
+inline void write(std::string &out, const std::string &value) { out += value; }
+inline void write(std::string &out, const char value) { out += value; }
+
+inline void write(std::string &out, const Padded &value) {
+    // filled from the back
+    char buf[24];
+    char *const end = buf + sizeof(buf);
+    char *p = end;
+    unsigned long v = value.value;
+    do {
+        *--p = '0' + (v % 10);
+        v /= 10;
+    } while (v != 0);
+
+    const size_t width = value.width < sizeof(buf) ? value.width : sizeof(buf);
+    while ((size_t)(end - p) < width) {
+        *--p = '0';
+    }
+    out.append(p, end - p);
+}
+
+inline void write(std::string &out, const unsigned long value) { write(out, Padded(value, 0)); }
+inline void write(std::string &out, const unsigned int value) { write(out, Padded(value, 0)); }
+
+inline void write(std::string &out, const long value) {
+    if (value < 0) {
+        out += '-';
+        write(out, Padded(-(unsigned long)value, 0));
+    } else {
+        write(out, Padded(value, 0));
+    }
+}
+
+inline void write(std::string &out, const int value) { write(out, (long)value); }
+
+inline void write(std::string &out, const Fixed &value) {
+    char buf[24];
+    const int n = snprintf(buf, sizeof(buf), "%.*f", (int)value.decimals, value.value);
+    if (n > 0) out.append(buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+}
+
+inline void write(std::string &out, const EpochTime &value) {
+    // civil date from days since epoch, see http://howardhinnant.github.io/date_algorithms.html
+    // (avoids gmtime/strftime, which are comparatively slow and not reentrant on every libc)
+    const unsigned long days = value.seconds / 86400;
+    const unsigned long secOfDay = value.seconds % 86400;
+
+    const unsigned long z = days + 719468;
+    const unsigned long era = z / 146097;
+    const unsigned long doe = z - era * 146097;
+    const unsigned long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned long mp = (5 * doy + 2) / 153;
+    const unsigned long day = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned long month = mp < 10 ? mp + 3 : mp - 9;
+    const unsigned long year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+
+    write(out, Padded(year, 4));
+    out += '-';
+    write(out, Padded(month, 2));
+    out += '-';
+    write(out, Padded(day, 2));
+    out += ' ';
+    write(out, Padded(secOfDay / 3600, 2));
+    out += ':';
+    write(out, Padded(secOfDay / 60 % 60, 2));
+    out += ':';
+    write(out, Padded(secOfDay % 60, 2));
+}
+
+inline const char *htmlEntityFor(const char c) {
+    switch (c) {
+        case '&':
+            return "&amp;";
+        case '<':
+            return "&lt;";
+        case '>':
+            return "&gt;";
+        case '"':
+            return "&quot;";
+        case '\'':
+            return "&#39;";
+        default:
+            return nullptr;
+    }
+}
+
+inline void write(std::string &out, const Escaped &value) {
+    // copy runs of safe characters in one go, only stopping for the ones needing an entity
+    size_t runStart = 0;
+    for (size_t i = 0; i < value.length; i++) {
+        const char *entity = htmlEntityFor(value.text[i]);
+        if (entity != nullptr) {
+            out.append(value.text + runStart, i - runStart);
+            out += entity;
+            runStart = i + 1;
+        }
+    }
+    out.append(value.text + runStart, value.length - runStart);
+}
+
+/*******************************
+ * Rendering
+ *******************************/
+template <size_t SLOTS, size_t I>
+inline void renderSlots(std::string &out, const Template<SLOTS> &t) {
+    out.append(t.text + t.segmentStart[I], t.segmentLength[I]);
+}
+
+template <size_t SLOTS, size_t I, typename Value, typename... Rest>
+inline void renderSlots(std::string &out, const Template<SLOTS> &t, const Value &value, const Rest &...rest) {
+    out.append(t.text + t.segmentStart[I], t.segmentLength[I]);
+    write(out, value);
+    renderSlots<SLOTS, I + 1>(out, t, rest...);
+}
+
+template <size_t SLOTS, typename... Values>
+inline void render(std::string &out, const Template<SLOTS> &t, const Values &...values) {
+    static_assert(sizeof...(Values) == SLOTS, "template slot count doesn't match the number of values");
+    renderSlots<SLOTS, 0>(out, t, values...);
+}
+
+}  // namespace templates
+}  // namespace richiev
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace richiev {
+namespace mqtt {
+
+/*******************************
+ * Topic dispatch
+ *
+ * Topic filters are split into segments and built into a trie once at setup.
+ * Dispatching walks the published topic a segment at a time, comparing
+ * segment hashes against the children of the current node, so the cost
+ * depends on the depth of the topic, not how many topics are registered.
+ * Supports the MQTT `+` (single level) and `#` (multi level) wildcards.
+ *
+ * Handlers get a view of the payload as received, dispatch itself doesn't
+ * copy or allocate.
+ *******************************/
+struct Payload {
+    const char* data;
+    size_t length;
+
+    // only for logging/debugging, allocates
+    std::string str() const { return std::string(data, length); }
+};
+
+using PayloadHandler = std::function<void(const Payload& payload)>;
+
+// FNV-1a
+constexpr uint32_t hashSegment(const char* segment, const size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)segment[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Whether a topic matches a single filter, for when a trie is overkill
+inline bool matchesFilter(const char* filter, const char* topic) {
+    while (true) {
+        if (filter[0] == '#' && filter[1] == 0) return true;
+
+        const char* filterEnd = strchr(filter, '/');
+        const char* topicEnd = strchr(topic, '/');
+        const size_t filterLength = filterEnd != nullptr ? filterEnd - filter : strlen(filter);
+        const size_t topicLength = topicEnd != nullptr ? topicEnd - topic : strlen(topic);
+
+        const bool wildcard = filterLength == 1 && filter[0] == '+';
+        if (!wildcard && (filterLength != topicLength || memcmp(filter, topic, filterLength) != 0)) return false;
+
+        if (filterEnd == nullptr || topicEnd == nullptr) {
+            // a/# also matches a
+            return filterEnd == topicEnd || (topicEnd == nullptr && strcmp(filterEnd, "/#") == 0);
+        }
+        filter = filterEnd + 1;
+        topic = topicEnd + 1;
+    }
+}
+
+// Handlers can be put in groups, which can be switched on and off together
+const uint8_t DEFAULT_HANDLER_GROUP = 0;
+const uint8_t MAX_HANDLER_GROUPS = 32;
+
+template <size_t MAX_NODES = 64, size_t MAX_HANDLERS = 32>
+class TopicDispatcher {
+   private:
+    static const int16_t NONE = -1;
+
+    struct Node {
+        std::string segment;
+        uint32_t hash = 0;
+        int16_t firstChild = NONE;
+        int16_t nextSibling = NONE;
+        // the `+` child, if any
+        int16_t wildcardChild = NONE;
+        // handlers registered on <this node>/#
+        int16_t multiLevelHandlers = NONE;
+        // handlers registered on exactly this node
+        int16_t handlers = NONE;
+    };
+
+    struct HandlerEntry {
+        PayloadHandler handler;
+        uint8_t group = DEFAULT_HANDLER_GROUP;
+        int16_t next = NONE;
+    };
+
+    Node _nodes[MAX_NODES];
+    size_t _nodeCount = 1;  // 0 is the root
+    HandlerEntry _handlers[MAX_HANDLERS];
+    size_t _handlerCount = 0;
+
+    uint32_t _enabledGroups = 0xFFFFFFFF;
+    std::vector<std::string> _filters;
+
+    int16_t findOrAddChild(const int16_t parent, const char* segment, const size_t length) {
+        if (length == 1 && segment[0] == '+') {
+            if (_nodes[parent].wildcardChild == NONE) {
+                if (_nodeCount >= MAX_NODES) return NONE;
+                _nodes[parent].wildcardChild = _nodeCount++;
+            }
+            return _nodes[parent].wildcardChild;
+        }
+
+        const uint32_t hash = hashSegment(segment, length);
+        for (int16_t child = _nodes[parent].firstChild; child != NONE; child = _nodes[child].nextSibling) {
+            if (_nodes[child].hash == hash && _nodes[child].segment.compare(0, std::string::npos, segment, length) == 0) {
+                return child;
+            }
+        }
+
+        if (_nodeCount >= MAX_NODES) return NONE;
+        const int16_t child = _nodeCount++;
+        _nodes[child].segment.assign(segment, length);
+        _nodes[child].hash = hash;
+        _nodes[child].nextSibling = _nodes[parent].firstChild;
+        _nodes[parent].firstChild = child;
+        return child;
+    }
+
+    bool appendHandler(int16_t& listHead, const PayloadHandler& handler, const uint8_t group) {
+        if (_handlerCount >= MAX_HANDLERS) return false;
+        const int16_t entry = _handlerCount++;
+        _handlers[entry].handler = handler;
+        _handlers[entry].group = group;
+
+        // keep registration order
+        int16_t* tail = &listHead;
+        while (*tail != NONE) {
+            tail = &_handlers[*tail].next;
+        }
+        *tail = entry;
+        return true;
+    }
+
+    size_t invoke(int16_t entry, const Payload& payload) const {
+        size_t invoked = 0;
+        for (; entry != NONE; entry = _handlers[entry].next) {
+            if (_enabledGroups & (1u << _handlers[entry].group)) {
+                _handlers[entry].handler(payload);
+                invoked++;
+            }
+        }
+        return invoked;
+    }
+
+    // segment points at the remaining topic, hasSegment is false once the whole topic is consumed
+    size_t dispatchFrom(const int16_t node, const char* segment, const char* end, const bool hasSegment, const Payload& payload) const {
+        size_t invoked = invoke(_nodes[node].multiLevelHandlers, payload);
+        if (!hasSegment) {
+            return invoked + invoke(_nodes[node].handlers, payload);
+        }
+
+        const char* separator = (const char*)memchr(segment, '/', end - segment);
+        const char* segmentEnd = separator != nullptr ? separator : end;
+        const size_t length = segmentEnd - segment;
+        const char* next = separator != nullptr ? separator + 1 : end;
+        const bool hasNext = separator != nullptr;
+
+        const uint32_t hash = hashSegment(segment, length);
+        for (int16_t child = _nodes[node].firstChild; child != NONE; child = _nodes[child].nextSibling) {
+            if (_nodes[child].hash == hash && _nodes[child].segment.size() == length &&
+                memcmp(_nodes[child].segment.data(), segment, length) == 0) {
+                invoked += dispatchFrom(child, next, end, hasNext, payload);
+                break;
+            }
+        }
+        if (_nodes[node].wildcardChild != NONE) {
+            invoked += dispatchFrom(_nodes[node].wildcardChild, next, end, hasNext, payload);
+        }
+        return invoked;
+    }
+
+   public:
+    // Registers a handler for a topic filter (eg "debug/dosers/+" or "config/#").
+    // Several handlers can be registered on the same filter, they're called in
+    // registration order. Only meant to be called during setup.
+    bool on(const char* filter, const PayloadHandler& handler, const uint8_t group = DEFAULT_HANDLER_GROUP) {
+        if (group >= MAX_HANDLER_GROUPS) return false;
+
+        const size_t filterLength = strlen(filter);
+        const char* end = filter + filterLength;
+        int16_t node = 0;
+        const char* segment = filter;
+        while (true) {
+            const char* separator = (const char*)memchr(segment, '/', end - segment);
+            const char* segmentEnd = separator != nullptr ? separator : end;
+            const size_t length = segmentEnd - segment;
+
+            if (length == 1 && segment[0] == '#') {
+                // only valid as the last segment
+                if (separator != nullptr) return false;
+                if (!appendHandler(_nodes[node].multiLevelHandlers, handler, group)) return false;
+                break;
+            }
+
+            node = findOrAddChild(node, segment, length);
+            if (node == NONE) return false;
+
+            if (separator == nullptr) {
+                if (!appendHandler(_nodes[node].handlers, handler, group)) return false;
+                break;
+            }
+            segment = separator + 1;
+        }
+
+        for (const auto& existing : _filters) {
+            if (existing == filter) return true;
+        }
+        _filters.push_back(filter);
+        return true;
+    }
+
+    bool on(const std::string& filter, const PayloadHandler& handler, const uint8_t group = DEFAULT_HANDLER_GROUP) {
+        return on(filter.c_str(), handler, group);
+    }
+
+    // Calls every enabled handler whose filter matches the topic, returns how many were called
+    size_t dispatch(const char* topic, const size_t topicLength, const Payload& payload) const {
+        return dispatchFrom(0, topic, topic + topicLength, true, payload);
+    }
+
+    size_t dispatch(const char* topic, const Payload& payload) const {
+        return dispatch(topic, strlen(topic), payload);
+    }
+
+    void setGroupEnabled(const uint8_t group, const bool enabled) {
+        if (group >= MAX_HANDLER_GROUPS) return;
+        if (enabled) {
+            _enabledGroups |= (1u << group);
+        } else {
+            _enabledGroups &= ~(1u << group);
+        }
+    }
+
+    bool isGroupEnabled(const uint8_t group) const {
+        return group < MAX_HANDLER_GROUPS && (_enabledGroups & (1u << group));
+    }
+
+    // The distinct filters registered, to subscribe to
+    const std::vector<std::string>& filters() const { return _filters; }
+
+    size_t handlerCount() const { return _handlerCount; }
+};
+
+}  // namespace mqtt
+}  // namespace richiev
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+namespace richiev {
+namespace mqtt {
+
+const size_t MAX_QUEUED_TOPIC_LEN = 48;
+const size_t MAX_QUEUED_PAYLOAD_LEN = 320;
+// commands can be a lot bigger than what's published (eg a measure alk
+// command with its whole config), so the inbox has its own, bigger, slots
+const size_t MAX_INBOX_PAYLOAD_LEN = 1024;
+
+template <size_t PAYLOAD_LEN>
+struct BasicQueuedMessage {
+    char topic[MAX_QUEUED_TOPIC_LEN];
+    char payload[PAYLOAD_LEN];
+    size_t length = 0;
+
+    // false if it doesn't fit
+    bool assign(const char* t, const char* p, const size_t l) {
+        const size_t topicLength = strlen(t);
+        if (topicLength >= sizeof(topic) || l >= sizeof(payload)) return false;
+
+        memcpy(topic, t, topicLength + 1);
+        memcpy(payload, p, l);
+        // keep payloads printable/parsable as c strings
+        payload[l] = 0;
+        length = l;
+        return true;
+    }
+};
+
+using QueuedMessage = BasicQueuedMessage<MAX_QUEUED_PAYLOAD_LEN>;
+using InboxMessage = BasicQueuedMessage<MAX_INBOX_PAYLOAD_LEN>;
+
+// Fixed size FIFO of messages. Not synchronized, the owners lock around it.
+template <size_t DEPTH, typename Message = QueuedMessage>
+class MessageRing {
+   private:
+    Message _messages[DEPTH];
+    size_t _head = 0;
+    size_t _size = 0;
+
+   public:
+    bool full() const { return _size >= DEPTH; }
+    bool empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+
+    bool push(const char* topic, const char* payload, const size_t length) {
+        if (full()) return false;
+        if (!_messages[(_head + _size) % DEPTH].assign(topic, payload, length)) return false;
+        _size++;
+        return true;
+    }
+
+    bool pop(Message& out) {
+        if (empty()) return false;
+        out = _messages[_head];
+        _head = (_head + 1) % DEPTH;
+        _size--;
+        return true;
+    }
+};
+
+struct OutboxStats {
+    std::atomic<uint32_t> enqueued{0};
+    // rejected because the queue/envelope was full or the message too big
+    std::atomic<uint32_t> dropped{0};
+    // replaced by a newer message before it was sent
+    std::atomic<uint32_t> coalesced{0};
+    std::atomic<uint32_t> published{0};
+    std::atomic<uint32_t> publishFailures{0};
+    std::atomic<uint32_t> highWater{0};
+};
+
+using PublishFunc = std::function<bool(const char* topic, const char* payload, size_t length)>;
+
+/*******************************
+ * Outbox
+ *
+ * Decouples producers (the measurement loop, pH readings) from the network.
+ * Producers only ever copy into fixed buffers under a short lock and never
+ * wait on the network; a separate network task drains the outbox and does
+ * the actual publishing. Messages can be:
+ *  - sent: queued FIFO, dropped (and counted) when the queue is full
+ *  - coalesced: one slot per topic, a newer message replaces an unsent one
+ *  - batched: appended to a JSON array envelope that's published periodically
+ *******************************/
+template <size_t QUEUE_DEPTH = 8, size_t COALESCE_SLOTS = 3, size_t ENVELOPE_CAPACITY = 1536>
+class Outbox {
+   private:
+    struct CoalesceSlot {
+        QueuedMessage message;
+        bool pending = false;
+        bool used = false;
+    };
+
+    mutable std::mutex _lock;
+    MessageRing<QUEUE_DEPTH> _queue;
+    CoalesceSlot _slots[COALESCE_SLOTS];
+
+    char _envelopeTopic[MAX_QUEUED_TOPIC_LEN] = {0};
+    unsigned long _envelopeIntervalMS = 0;
+    unsigned long _lastEnvelopeMS = 0;
+    // [item,item,...], without the closing bracket
+    char _envelope[ENVELOPE_CAPACITY];
+    size_t _envelopeLength = 0;
+
+    OutboxStats _stats;
+
+    void updateHighWater() {
+        const uint32_t depth = _queue.size();
+        if (depth > _stats.highWater.load(std::memory_order_relaxed)) {
+            _stats.highWater.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    void recordPublish(const bool success) {
+        if (success) {
+            _stats.published.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            _stats.publishFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+   public:
+    // Batched items are published as a single JSON array on topic, at most every intervalMS
+    void setEnvelope(const char* topic, const unsigned long intervalMS) {
+        std::lock_guard<std::mutex> guard(_lock);
+        strncpy(_envelopeTopic, topic, sizeof(_envelopeTopic) - 1);
+        _envelopeIntervalMS = intervalMS;
+    }
+
+    bool send(const char* topic, const char* payload, const size_t length) {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_queue.push(topic, payload, length)) {
+            _stats.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        _stats.enqueued.fetch_add(1, std::memory_order_relaxed);
+        updateHighWater();
+        return true;
+    }
+
+    // Latest wins: replaces any unsent message for the same topic
+    bool coalesce(const char* topic, const char* payload, const size_t length) {
+        std::lock_guard<std::mutex> guard(_lock);
+        CoalesceSlot* slot = nullptr;
+        for (auto& s : _slots) {
+            if (s.used && strcmp(s.message.topic, topic) == 0) {
+                slot = &s;
+                break;
+            }
+            if (!s.used && slot == nullptr) slot = &s;
+        }
+
+        if (slot == nullptr || !slot->message.assign(topic, payload, length)) {
+            _stats.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (slot->pending) {
+            _stats.coalesced.fetch_add(1, std::memory_order_relaxed);
+        }
+        slot->used = true;
+        slot->pending = true;
+        _stats.enqueued.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Appends a JSON value to the current envelope
+    bool batch(const char* item, const size_t length) {
+        std::lock_guard<std::mutex> guard(_lock);
+        // separator + item + closing bracket
+        if (_envelopeTopic[0] == 0 || _envelopeLength + 1 + length + 1 > sizeof(_envelope)) {
+            _stats.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        const char separator = _envelopeLength == 0 ? '[' : ',';
+        _envelope[_envelopeLength++] = separator;
+        memcpy(_envelope + _envelopeLength, item, length);
+        _envelopeLength += length;
+        _stats.enqueued.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Publishes everything pending (and the envelope, if it's due). Only
+    // called from the network task; the lock is only held while copying a
+    // message out, never while publishing.
+    size_t drain(const unsigned long nowMS, const PublishFunc& publish) {
+        size_t published = 0;
+        QueuedMessage message;
+
+        while (true) {
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                if (!_queue.pop(message)) break;
+            }
+            recordPublish(publish(message.topic, message.payload, message.length));
+            published++;
+        }
+
+        for (size_t i = 0; i < COALESCE_SLOTS; i++) {
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                if (!_slots[i].pending) continue;
+                message = _slots[i].message;
+                _slots[i].pending = false;
+            }
+            recordPublish(publish(message.topic, message.payload, message.length));
+            published++;
+        }
+
+        if (_envelopeIntervalMS > 0 && nowMS - _lastEnvelopeMS >= _envelopeIntervalMS) {
+            char envelope[ENVELOPE_CAPACITY];
+            size_t envelopeLength = 0;
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                _lastEnvelopeMS = nowMS;
+                if (_envelopeLength > 0) {
+                    memcpy(envelope, _envelope, _envelopeLength);
+                    envelopeLength = _envelopeLength;
+                    envelope[envelopeLength++] = ']';
+                    _envelopeLength = 0;
+                }
+            }
+            if (envelopeLength > 0) {
+                recordPublish(publish(_envelopeTopic, envelope, envelopeLength));
+                published++;
+            }
+        }
+
+        return published;
+    }
+
+    size_t depth() const {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _queue.size();
+    }
+
+    const OutboxStats& stats() const { return _stats; }
+};
+
+/*******************************
+ * Inbox
+ *
+ * Received messages, handed from the network task to another task so
+ * handlers (which drive the dosers etc) run there.
+ *******************************/
+template <size_t DEPTH = 4>
+class Inbox {
+   private:
+    std::mutex _lock;
+    MessageRing<DEPTH, InboxMessage> _queue;
+    std::atomic<uint32_t> _dropped{0};
+
+   public:
+    bool push(const char* topic, const char* payload, const size_t length) {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_queue.push(topic, payload, length)) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    bool pop(InboxMessage& out) {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _queue.pop(out);
+    }
+
+    uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+};
+
+using DefaultOutbox = Outbox<>;
+using DefaultInbox = Inbox<>;
+
+}  // namespace mqtt
+}  // namespace richiev
@@ -1,49 +1,62 @@
 #pragma once
 
-#include <map>
 #include <memory>
 // Arduino Libraries
-#include <ArduinoJson.h>
 #include <TinyMqtt.h>
 
+#include "mqtt-dispatch.h"
+#include "mqtt-outbox.h"
+
 namespace richiev {
 namespace mqtt {
 /*******************************
  * Handlers
  *******************************/
-using TopicProcessorMap = std::map<std::string,
-                                   std::function<void(const std::string& payload)>>;
-std::shared_ptr<TopicProcessorMap> topicsToProcessor = nullptr;
-
-StaticJsonDocument<200> parseInput(const std::string payload) {
-    StaticJsonDocument<200> doc;
-    DeserializationError error = deserializeJson(doc, payload);
+using Dispatcher = TopicDispatcher<>;
+std::shared_ptr<Dispatcher> dispatcher = nullptr;
 
-    if (error) {
-        Serial.print(F("deserializeJson() failed: "));
-        Serial.println(error.f_str());
-    }
-    return doc;
-}
+// When set, received messages are queued here and dispatched by dispatchInbox,
+// rather than from inside the client's loop (eg when that runs in another task)
+std::shared_ptr<DefaultInbox> inbox = nullptr;
 
-void onPublish(const MqttClient* /* srce */, const Topic& topic, const char* payloadC, size_t payloadLength) {
-    std::string payload = payloadC;
+void dispatchMessage(const char* topic, const Payload& payload) {
     Serial.print("Received msg on topic=");
-    Serial.print(topic.c_str());
+    Serial.print(topic);
     Serial.print(", payload=");
-    Serial.print(payloadC);
+    Serial.write((const uint8_t*)payload.data, payload.length);
     Serial.print(", free_heap=");
     Serial.print(xPortGetFreeHeapSize());
     Serial.println();
 
-    if (topicsToProcessor->count(topic.c_str())) {
-        (*topicsToProcessor)[topic.c_str()](payload);
-    } else {
+    if (dispatcher->dispatch(topic, payload) == 0) {
         Serial << "Not handled topic, ignoring" << endl;
     }
 }
 
-void setupMQTT(std::shared_ptr<MqttBroker> mqttBroker, std::shared_ptr<MqttClient> mqttClient, const std::shared_ptr<TopicProcessorMap> topProcessor) {
+void onPublish(const MqttClient* /* srce */, const Topic& topic, const char* payloadC, size_t payloadLength) {
+    if (inbox != nullptr) {
+        if (!inbox->push(topic.c_str(), payloadC, payloadLength)) {
+            Serial.print("Inbox full or message too big, dropping msg on topic=");
+            Serial.println(topic.c_str());
+        }
+        return;
+    }
+
+    dispatchMessage(topic.c_str(), {.data = payloadC, .length = payloadLength});
+}
+
+// Dispatches the messages queued in the inbox, on the calling task
+void dispatchInbox() {
+    if (inbox == nullptr) return;
+
+    // only the one task dispatches, this keeps the 1KB off its stack
+    static InboxMessage message;
+    while (inbox->pop(message)) {
+        dispatchMessage(message.topic, {.data = message.payload, .length = message.length});
+    }
+}
+
+void setupMQTT(std::shared_ptr<MqttBroker> mqttBroker, std::shared_ptr<MqttClient> mqttClient, const std::shared_ptr<Dispatcher> topicDispatcher) {
     Serial.print("Starting MQTT broker");
     Serial.print("...");
 
@@ -52,12 +65,12 @@ void setupMQTT(std::shared_ptr<MqttBroker> mqttBroker, std::shared_ptr<MqttClien
     Serial.println(" done");
 
     Serial.print("Starting MQTT client on topic_count=");
-    topicsToProcessor = topProcessor;
-    Serial.println(topicsToProcessor->size());
+    dispatcher = topicDispatcher;
+    Serial.println(dispatcher->filters().size());
 
     mqttClient->setCallback(onPublish);
-    for (const auto& topicAndProcessor : *topicsToProcessor) {
-        mqttClient->subscribe(topicAndProcessor.first);
+    for (const auto& filter : dispatcher->filters()) {
+        mqttClient->subscribe(Topic(filter));
     }
 }
 
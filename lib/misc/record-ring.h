@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace richiev {
+namespace storage {
+
+/*******************************
+ * Record ring
+ *
+ * A persistent FIFO of small (topic, payload) records, in fixed size slots
+ * on some byte addressable storage (a file in flash on the device, memory in
+ * tests). Record n always lives in slot n % slotCount, so nothing but the
+ * last acknowledged sequence number needs storing: on open the slots are
+ * scanned to find where the ring starts and ends. When the ring is full the
+ * oldest record is overwritten.
+ *
+ * Records are acknowledged once they've been handled, a crash between
+ * handling and acknowledging replays that record (at least once delivery).
+ *
+ * Storage needs:
+ *   size_t size() const;
+ *   bool read(size_t offset, void* buf, size_t length);
+ *   bool write(size_t offset, const void* buf, size_t length);
+ *******************************/
+struct RecordHeader {
+    // 0 for never written
+    uint32_t sequence;
+    uint32_t checksum;
+    uint16_t topicLength;
+    uint16_t payloadLength;
+};
+
+struct RingMeta {
+    uint32_t magic;
+    uint32_t ackedSequence;
+};
+
+const uint32_t RING_MAGIC = 0x42524E47;  // BRNG
+
+// FNV-1a, enough to spot torn or never written slots
+inline uint32_t recordChecksum(const RecordHeader& header, const char* topic, const char* payload) {
+    uint32_t hash = 2166136261u;
+    auto add = [&hash](const void* data, const size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            hash ^= ((const uint8_t*)data)[i];
+            hash *= 16777619u;
+        }
+    };
+    add(&header.sequence, sizeof(header.sequence));
+    add(&header.topicLength, sizeof(header.topicLength));
+    add(&header.payloadLength, sizeof(header.payloadLength));
+    add(topic, header.topicLength);
+    add(payload, header.payloadLength);
+    return hash;
+}
+
+template <typename Storage, size_t SLOT_SIZE = 384>
+class RecordRing {
+   private:
+    static const size_t MAX_RECORD_DATA = SLOT_SIZE - sizeof(RecordHeader);
+
+    Storage& _storage;
+    size_t _slotCount = 0;
+
+    uint32_t _ackedSequence = 0;
+    // sequence the next pushed record gets
+    uint32_t _nextSequence = 1;
+    uint32_t _overwritten = 0;
+
+    // scratch for reading slots, kept off the (small) task stacks
+    char _buffer[MAX_RECORD_DATA];
+
+    size_t slotOffset(const uint32_t sequence) const { return sizeof(RingMeta) + (sequence % _slotCount) * SLOT_SIZE; }
+
+    bool writeMeta() {
+        RingMeta meta = {.magic = RING_MAGIC, .ackedSequence = _ackedSequence};
+        return _storage.write(0, &meta, sizeof(meta));
+    }
+
+    // reads the record in the slot into header & _buffer (topic then payload), false if it isn't a valid one
+    bool readSlot(const size_t slot, RecordHeader& header) {
+        char* buffer = _buffer;
+        const size_t offset = sizeof(RingMeta) + slot * SLOT_SIZE;
+        if (!_storage.read(offset, &header, sizeof(header))) return false;
+        if (header.sequence == 0 || header.topicLength + header.payloadLength > MAX_RECORD_DATA) return false;
+        if (header.sequence % _slotCount != slot) return false;
+
+        if (!_storage.read(offset + sizeof(header), buffer, header.topicLength + header.payloadLength)) return false;
+        return recordChecksum(header, buffer, buffer + header.topicLength) == header.checksum;
+    }
+
+   public:
+    explicit RecordRing(Storage& storage) : _storage(storage) {}
+
+    // Finds the existing records (or formats the storage). False if the storage is too small/unusable.
+    bool open() {
+        if (_storage.size() < sizeof(RingMeta) + SLOT_SIZE) return false;
+        _slotCount = (_storage.size() - sizeof(RingMeta)) / SLOT_SIZE;
+
+        RingMeta meta;
+        if (!_storage.read(0, &meta, sizeof(meta)) || meta.magic != RING_MAGIC) {
+            // new storage, wipe the slots so stale data can't look like records
+            _ackedSequence = 0;
+            _nextSequence = 1;
+            RecordHeader empty = {};
+            for (size_t slot = 0; slot < _slotCount; slot++) {
+                if (!_storage.write(sizeof(RingMeta) + slot * SLOT_SIZE, &empty, sizeof(empty))) return false;
+            }
+            return writeMeta();
+        }
+
+        _ackedSequence = meta.ackedSequence;
+        uint32_t newest = _ackedSequence;
+        RecordHeader header;
+        for (size_t slot = 0; slot < _slotCount; slot++) {
+            if (readSlot(slot, header) && header.sequence > newest) newest = header.sequence;
+        }
+        _nextSequence = newest + 1;
+        return true;
+    }
+
+    size_t capacity() const { return _slotCount; }
+    size_t size() const { return _nextSequence - firstSequence(); }
+    bool empty() const { return size() == 0; }
+    // records lost because the ring filled up
+    uint32_t overwritten() const { return _overwritten; }
+
+    // the unacknowledged records are sequences [firstSequence(), nextSequence())
+    uint32_t firstSequence() const {
+        const uint32_t oldestKept = _nextSequence > _slotCount ? _nextSequence - _slotCount : 1;
+        return _ackedSequence + 1 > oldestKept ? _ackedSequence + 1 : oldestKept;
+    }
+    uint32_t nextSequence() const { return _nextSequence; }
+
+    bool push(const char* topic, const char* payload, const size_t payloadLength) {
+        const size_t topicLength = strlen(topic);
+        if (_slotCount == 0 || topicLength + payloadLength > MAX_RECORD_DATA) return false;
+
+        if (size() >= _slotCount) _overwritten++;
+
+        RecordHeader header = {.sequence = _nextSequence, .checksum = 0, .topicLength = (uint16_t)topicLength, .payloadLength = (uint16_t)payloadLength};
+        header.checksum = recordChecksum(header, topic, payload);
+
+        const size_t offset = slotOffset(_nextSequence);
+        if (!_storage.write(offset + sizeof(header), topic, topicLength)) return false;
+        if (!_storage.write(offset + sizeof(header) + topicLength, payload, payloadLength)) return false;
+        // header last, so a torn write leaves an invalid record
+        if (!_storage.write(offset, &header, sizeof(header))) return false;
+
+        _nextSequence++;
+        return true;
+    }
+
+    // Reads the oldest unacknowledged record. topic is null terminated, payload isn't.
+    // False if there's none (or it can't be read, in which case it's skipped).
+    bool peek(char* topic, const size_t topicCapacity, char* payload, const size_t payloadCapacity, size_t& payloadLength) {
+        while (!empty()) {
+            const uint32_t sequence = firstSequence();
+            RecordHeader header;
+            if (readSlot(sequence % _slotCount, header) && header.sequence == sequence &&
+                header.topicLength < topicCapacity && header.payloadLength <= payloadCapacity) {
+                memcpy(topic, _buffer, header.topicLength);
+                topic[header.topicLength] = 0;
+                memcpy(payload, _buffer + header.topicLength, header.payloadLength);
+                payloadLength = header.payloadLength;
+                return true;
+            }
+            // unreadable, don't get stuck on it
+            _ackedSequence = sequence;
+        }
+        return false;
+    }
+
+    // Calls f(topic, topicLength, payload, payloadLength) with each unacknowledged
+    // record, oldest first, without acknowledging them. Unreadable ones are skipped.
+    template <typename F>
+    void forEach(F&& f) {
+        for (uint32_t sequence = firstSequence(); sequence < _nextSequence; sequence++) {
+            readRecord(sequence, f);
+        }
+    }
+
+    // Calls f(topic, topicLength, payload, payloadLength) with the record of the
+    // given sequence. False if it's been overwritten or can't be read.
+    template <typename F>
+    bool readRecord(const uint32_t sequence, F&& f) {
+        if (_slotCount == 0 || sequence == 0) return false;
+        RecordHeader header;
+        if (!readSlot(sequence % _slotCount, header) || header.sequence != sequence) return false;
+        f(_buffer, (size_t)header.topicLength, _buffer + header.topicLength, (size_t)header.payloadLength);
+        return true;
+    }
+
+    // Acknowledges the oldest record, it won't be returned again
+    bool pop() {
+        if (empty()) return false;
+        _ackedSequence = firstSequence();
+        return writeMeta();
+    }
+};
+
+// Storage in memory, mostly for tests
+template <size_t SIZE>
+class MemoryStorage {
+   private:
+    uint8_t _data[SIZE] = {0};
+
+   public:
+    size_t size() const { return SIZE; }
+
+    bool read(const size_t offset, void* buf, const size_t length) {
+        if (offset + length > SIZE) return false;
+        memcpy(buf, _data + offset, length);
+        return true;
+    }
+
+    bool write(const size_t offset, const void* buf, const size_t length) {
+        if (offset + length > SIZE) return false;
+        memcpy(_data + offset, buf, length);
+        return true;
+    }
+
+    uint8_t* data() { return _data; }
+};
+
+}  // namespace storage
+}  // namespace richiev
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace richiev {
+namespace scheduling {
+
+/*******************************
+ * Scheduler
+ *
+ * A cooperative scheduler for the periodic work on a task. Jobs are kept in
+ * a hashed timer wheel (slot = deadline tick % WHEEL_SLOTS, each slot sorted
+ * by deadline), so registering/rescheduling is cheap and a pass only looks
+ * at the slots time has moved through. Jobs run in deadline order.
+ *
+ * Each job can have a budget; runs that take longer are counted as overruns
+ * so slow subsystems show up. Between passes the caller sleeps for
+ * msUntilNextDeadline() rather than spinning.
+ *
+ * Single threaded: register, run & inspect from the owning task.
+ *******************************/
+using JobFunc = void (*)();
+using ClockFunc = unsigned long (*)();
+
+enum class Pacing : uint8_t {
+    // deadlines are period apart, regardless of how long runs take (missed ones are skipped)
+    FIXED_RATE,
+    // the next deadline is period after the previous run finished
+    FIXED_DELAY,
+};
+
+struct JobStats {
+    uint32_t runs = 0;
+    // runs over budget
+    uint32_t overruns = 0;
+    // deadlines skipped because a run was too late to catch up
+    uint32_t skipped = 0;
+    uint32_t lastDurationUS = 0;
+    uint32_t maxDurationUS = 0;
+    // how long after its deadline a run started, at worst
+    uint32_t maxLatenessMS = 0;
+};
+
+struct Job {
+    const char *name = nullptr;
+    JobFunc func = nullptr;
+    uint32_t periodMS = 0;
+    // 0 for no budget
+    uint32_t budgetUS = 0;
+    Pacing pacing = Pacing::FIXED_RATE;
+
+    uint32_t deadlineMS = 0;
+    JobStats stats;
+};
+
+// wraparound safe a <= b, for millis() style clocks
+inline bool notAfter(const uint32_t a, const uint32_t b) { return (int32_t)(a - b) <= 0; }
+
+template <size_t MAX_JOBS = 16, size_t WHEEL_SLOTS = 64, uint32_t TICK_MS = 1>
+class Scheduler {
+   private:
+    static const int8_t NONE = -1;
+
+    const ClockFunc _microsClock;
+
+    Job _jobs[MAX_JOBS];
+    int8_t _next[MAX_JOBS];
+    size_t _jobCount = 0;
+
+    int8_t _slots[WHEEL_SLOTS];
+    // the last tick passes have caught up to
+    uint32_t _tick = 0;
+    bool _started = false;
+
+    static size_t slotFor(const uint32_t deadlineMS) { return (deadlineMS / TICK_MS) % WHEEL_SLOTS; }
+
+    void insert(const int8_t job) {
+        int8_t *link = &_slots[slotFor(_jobs[job].deadlineMS)];
+        while (*link != NONE && notAfter(_jobs[*link].deadlineMS, _jobs[job].deadlineMS)) {
+            link = &_next[*link];
+        }
+        _next[job] = *link;
+        *link = job;
+    }
+
+    void run(const int8_t index, const uint32_t nowMS) {
+        Job &job = _jobs[index];
+        const uint32_t lateness = nowMS - job.deadlineMS;
+        if (lateness > job.stats.maxLatenessMS) job.stats.maxLatenessMS = lateness;
+
+        const uint32_t startedUS = _microsClock();
+        job.func();
+        const uint32_t durationUS = _microsClock() - startedUS;
+
+        job.stats.runs++;
+        job.stats.lastDurationUS = durationUS;
+        if (durationUS > job.stats.maxDurationUS) job.stats.maxDurationUS = durationUS;
+        if (job.budgetUS > 0 && durationUS > job.budgetUS) job.stats.overruns++;
+
+        const uint32_t finishedMS = nowMS + durationUS / 1000;
+        if (job.pacing == Pacing::FIXED_DELAY) {
+            job.deadlineMS = finishedMS + job.periodMS;
+        } else {
+            job.deadlineMS += job.periodMS;
+            // don't try to catch up with a burst of runs
+            while (notAfter(job.deadlineMS, finishedMS)) {
+                job.deadlineMS += job.periodMS;
+                job.stats.skipped++;
+            }
+        }
+        insert(index);
+    }
+
+    size_t runSlot(const size_t slot, const uint32_t nowMS) {
+        size_t ran = 0;
+        // sorted, so stop at the first job that isn't due (including ones a whole revolution away)
+        while (_slots[slot] != NONE && notAfter(_jobs[_slots[slot]].deadlineMS, nowMS)) {
+            const int8_t job = _slots[slot];
+            _slots[slot] = _next[job];
+            run(job, nowMS);
+            ran++;
+        }
+        return ran;
+    }
+
+   public:
+    explicit Scheduler(const ClockFunc microsClock) : _microsClock(microsClock) {
+        for (auto &slot : _slots) slot = NONE;
+    }
+
+    // Registers a job, first due at firstDeadlineMS. Only meant to be called during setup.
+    bool every(const char *name, const uint32_t periodMS, const JobFunc func, const uint32_t budgetUS = 0,
+               const Pacing pacing = Pacing::FIXED_RATE, const uint32_t firstDeadlineMS = 0) {
+        if (_jobCount >= MAX_JOBS || periodMS == 0) return false;
+
+        const int8_t index = _jobCount++;
+        Job &job = _jobs[index];
+        job.name = name;
+        job.func = func;
+        job.periodMS = periodMS;
+        job.budgetUS = budgetUS;
+        job.pacing = pacing;
+        job.deadlineMS = firstDeadlineMS;
+        // already passed slots aren't looked at again until the wheel comes back round
+        if (_started && notAfter(job.deadlineMS, _tick * TICK_MS)) job.deadlineMS = _tick * TICK_MS;
+        insert(index);
+        return true;
+    }
+
+    // Runs every job that's due, returns how many ran
+    size_t runDue(const uint32_t nowMS) {
+        const uint32_t nowTick = nowMS / TICK_MS;
+        if (!_started) {
+            // jobs registered with deadlines in the past are due now
+            _tick = nowTick - (WHEEL_SLOTS - 1);
+            _started = true;
+        }
+
+        // visit the slots time has moved through, at most the whole wheel once
+        uint32_t steps = nowTick - _tick;
+        if (steps >= WHEEL_SLOTS) steps = WHEEL_SLOTS - 1;
+
+        size_t ran = 0;
+        for (uint32_t tick = nowTick - steps;; tick++) {
+            ran += runSlot(tick % WHEEL_SLOTS, nowMS);
+            if (tick == nowTick) break;
+        }
+        _tick = nowTick;
+        return ran;
+    }
+
+    // How long the owning task can sleep for, capped at maxMS
+    uint32_t msUntilNextDeadline(const uint32_t nowMS, const uint32_t maxMS = 1000) const {
+        uint32_t sleepMS = maxMS;
+        for (size_t i = 0; i < _jobCount; i++) {
+            if (notAfter(_jobs[i].deadlineMS, nowMS)) return 0;
+            const uint32_t untilMS = _jobs[i].deadlineMS - nowMS;
+            if (untilMS < sleepMS) sleepMS = untilMS;
+        }
+        return sleepMS;
+    }
+
+    template <typename F>
+    void forEachJob(F &&f) const {
+        for (size_t i = 0; i < _jobCount; i++) {
+            f(_jobs[i]);
+        }
+    }
+
+    size_t jobCount() const { return _jobCount; }
+};
+
+}  // namespace scheduling
+}  // namespace richiev
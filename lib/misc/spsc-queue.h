@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace richiev {
+
+/*******************************
+ * SPSC queue
+ *
+ * Bounded, lock free queue for handing values from exactly one producer task
+ * to exactly one consumer task (eg across the two ESP32 cores). Neither side
+ * ever blocks or disables interrupts: push fails when full, pop when empty.
+ *
+ * Holds CAPACITY - 1 values, one slot is kept free to tell full from empty.
+ *******************************/
+template <typename T, size_t CAPACITY>
+class SPSCQueue {
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of 2");
+
+   private:
+    T _items[CAPACITY];
+    // only written by the consumer
+    std::atomic<size_t> _head{0};
+    // only written by the producer
+    std::atomic<size_t> _tail{0};
+
+    static size_t next(const size_t index) { return (index + 1) & (CAPACITY - 1); }
+
+   public:
+    // producer only
+    bool push(const T& item) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (next(tail) == _head.load(std::memory_order_acquire)) return false;
+
+        _items[tail] = item;
+        _tail.store(next(tail), std::memory_order_release);
+        return true;
+    }
+
+    bool push(T&& item) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (next(tail) == _head.load(std::memory_order_acquire)) return false;
+
+        _items[tail] = std::move(item);
+        _tail.store(next(tail), std::memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    bool pop(T& out) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) return false;
+
+        out = std::move(_items[head]);
+        _head.store(next(head), std::memory_order_release);
+        return true;
+    }
+
+    // either side, only a snapshot
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+
+    size_t size() const {
+        return (_tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire)) & (CAPACITY - 1);
+    }
+
+    static constexpr size_t capacity() { return CAPACITY - 1; }
+};
+
+}  // namespace richiev
@@ -101,7 +101,7 @@ template <size_t N=4,typename T=int, typename TSUM=long> class RVMovingAvg {
 		}
 
 		/** Get data size */
-		size_t size() {
+		size_t size() const {
 			return _currentSize;
 		}
 };
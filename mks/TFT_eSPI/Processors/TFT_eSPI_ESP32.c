@@ -718,6 +718,24 @@ void IRAM_ATTR dc_callback(spi_transaction_t *spi_tx)
   else {DC_C;}
 }
 
+/***************************************************************************************
+** Function name:           setDMACompleteCallback
+** Description:             Set a function to call from the SPI interrupt as each DMA
+**                          transfer completes. The interrupt isn't an IRAM one, so the
+**                          callback doesn't need to be IRAM_ATTR.
+***************************************************************************************/
+static void (*dmaCompleteCallback)(void) = nullptr;
+
+static void dma_post_callback(spi_transaction_t *spi_tx)
+{
+  if (dmaCompleteCallback != nullptr) dmaCompleteCallback();
+}
+
+void TFT_eSPI::setDMACompleteCallback(void (*callback)(void))
+{
+  dmaCompleteCallback = callback;
+}
+
 /***************************************************************************************
 ** Function name:           initDMA
 ** Description:             Initialise the DMA engine - returns true if init OK
@@ -755,7 +773,7 @@ bool TFT_eSPI::initDMA(bool ctrl_cs)
     .flags = SPI_DEVICE_NO_DUMMY, //0,
     .queue_size = 1,
     .pre_cb = 0, //dc_callback, //Callback to handle D/C line
-    .post_cb = 0
+    .post_cb = dma_post_callback
   };
   ret = spi_bus_initialize(spi_host, &buscfg, 1);
   ESP_ERROR_CHECK(ret);
@@ -655,6 +655,9 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
            // Push a block of pixels into a window set up using setAddrWindow()
   void     pushPixelsDMA(uint16_t* image, uint32_t len);
 
+           // Called from the SPI interrupt as each DMA transfer completes, eg to tell LVGL its buffer is free
+  void     setDMACompleteCallback(void (*callback)(void));  // buff
+
            // Check if the DMA is complete - use while(tft.dmaBusy); for a blocking wait
   bool     dmaBusy(void); // returns true if DMA is still in progress
   void     dmaWait(void); // wait until DMA is complete
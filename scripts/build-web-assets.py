@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+# Minifies and gzips the assets in web/ into data/static/, which is what gets
+# packed into the filesystem image (pio run -t buildfs / uploadfs).
+#
+# Runs as a PlatformIO pre: script, and also standalone:
+#   ./scripts/build-web-assets.py
+#
+# The content hash of the assets is exposed to the firmware as
+# WEB_ASSETS_VERSION, so the pages can reference /static/app.css?v=<hash> and
+# the browser can cache the assets forever.
+
+import gzip
+import hashlib
+import os
+import re
+
+ASSET_EXTENSIONS = (".css", ".js")
+
+
+def minify_css(source):
+    source = re.sub(r"/\*.*?\*/", "", source, flags=re.S)
+    source = re.sub(r"\s+", " ", source)
+    # Split into the selectors, at-rules & declarations between the braces
+    # and semicolons. Whitespace around ':' only goes inside declarations,
+    # in a selector "a :hover" isn't "a:hover".
+    parts = re.split(r"([{};])", source)
+    for i in range(0, len(parts), 2):
+        is_declaration = i + 1 < len(parts) and parts[i + 1] != "{"
+        if is_declaration:
+            parts[i] = re.sub(r"\s*:\s*", ":", parts[i])
+        parts[i] = re.sub(r"\s*([,>])\s*", r"\1", parts[i]).strip()
+    return "".join(parts).replace(";}", "}").strip()
+
+
+def minify_js(source):
+    # Deliberately conservative: only drop comment lines, indentation and
+    # blank lines. Anything smarter needs a real JS parser.
+    lines = []
+    for line in source.splitlines():
+        stripped = line.strip()
+        if not stripped or stripped.startswith("//"):
+            continue
+        lines.append(stripped)
+    return "\n".join(lines)
+
+
+MINIFIERS = {
+    ".css": minify_css,
+    ".js": minify_js,
+}
+
+
+def asset_sources(source_dir):
+    return sorted(f for f in os.listdir(source_dir) if f.endswith(ASSET_EXTENSIONS))
+
+
+def assets_version(source_dir):
+    digest = hashlib.sha1()
+    for name in asset_sources(source_dir):
+        with open(os.path.join(source_dir, name), "rb") as f:
+            digest.update(name.encode())
+            digest.update(f.read())
+    return digest.hexdigest()[:10]
+
+
+def build_assets(project_dir):
+    source_dir = os.path.join(project_dir, "web")
+    output_dir = os.path.join(project_dir, "data", "static")
+    os.makedirs(output_dir, exist_ok=True)
+
+    for name in asset_sources(source_dir):
+        with open(os.path.join(source_dir, name), encoding="utf-8") as f:
+            source = f.read()
+
+        minified = MINIFIERS[os.path.splitext(name)[1]](source).encode("utf-8")
+
+        output_path = os.path.join(output_dir, name + ".gz")
+        # mtime=0 keeps the output byte-for-byte reproducible between builds
+        with open(output_path, "wb") as raw, gzip.GzipFile(filename=name, mode="wb", fileobj=raw, compresslevel=9, mtime=0) as out:
+            out.write(minified)
+
+        print("web asset %s: %d -> %d bytes (%d gzipped)" % (name, len(source), len(minified), os.path.getsize(output_path)))
+
+    return assets_version(source_dir)
+
+
+try:
+    Import("env")  # noqa: F821 (provided by PlatformIO)
+
+    version = build_assets(env.subst("$PROJECT_DIR"))  # noqa: F821
+    env.Append(CPPDEFINES=[("WEB_ASSETS_VERSION", env.StringifyMacro(version))])  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        print("WEB_ASSETS_VERSION=" + build_assets(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
@@ -0,0 +1,466 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+// Buff Libraries
+#include "buff-metrics.h"
+#include "commands.h"
+#include "controller-common.h"
+#include "doser/doser-common.h"
+#include "event-bus.h"
+#include "mqtt-common.h"
+#include "mqtt-dispatch.h"
+#include "mqtt-outbox.h"
+#include "mqtt-publish.h"
+#include "ph-controller.h"
+#include "profiler.h"
+#include "readings/alk-measure.h"
+#include "readings/measurement-trace.h"
+#include "readings/reading-store.h"
+#include "scheduler.h"
+#include "spsc-queue.h"
+#include "sim-inputs.h"
+#include "sim/sim-doser.h"
+#include "sim/titration.h"
+#include "sim/trace-replay.h"
+#include "web-server-renderers.h"
+
+namespace buff {
+namespace host_sim {
+
+/*******************************
+ * Host simulator
+ *
+ * Runs the firmware's process, UI & network jobs (pH acquisition, command
+ * dispatch, the measurement state machine, the readings consumer, web page
+ * rendering & the MQTT outbox) on the host, against simulated dosers,
+ * titration chemistry and pH probe. The measurement handlers, job schedules
+ * and settings are the device's own (src/controller-common.h &
+ * src/inputs-common.h). Everything runs off the virtual clock, which jumps straight
+ * to the next job's deadline, so hours of operation take a second or so, and
+ * the same run gives the same results every time.
+ *
+ * It's the measurement side of the firmware, not all of it: main.cpp's
+ * setup, controller.h, the display, OTA and anything kept in Preferences
+ * aren't built. There's no TinyMqtt broker or HTTP socket either; the web
+ * job renders the root page as a browser would have it served, and MQTT goes
+ * through the outbox & inbox, with a loopback in place of the broker.
+ *
+ * Messages published to the outbox loop back into the inbox (as the device's
+ * own broker does for its client), so measurements are triggered the same
+ * way a home automation system would, over execute/measure_alk.
+ *
+ * Only doses & delays take (virtual) time unless --cpu-scale is given, which
+ * charges the host time spent in each job, scaled up to roughly the ESP32's
+ * speed, so the load from web & MQTT requests shows in job durations and
+ * lateness. The tasks share the one host thread, so a blocking dose holds
+ * the UI & network jobs up too; their lateness here is a worst case for the
+ * device, where they'd run on the other core.
+ *
+ *   pio run -e host_sim && .pio/build/host_sim/program --hours 24 --alk 7.5 --web 2 --mqtt 20 --cpu-scale 20 --quiet
+ *
+ * --record <file> writes the measurements' traces, in the device's
+ * /export/traces format. --replay <file> instead replays traces (eg
+ * downloaded from a device) through AlkMeasurer, and reports any that don't
+ * come out the same as they did when recorded.
+ *******************************/
+struct SimOptions {
+    float hours = 2;
+    float alkalinityDKH = sim_inputs::sampleConf.alkalinityDKH;
+    uint32_t measureEveryMin = 60;
+    // load, in requests a second
+    uint32_t mqttPerSec = 0;
+    uint32_t webPerSec = 0;
+    uint32_t seed = sim_inputs::probeConf.seed;
+    // 0 to only advance time for doses & delays
+    float cpuScale = 0;
+    bool quiet = false;
+
+    const char *recordPath = nullptr;
+    const char *replayPath = nullptr;
+};
+
+// so the first measurement starts with the pH stats settled
+const uint32_t FIRST_MEASUREMENT_AFTER_MS = 60 * 1000;
+const char *const LOAD_TOPIC = "sim/load";
+
+using Scheduler = richiev::scheduling::Scheduler<16, 64>;
+using richiev::scheduling::Pacing;
+
+/*******************************
+ * Shared vars
+ *******************************/
+SimOptions options;
+
+std::unique_ptr<sim::TitrationSample> sample;
+std::unique_ptr<sim::SimulatedPHProbe> probe;
+
+auto outbox = std::make_shared<richiev::mqtt::DefaultOutbox>();
+auto inbox = std::make_shared<richiev::mqtt::DefaultInbox>();
+auto mqttPublisher = std::make_shared<mqtt::MQTTPublisher>(outbox);
+auto publisher = std::make_shared<events::BusPublisher>(mqttPublisher);
+auto timeClient = std::make_shared<buff_time::TimeWrapper>();
+
+richiev::mqtt::TopicDispatcher<> dispatcher;
+
+richiev::SPSCQueue<ph::PHReading, 8> uiPHReadings;
+richiev::SPSCQueue<alk_measure::AlkReading, 4> uiAlkReadings;
+reading_store::ReadingStore readingStore(reading_store::READINGS_TO_KEEP);
+
+Scheduler processScheduler(micros);
+Scheduler uiScheduler(micros);
+Scheduler networkScheduler(micros);
+
+/*******************************
+ * Results
+ *******************************/
+std::vector<alk_measure::AlkReading> alkReadings;
+std::vector<unsigned long> measurementDurationsMS;
+uint32_t loopbackMessages = 0;
+uint32_t loadMessages = 0;
+uint32_t webPages = 0;
+uint64_t webBytes = 0;
+// the measurements' traces, as /export/traces would serve them
+std::string recordedTraces;
+
+/*******************************
+ * Setup
+ *******************************/
+std::shared_ptr<doser::BuffDosers> setupDosers() {
+    auto buffDosers = std::make_shared<doser::BuffDosers>(0);
+    const std::pair<MeasurementDoserType, DoserConfig> configs[] = {
+        {MeasurementDoserType::FILL, inputs::fillDoserConfig},
+        {MeasurementDoserType::REAGENT, inputs::reagentDoserConfig},
+        {MeasurementDoserType::DRAIN, inputs::drainDoserConfig}};
+
+    for (const auto &typeConfig : configs) {
+        auto doser = std::make_shared<sim::SimulatedDoser>(typeConfig.second, sim::hostClock());
+        doser->calibrator = std::make_unique<doser::Calibrator>(typeConfig.second.mlPerFullRotation);
+        doser->doseDuration = metrics::doseDurationFor(typeConfig.first);
+        sample->connect(*doser, typeConfig.first);
+        buffDosers->emplace(typeConfig.first, doser);
+    }
+    return buffDosers;
+}
+
+void buildHandlers() {
+    controller::registerMeasurementHandlers(dispatcher);
+
+    // stands in for the traffic the device sees from other clients
+    dispatcher.on(LOAD_TOPIC, [](const richiev::mqtt::Payload &payload) {
+        commands::SmallCommandDoc doc;
+        if (commands::parse(payload, doc).ok()) loadMessages++;
+    });
+}
+
+void setup() {
+    if (options.quiet) Serial.setOutput(nullptr);
+
+    sim::SampleConfig sampleConf = sim_inputs::sampleConf;
+    sampleConf.alkalinityDKH = options.alkalinityDKH;
+    sim::ProbeConfig probeConf = sim_inputs::probeConf;
+    probeConf.seed = options.seed;
+
+    // the simulated probe stands in for the I2C pH board
+    sample = std::make_unique<sim::TitrationSample>(sampleConf);
+    sample->addTankWater(inputs::alkMeasureConf.measurementTankWaterVolumeML);
+    probe = std::make_unique<sim::SimulatedPHProbe>(*sample, sim::hostClock(), probeConf);
+    const ph::PHReadConfig phReadConfig = {
+        .readIntervalMS = inputs::PH_READ_INTERVAL_MS,
+        .phReadFunc = []() { return probe->read(); }};
+    controller::phReader = std::make_shared<ph::controller::PHReader>(phReadConfig, sim_inputs::phCalibrator);
+    controller::publisher = publisher;
+    controller::timeClient = timeClient;
+
+    auto &alkMeasurer = controller::alkMeasurer;
+    alkMeasurer = std::make_shared<alk_measure::AlkMeasurer>(setupDosers(), inputs::alkMeasureConf, controller::phReader);
+    controller::onAutoMeasurementDone = [](unsigned long durationMS) { measurementDurationsMS.push_back(durationMS); };
+    richiev::metrics::profileContext() = controller::describeProfileContext;
+    if (options.recordPath != nullptr) {
+        auto traceRecorder = std::make_shared<measurement_trace::TraceRecorder>();
+        traceRecorder->onFinished = [](const std::string &title, const uint8_t *data, size_t length) {
+            measurement_trace::writeExportRecord(recordedTraces, title.c_str(), title.size(), data, length);
+        };
+        alkMeasurer->traceTo(traceRecorder);
+    }
+    buildHandlers();
+
+    events::phReadings.subscribe([](const ph::PHReading &reading) {
+        if (!uiPHReadings.push(reading)) metrics::taskQueueDropped.increment();
+    });
+    events::alkReadings.subscribe([](const alk_measure::AlkReading &reading) {
+        if (!uiAlkReadings.push(reading)) metrics::taskQueueDropped.increment();
+    });
+    events::mirrorReadingsTo(mqttPublisher);
+}
+
+/*******************************
+ * Process jobs
+ * (the rest are controller-common.h's)
+ *******************************/
+void dispatchCommands() {
+    richiev::metrics::ProfileScope profile(metrics::mqttSubsystemDuration);
+    richiev::mqtt::InboxMessage message;
+    while (inbox->pop(message)) {
+        dispatcher.dispatch(message.topic, {.data = message.payload, .length = message.length});
+    }
+}
+
+/*******************************
+ * UI & network jobs
+ *******************************/
+void applyReadings() {
+    richiev::metrics::ProfileScope profile(metrics::readingsSubsystemDuration);
+
+    ph::PHReading phReading;
+    while (uiPHReadings.pop(phReading)) {
+        readingStore.addPHReading(phReading);
+    }
+
+    alk_measure::AlkReading reading;
+    while (uiAlkReadings.pop(reading)) {
+        alkReadings.push_back(reading);
+        readingStore.addAlkReading({.asOfAdjustedSec = reading.asOfAdjustedSec,
+                                    .alkReadingDKH = reading.alkReadingDKH,
+                                    .title = reading.title});
+    }
+}
+
+// what a browser on the root page costs
+void serveWeb() {
+    richiev::metrics::ProfileScope profile(metrics::webSubsystemDuration);
+    const auto readings = readingStore.getReadingsSortedByAsOf();
+    std::string page;
+    web_server::renderRoot(page, controller::currentMeasurementDurationMS.load(), web_server::TriggerVal::NA, timeClient->getAdjustedTimeSeconds(), millis(),
+                           readings, readingStore.getRecentTitles(readings), readingStore.getMostRecentPHReading());
+    webPages++;
+    webBytes += page.size();
+}
+
+// stands in for the web server's loop, serving the browsers' requests
+// (--web a second) as they come due. Browsers give up on any held up longer
+// than WEB_REQUEST_TIMEOUT_MS (eg behind a blocking dose).
+const uint32_t WEB_REQUEST_TIMEOUT_MS = 5 * 1000;
+uint64_t nextWebRequestAtMS = 0;
+
+void loopWeb() {
+    if (options.webPerSec == 0) return;
+    if (millis() > nextWebRequestAtMS + WEB_REQUEST_TIMEOUT_MS) nextWebRequestAtMS = millis();
+    while (millis() >= nextWebRequestAtMS) {
+        serveWeb();
+        nextWebRequestAtMS += 1000 / options.webPerSec;
+    }
+}
+
+void sendLoad() {
+    static const char payload[] = R"({"enabled":true})";
+    inbox->push(LOAD_TOPIC, payload, sizeof(payload) - 1);
+}
+
+// what home automation does, over MQTT
+void triggerMeasurement() {
+    publisher->publishMeasureAlk("sim", millis());
+}
+
+// the loopback broker, hands anything the device subscribes to (exact topics
+// only, the sim's handlers have no wildcards) straight back to it
+void drainOutbox() {
+    richiev::metrics::ProfileScope profile(metrics::networkSubsystemDuration);
+    outbox->drain(millis(), [](const char *topic, const char *payload, const size_t length) {
+        const auto &filters = dispatcher.filters();
+        if (std::find(filters.begin(), filters.end(), topic) != filters.end()) {
+            loopbackMessages++;
+            inbox->push(topic, payload, length);
+        }
+        return true;
+    });
+}
+
+void registerJobs() {
+    // the device's own schedules (no display or OTA here)
+    controller::registerProcessJobs(processScheduler, dispatchCommands);
+    controller::registerUIJobs(uiScheduler, {.applyReadings = applyReadings, .loopWeb = loopWeb});
+    controller::registerNetworkJobs(networkScheduler, drainOutbox);
+
+    // stand-ins for home automation & other clients
+    uiScheduler.every("trigger", options.measureEveryMin * 60 * 1000, triggerMeasurement, 0, Pacing::FIXED_RATE, FIRST_MEASUREMENT_AFTER_MS);
+    if (options.mqttPerSec > 0) uiScheduler.every("load", 1000 / options.mqttPerSec, sendLoad);
+}
+
+/*******************************
+ * Main loop
+ *******************************/
+// Like tasks.h's scheduled tasks, except rather than sleeping until the next
+// deadline, time just jumps there
+void run(const uint64_t untilMS) {
+    auto &clock = sim::hostClock();
+    while (clock.nowMS() < untilMS) {
+        processScheduler.runDue(millis());
+        uiScheduler.runDue(millis());
+        networkScheduler.runDue(millis());
+
+        const uint32_t sleepMS = std::min({processScheduler.msUntilNextDeadline(millis()),
+                                           uiScheduler.msUntilNextDeadline(millis()),
+                                           networkScheduler.msUntilNextDeadline(millis())});
+        clock.advanceMS(sleepMS > 0 ? sleepMS : 1);
+    }
+}
+
+/*******************************
+ * Report
+ *******************************/
+void reportJobs(const char *taskName, const Scheduler &scheduler) {
+    scheduler.forEachJob([taskName](const richiev::scheduling::Job &job) {
+        printf("  task=%s job=%s runs=%u overruns=%u skipped=%u max_duration_us=%u max_lateness_ms=%u\n",
+               taskName, job.name, job.stats.runs, job.stats.overruns, job.stats.skipped, job.stats.maxDurationUS, job.stats.maxLatenessMS);
+    });
+}
+
+void report(const double wallS) {
+    const double simulatedS = sim::hostClock().nowUS() / 1e6;
+    printf("\nSimulated %.2fh in %.3fs (%.0fx real time)\n", simulatedS / 3600, wallS, wallS > 0 ? simulatedS / wallS : 0);
+
+    printf("\nMeasurements (tank at %.2f dKH), triggers ignored while measuring=%u\n", options.alkalinityDKH, metrics::measurementTriggersIgnored.value());
+    for (size_t i = 0; i < alkReadings.size(); i++) {
+        const auto &reading = alkReadings[i];
+        printf("  at_s=%lu alk_dkh=%.2f error_dkh=%+.2f reagent_ml=%.2f", reading.asOfMS / 1000, reading.alkReadingDKH,
+               reading.alkReadingDKH - options.alkalinityDKH, reading.reagentVolumeML);
+        if (i < measurementDurationsMS.size()) printf(" took_s=%lu", measurementDurationsMS[i] / 1000);
+        printf("\n");
+    }
+
+    printf("\nJobs\n");
+    reportJobs("process", processScheduler);
+    reportJobs("ui", uiScheduler);
+    reportJobs("network", networkScheduler);
+
+    const auto &stats = outbox->stats();
+    printf("\nMQTT published=%u dropped=%u coalesced=%u looped_back=%u load_dispatched=%u inbox_dropped=%u\n",
+           stats.published.load(), stats.dropped.load(), stats.coalesced.load(), loopbackMessages, loadMessages, inbox->dropped());
+    printf("Web pages=%u bytes=%llu\n", webPages, (unsigned long long)webBytes);
+
+    std::string profile;
+    richiev::metrics::renderProfileReport(profile);
+    printf("\n%s", profile.c_str());
+}
+
+bool writeFile(const char *path, const std::string &contents) {
+    FILE *out = fopen(path, "wb");
+    if (out == nullptr) {
+        perror(path);
+        return false;
+    }
+    const bool written = fwrite(contents.data(), 1, contents.size(), out) == contents.size();
+    fclose(out);
+    return written;
+}
+
+/*******************************
+ * Replay
+ *******************************/
+// true if every trace replayed the same as it was recorded
+bool replayTraces(const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (in == nullptr) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), in)) > 0;) data.insert(data.end(), buffer, buffer + read);
+    fclose(in);
+
+    std::vector<measurement_trace::Trace> traces;
+    if (!measurement_trace::decodeExport(data.data(), data.size(), traces)) {
+        fprintf(stderr, "%s: unreadable trace after %zu good ones\n", path, traces.size());
+    }
+
+    size_t matched = 0;
+    for (const auto &trace : traces) {
+        printf("title=%s started_at=%lu samples=%u events=%zu alk_dkh=%.2f", trace.title.c_str(), trace.startedAtAdjustedSec,
+               trace.numSamples, trace.events.size(), trace.alkReadingDKH);
+        if (trace.truncated()) printf(" truncated");
+
+        sim::ReplayResult result;
+        if (!sim::replay(trace, result)) {
+            printf(" unsupported_samples\n");
+            continue;
+        }
+        printf(" replayed_alk_dkh=%.2f", result.replayed.alkReadingDKH);
+        if (result.ranOutOfSamples) printf(" ran_out_of_samples");
+        if (result.divergedAt >= 0) printf(" diverged_at=%ld", result.divergedAt);
+        printf(" %s\n", result.matches ? "match" : "MISMATCH");
+        if (result.matches) matched++;
+    }
+    printf("\nReplayed %zu traces, %zu matched\n", traces.size(), matched);
+    return matched == traces.size();
+}
+
+bool parseArgs(const int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+            continue;
+        }
+        if (value == nullptr) return false;
+        i++;
+
+        if (strcmp(arg, "--hours") == 0) {
+            options.hours = atof(value);
+        } else if (strcmp(arg, "--alk") == 0) {
+            options.alkalinityDKH = atof(value);
+        } else if (strcmp(arg, "--measure-every-min") == 0) {
+            options.measureEveryMin = atoi(value);
+        } else if (strcmp(arg, "--mqtt") == 0) {
+            options.mqttPerSec = atoi(value);
+        } else if (strcmp(arg, "--web") == 0) {
+            options.webPerSec = atoi(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = atoi(value);
+        } else if (strcmp(arg, "--cpu-scale") == 0) {
+            options.cpuScale = atof(value);
+        } else if (strcmp(arg, "--record") == 0) {
+            options.recordPath = value;
+        } else if (strcmp(arg, "--replay") == 0) {
+            options.replayPath = value;
+        } else {
+            return false;
+        }
+    }
+    return options.hours > 0 && options.measureEveryMin > 0 && options.mqttPerSec <= 1000 && options.webPerSec <= 1000 && options.cpuScale >= 0;
+}
+
+}  // namespace host_sim
+}  // namespace buff
+
+int main(int argc, char **argv) {
+    using namespace buff::host_sim;
+    if (!parseArgs(argc, argv)) {
+        fprintf(stderr, "usage: %s [--hours 2] [--alk 8] [--measure-every-min 60] [--mqtt msgs/s] [--web pages/s] [--seed 1] [--cpu-scale 0] [--quiet] [--record file | --replay file]\n", argv[0]);
+        return 1;
+    }
+    if (options.replayPath != nullptr) {
+        if (options.quiet) Serial.setOutput(nullptr);
+        return replayTraces(options.replayPath) ? 0 : 2;
+    }
+
+    const auto startedAt = std::chrono::steady_clock::now();
+    setup();
+    registerJobs();
+    buff::sim::chargeHostCPU(options.cpuScale);
+    run(options.hours * 3600 * 1000);
+    const std::chrono::duration<double> wall = std::chrono::steady_clock::now() - startedAt;
+
+    report(wall.count());
+    if (options.recordPath != nullptr && !writeFile(options.recordPath, recordedTraces)) return 1;
+    return 0;
+}
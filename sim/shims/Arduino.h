@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Buff Libraries
+#include "../../src/sim/virtual-clock.h"
+
+/*******************************
+ * Host Arduino shim
+ *
+ * Just enough of the Arduino core for the firmware (and the stepper libraries
+ * it pulls in) to build on the host, for the simulator (see
+ * sim/host-sim.cpp). Time comes from a virtual clock, so delay() takes no
+ * real time, and pins go nowhere.
+ *******************************/
+namespace buff {
+namespace sim {
+
+inline VirtualClock &hostClock() {
+    static VirtualClock clock;
+    return clock;
+}
+
+// Host time spent running code, charged to the virtual clock at a scale (eg
+// how much slower the ESP32 is) so jobs take time too. Off by default, which
+// keeps runs exactly repeatable.
+struct HostCPUCharge {
+    double scale = 0;
+    std::chrono::steady_clock::time_point last;
+    double carryUS = 0;
+};
+
+inline HostCPUCharge &hostCPUCharge() {
+    static HostCPUCharge charge;
+    return charge;
+}
+
+inline void chargeHostCPU(const double scale) {
+    auto &charge = hostCPUCharge();
+    charge.scale = scale;
+    charge.last = std::chrono::steady_clock::now();
+    charge.carryUS = 0;
+}
+
+inline uint64_t hostNowUS() {
+    auto &charge = hostCPUCharge();
+    if (charge.scale > 0) {
+        const auto now = std::chrono::steady_clock::now();
+        const double spentUS = std::chrono::duration<double, std::micro>(now - charge.last).count() * charge.scale + charge.carryUS;
+        charge.last = now;
+        charge.carryUS = spentUS - (uint64_t)spentUS;
+        hostClock().advanceUS((uint64_t)spentUS);
+    }
+    return hostClock().nowUS();
+}
+
+}  // namespace sim
+}  // namespace buff
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+/*******************************
+ * Time
+ *******************************/
+inline unsigned long millis() { return buff::sim::hostNowUS() / 1000; }
+inline unsigned long micros() { return (unsigned long)buff::sim::hostNowUS(); }
+
+inline void delay(const unsigned long ms) { buff::sim::hostClock().advanceMS(ms); }
+inline void delayMicroseconds(const unsigned int us) { buff::sim::hostClock().advanceUS(us); }
+inline void yield() {}
+
+/*******************************
+ * Pins
+ *******************************/
+inline void pinMode(const uint8_t pin, const uint8_t mode) {}
+inline void digitalWrite(const uint8_t pin, const uint8_t val) {}
+inline int digitalRead(const uint8_t pin) { return LOW; }
+inline void analogWrite(const uint8_t pin, const int value) {}
+
+/*******************************
+ * Math
+ *******************************/
+template <typename T, typename L, typename H>
+inline T constrain(const T x, const L low, const H high) {
+    return x < low ? low : (x > high ? high : x);
+}
+
+using std::max;
+using std::min;
+
+/*******************************
+ * Serial
+ *
+ * Prints to stdout, or nowhere once quietened.
+ *******************************/
+class HostSerial {
+   private:
+    FILE *_out = stdout;
+
+    template <typename T>
+    size_t printInteger(const T value) {
+        if (_out == nullptr) return 0;
+        return fprintf(_out, "%s", std::to_string(value).c_str());
+    }
+
+   public:
+    void begin(const unsigned long baud) {}
+    void flush() {
+        if (_out != nullptr) fflush(_out);
+    }
+
+    void setOutput(FILE *out) { _out = out; }
+
+    size_t write(const uint8_t *buffer, const size_t size) {
+        if (_out == nullptr) return 0;
+        return fwrite(buffer, 1, size, _out);
+    }
+    size_t write(const uint8_t c) { return write(&c, 1); }
+
+    size_t print(const char *s) { return _out == nullptr ? 0 : fputs(s, _out); }
+    size_t print(const char c) { return write((uint8_t)c); }
+    size_t print(const int n) { return printInteger(n); }
+    size_t print(const unsigned int n) { return printInteger(n); }
+    size_t print(const long n) { return printInteger(n); }
+    size_t print(const unsigned long n) { return printInteger(n); }
+    size_t print(const long long n) { return printInteger(n); }
+    size_t print(const unsigned long long n) { return printInteger(n); }
+    // like Arduino, 2 places by default
+    size_t print(const double n, const int digits = 2) { return _out == nullptr ? 0 : fprintf(_out, "%.*f", digits, n); }
+
+    size_t println() { return print("\r\n"); }
+    template <typename T>
+    size_t println(const T value) {
+        return print(value) + println();
+    }
+
+    size_t printf(const char *format, ...) {
+        if (_out == nullptr) return 0;
+        va_list args;
+        va_start(args, format);
+        const int written = vfprintf(_out, format, args);
+        va_end(args);
+        return written;
+    }
+};
+
+inline HostSerial Serial;
@@ -0,0 +1,29 @@
+#pragma once
+
+// Buff Libraries
+#include "inputs-common.h"
+#include "readings/ph.h"
+#include "sim/titration.h"
+
+namespace buff {
+namespace sim_inputs {
+
+/*******************************
+ * Simulator inputs
+ *
+ * What src/inputs.h sets up for a board, for the host simulator. The doser
+ * and measurement settings are the device's own (src/inputs-common.h).
+ *******************************/
+const char *const hostname = "reef-buff-sim";
+
+// the simulated probe reads true, like a freshly calibrated one
+const ph::PHCalibrator::CalibrationPoint phHighPoint = {.actualPH = 7.0, .readPH = 7.0};
+const ph::PHCalibrator::CalibrationPoint phLowPoint = {.actualPH = 4.0, .readPH = 4.0};
+const ph::PHCalibrator phCalibrator(phLowPoint, phHighPoint);
+
+// the tank being measured
+const sim::SampleConfig sampleConf = {.alkalinityDKH = 8.0, .initialPH = 8.2, .reagentStrengthMoles = 0.1};
+const sim::ProbeConfig probeConf = {.lagS = 5.0, .noisePH = 0.005, .seed = 1};
+
+}  // namespace sim_inputs
+}  // namespace buff
@@ -1,6 +1,7 @@
 #ifdef DISPLAY_MKS_TS24_TOUCH
 #include <Arduino.h>
 #include <SPI.h>
+#include <esp_heap_caps.h>
 
 #include "buff-displays/monitoring-display.h"
 
@@ -41,8 +42,20 @@ auto static tft = TFT_eSPI(SCREEN_WIDTH, TS24_HEIGHT);
 
 static bool displaySetupFully = false;
 
+// The fraction of the screen LVGL draws at a time, in each of its two buffers.
+// Smaller means less RAM but more flushes for a full screen redraw.
+#ifndef DISPLAY_DRAW_BUF_DIVISOR
+#define DISPLAY_DRAW_BUF_DIVISOR 10
+#endif
+static const uint32_t DRAW_BUF_PIXELS = (uint32_t)SCREEN_WIDTH * SCREEN_HEIGHT / DISPLAY_DRAW_BUF_DIVISOR;
+static_assert(DRAW_BUF_PIXELS < 32767, "pushPixelsDMA can only send 32767 pixels at a time");
+// if the heap's too fragmented for that, a few lines at a time
+static const uint32_t FALLBACK_DRAW_BUF_PIXELS = (uint32_t)SCREEN_WIDTH * 10;
+
 static lv_disp_draw_buf_t drawBuf;
-static lv_color_t buf[SCREEN_WIDTH * 10];
+static lv_disp_drv_t dispDrv;
+// the display's SPI transaction is held open across DMA flushes, see flushCB
+static bool displayWriting = false;
 
 lv_obj_t* timeLabel;
 lv_obj_t* phLabel;
@@ -54,20 +67,57 @@ lv_obj_t* debugRawPHLabel;
 
 std::shared_ptr<mqtt::Publisher> publisher;
 
-/* Display flushing */
+/* Display flushing
+ *
+ * LVGL renders into one buffer while the other is sent to the display by DMA.
+ * flushCB only starts the transfer, LVGL's told the buffer's free again from
+ * the DMA completion interrupt (flushDone), so a full screen redraw doesn't
+ * hold up rendering (or the rest of the UI task) while the pixels go out.
+ */
+void flushDone() {
+    lv_disp_flush_ready(&dispDrv);
+}
+
 void flushCB(lv_disp_drv_t* disp, const lv_area_t* area, lv_color_t* color_p) {
     uint32_t w = (area->x2 - area->x1 + 1);
     uint32_t h = (area->y2 - area->y1 + 1);
 
-    tft.startWrite();
-    tft.setAddrWindow(area->x1, area->y1, w, h);
-    tft.pushColors((uint16_t*)&color_p->full, w * h, true);
-    tft.endWrite();
+    // the colours are already byte swapped by LVGL (LV_COLOR_16_SWAP)
+    if (!tft.DMA_Enabled) {
+        tft.startWrite();
+        tft.setAddrWindow(area->x1, area->y1, w, h);
+        tft.pushColors((uint16_t*)&color_p->full, w * h, false);
+        tft.endWrite();
+
+        lv_disp_flush_ready(disp);
+        return;
+    }
 
-    lv_disp_flush_ready(disp);
+    // CS has to stay low until the transfer's done, so the transaction's only
+    // ended when the bus is needed for something else (see touchReadCB)
+    if (!displayWriting) {
+        tft.startWrite();
+        displayWriting = true;
+    }
+    tft.setAddrWindow(area->x1, area->y1, w, h);
+    tft.pushColorsDMA((uint16_t*)&color_p->full, w * h, false);
 }
 
 void touchReadCB(lv_indev_drv_t* indev_driver, lv_indev_data_t* data) {
+    // zeroed, so released until the first reading
+    static lv_indev_data_t lastTouch = {};
+
+    // the touch controller shares the display's SPI bus, rather than wait for
+    // a flush to finish go with the last reading
+    if (tft.dmaBusy()) {
+        *data = lastTouch;
+        return;
+    }
+    if (displayWriting) {
+        tft.endWrite();
+        displayWriting = false;
+    }
+
     uint16_t touchX, touchY;
 
     bool touched = tft.getTouch(&touchX, &touchY, 600);
@@ -83,6 +133,7 @@ void touchReadCB(lv_indev_drv_t* indev_driver, lv_indev_data_t* data) {
         data->point.x = touchX;
         data->point.y = touchY;
     }
+    lastTouch = *data;
 }
 
 void event_handler(lv_event_t* e) {
@@ -143,25 +194,44 @@ void tftSetup() {
 #endif
 
     tft.initDMA();
+    tft.setDMACompleteCallback(flushDone);
 
     uint16_t calData[5] = {275, 3620, 264, 3532, 1};
     tft.setTouch(calData);
 }
 
-void lvSetup() {
+// false if there isn't even room for the fallback draw buffer
+bool lvSetup() {
     lv_init();
 
-    lv_disp_draw_buf_init(&drawBuf, buf, NULL, SCREEN_WIDTH * 10);
+    // DMA capable, allocated once for good
+    uint32_t bufPixels = DRAW_BUF_PIXELS;
+    auto buf1 = (lv_color_t*)heap_caps_malloc(bufPixels * sizeof(lv_color_t), MALLOC_CAP_DMA);
+    if (buf1 == nullptr) {
+        bufPixels = FALLBACK_DRAW_BUF_PIXELS;
+        buf1 = (lv_color_t*)heap_caps_malloc(bufPixels * sizeof(lv_color_t), MALLOC_CAP_DMA);
+        Serial.print("Not enough memory for the draw buffers, drawing ");
+        Serial.print(bufPixels);
+        Serial.println(" pixels at a time");
+    }
+    if (buf1 == nullptr) {
+        Serial.println("Not enough memory for any draw buffer, the display won't be used");
+        return false;
+    }
+    auto buf2 = (lv_color_t*)heap_caps_malloc(bufPixels * sizeof(lv_color_t), MALLOC_CAP_DMA);
+    if (buf2 == nullptr) {
+        Serial.println("Not enough memory for a second draw buffer, rendering will wait for each flush");
+    }
+    lv_disp_draw_buf_init(&drawBuf, buf1, buf2, bufPixels);
 
     /*Initialize the display*/
-    static lv_disp_drv_t disp_drv;
-    lv_disp_drv_init(&disp_drv);
+    lv_disp_drv_init(&dispDrv);
     /*Change the following line to your display resolution*/
-    disp_drv.hor_res = SCREEN_WIDTH;
-    disp_drv.ver_res = SCREEN_HEIGHT;
-    disp_drv.flush_cb = flushCB;
-    disp_drv.draw_buf = &drawBuf;
-    lv_disp_drv_register(&disp_drv);
+    dispDrv.hor_res = SCREEN_WIDTH;
+    dispDrv.ver_res = SCREEN_HEIGHT;
+    dispDrv.flush_cb = flushCB;
+    dispDrv.draw_buf = &drawBuf;
+    lv_disp_drv_register(&dispDrv);
 
     /*Initialize the (dummy) input device driver*/
     static lv_indev_drv_t indev_drv;
@@ -169,6 +239,7 @@ void lvSetup() {
     indev_drv.type = LV_INDEV_TYPE_POINTER;
     indev_drv.read_cb = touchReadCB;
     lv_indev_drv_register(&indev_drv);
+    return true;
 }
 
 void enableDisplayHardware() {
@@ -302,6 +373,10 @@ void refreshReadingList(const std::vector<std::reference_wrapper<alk_measure::Pe
 }
 
 void updateDisplay(std::shared_ptr<reading_store::ReadingStore> readingStore) {
+    if (!displaySetupFully) {
+        return;
+    }
+
     auto alkReadings = readingStore->getReadingsSortedByAsOf();
 
     refreshTriggerList(readingStore->getRecentTitles(alkReadings));
@@ -313,12 +388,11 @@ void setupDisplay(std::shared_ptr<reading_store::ReadingStore> readingStore, std
 
     enableDisplayHardware();
     tftSetup();
-    lvSetup();
+    if (!lvSetup()) return;
 
     createMainPage();
-    updateDisplay(readingStore);
-
     displaySetupFully = true;
+    updateDisplay(readingStore);
 }
 
 // TODO: move this to a shared helper
@@ -356,6 +430,9 @@ void displayPH(const float rawPH, const float calibratedPH, const float rawPH_mv
 }
 
 void loopDisplay() {
+    if (!displaySetupFully) {
+        return;
+    }
     lv_timer_handler();
 }
 
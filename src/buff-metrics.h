@@ -0,0 +1,97 @@
+#pragma once
+
+#include "metrics.h"
+#include "profiler.h"
+
+// Buff Libraries
+#include "doser/doser-config.h"
+
+namespace buff {
+namespace metrics {
+using richiev::metrics::Counter;
+using richiev::metrics::Histogram;
+using richiev::metrics::FAST_BUCKETS_US;
+using richiev::metrics::SLOW_BUCKETS_US;
+
+/*******************************
+ * Subsystems
+ * (per job scheduling stats are in tasks.h)
+ *******************************/
+#define BUFF_SUBSYSTEM_HELP "Time spent per run of each subsystem"
+#define BUFF_SUBSYSTEM(var, name) \
+    inline richiev::metrics::ProfiledSection var("buff_subsystem_duration_seconds", BUFF_SUBSYSTEM_HELP, name, FAST_BUCKETS_US, "subsystem=\"" name "\"");
+
+BUFF_SUBSYSTEM(phSubsystemDuration, "ph")
+BUFF_SUBSYSTEM(controllerSubsystemDuration, "controller")
+BUFF_SUBSYSTEM(webSubsystemDuration, "web")
+BUFF_SUBSYSTEM(displaySubsystemDuration, "display")
+BUFF_SUBSYSTEM(readingsSubsystemDuration, "readings")
+BUFF_SUBSYSTEM(mqttSubsystemDuration, "mqtt")
+BUFF_SUBSYSTEM(networkSubsystemDuration, "network")
+BUFF_SUBSYSTEM(otaSubsystemDuration, "ota")
+
+#undef BUFF_SUBSYSTEM
+
+/*******************************
+ * Readings
+ *******************************/
+inline Histogram phReadDuration("buff_ph_read_duration_seconds", "Time taken to read a pH value from the probe", FAST_BUCKETS_US);
+
+#define BUFF_STEP_HELP "Time spent executing a measurement step, by phase"
+inline Histogram primeStepDuration("buff_measurement_step_duration_seconds", BUFF_STEP_HELP, SLOW_BUCKETS_US, "phase=\"PRIME\"");
+inline Histogram cleanAndFillStepDuration("buff_measurement_step_duration_seconds", BUFF_STEP_HELP, SLOW_BUCKETS_US, "phase=\"CLEAN_AND_FILL\"");
+inline Histogram measureStepDuration("buff_measurement_step_duration_seconds", BUFF_STEP_HELP, SLOW_BUCKETS_US, "phase=\"MEASURE\"");
+inline Histogram cleanupStepDuration("buff_measurement_step_duration_seconds", BUFF_STEP_HELP, SLOW_BUCKETS_US, "phase=\"CLEANUP\"");
+
+inline Counter measurementTriggersIgnored("buff_measurement_triggers_ignored_total", "Measurement triggers ignored because one was already running");
+
+/*******************************
+ * Dosers
+ *******************************/
+#define BUFF_DOSE_HELP "Time taken to complete a single dose"
+inline Histogram fillDoseDuration("buff_dose_duration_seconds", BUFF_DOSE_HELP, SLOW_BUCKETS_US, "doser=\"fill\"");
+inline Histogram drainDoseDuration("buff_dose_duration_seconds", BUFF_DOSE_HELP, SLOW_BUCKETS_US, "doser=\"drain\"");
+inline Histogram reagentDoseDuration("buff_dose_duration_seconds", BUFF_DOSE_HELP, SLOW_BUCKETS_US, "doser=\"reagent\"");
+
+static Histogram* doseDurationFor(const MeasurementDoserType doserType) {
+    switch (doserType) {
+        case MeasurementDoserType::FILL:
+            return &fillDoseDuration;
+        case MeasurementDoserType::DRAIN:
+            return &drainDoseDuration;
+        case MeasurementDoserType::REAGENT:
+            return &reagentDoseDuration;
+        default:
+            return nullptr;
+    }
+}
+
+/*******************************
+ * Tasks
+ *******************************/
+inline Counter taskQueueDropped("buff_task_queue_dropped_total", "Values dropped because a cross task queue was full");
+inline Counter oversizedMessagesDropped("buff_mqtt_oversized_dropped_total", "Messages dropped because they didn't fit in an outbox slot");
+
+/*******************************
+ * Storage
+ *******************************/
+inline Counter nvsWrites("buff_nvs_writes_total", "Number of values written to NVS (flash wear)");
+
+/*******************************
+ * Heap
+ *******************************/
+#ifdef ARDUINO_ARCH_ESP32
+inline richiev::metrics::CallbackGauge heapFree("buff_heap_free_bytes", "Currently free heap", []() -> int32_t { return ESP.getFreeHeap(); });
+inline richiev::metrics::CallbackGauge heapMinFree("buff_heap_min_free_bytes", "Lowest free heap since boot", []() -> int32_t { return ESP.getMinFreeHeap(); });
+inline richiev::metrics::CallbackGauge heapLargestBlock("buff_heap_largest_free_block_bytes", "Largest allocatable heap block (fragmentation)", []() -> int32_t { return ESP.getMaxAllocHeap(); });
+// 0 when the free heap is one contiguous block
+inline richiev::metrics::CallbackGauge heapFragmentation("buff_heap_fragmentation_percent", "How much of the free heap is outside the largest block", []() -> int32_t {
+    const uint32_t freeBytes = ESP.getFreeHeap();
+    return freeBytes > 0 ? 100 - (int32_t)((uint64_t)ESP.getMaxAllocHeap() * 100 / freeBytes) : 0;
+});
+// should hover around 0, a steady negative drift means measurements are leaking/fragmenting
+inline richiev::metrics::Gauge measurementHeapDelta("buff_measurement_heap_delta_bytes", "Change in free heap over the last completed measurement");
+#endif
+
+}  // namespace metrics
+}  // namespace buff
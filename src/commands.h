@@ -0,0 +1,218 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <cstring>
+#include <string>
+
+// Buff Libraries
+#include "mqtt-dispatch.h"
+#include "mqtt-outbox.h"
+#include "readings/alk-measure-common.h"
+
+/*******************************
+ * Command decoding
+ *
+ * Commands are parsed straight from the received payload into a document
+ * sized at compile time from the command's schema, and problems (bad JSON,
+ * wrongly typed values, running out of room) are reported rather than
+ * quietly falling back to defaults. Unknown fields are logged and ignored,
+ * so senders can be newer than the firmware.
+ *******************************/
+namespace buff {
+namespace commands {
+
+using richiev::mqtt::Payload;
+
+struct DecodeStatus {
+    // nullptr when decoding succeeded
+    const char *error = nullptr;
+    // the offending field, if any
+    char field[40] = {0};
+
+    bool ok() const { return error == nullptr; }
+
+    static DecodeStatus failed(const char *error, const char *field = nullptr) {
+        DecodeStatus status;
+        status.error = error;
+        if (field != nullptr) {
+            strncpy(status.field, field, sizeof(status.field) - 1);
+        }
+        return status;
+    }
+};
+
+static void printDecodeError(const char *topic, const DecodeStatus &status) {
+    Serial.print("Rejecting command on topic=");
+    Serial.print(topic);
+    Serial.print(", error=");
+    Serial.print(status.error);
+    if (status.field[0] != 0) {
+        Serial.print(", field=");
+        Serial.print(status.field);
+    }
+    Serial.println();
+}
+
+/*******************************
+ * Schemas
+ *******************************/
+// The payload is read only, so ArduinoJson copies keys and strings into the document
+#define COUNT_ALK_CONFIG_FIELD(name, type) +1
+#define ALK_CONFIG_KEY_BYTES(name, type) +JSON_STRING_SIZE(sizeof(#name) - 1)
+
+const size_t ALK_CONFIG_FIELD_COUNT = 0 ALK_MEASUREMENT_CONFIG_FIELDS(COUNT_ALK_CONFIG_FIELD);
+const size_t ALK_CONFIG_KEYS_SIZE = 0 ALK_MEASUREMENT_CONFIG_FIELDS(ALK_CONFIG_KEY_BYTES);
+
+#undef COUNT_ALK_CONFIG_FIELD
+#undef ALK_CONFIG_KEY_BYTES
+
+// titles are truncated once decoded, but allow some slack in the payload
+const size_t MAX_TITLE_PAYLOAD_LEN = 64;
+
+// room for a few unknown fields (eg from a newer sender), so they can be
+// logged. Any more & they're filtered out as the payload's parsed instead.
+const size_t UNKNOWN_FIELDS_SIZE = JSON_OBJECT_SIZE(4) + 4 * JSON_STRING_SIZE(24);
+
+// every config field, plus title and asOf
+const size_t MEASURE_ALK_DOC_SIZE = JSON_OBJECT_SIZE(ALK_CONFIG_FIELD_COUNT + 2) + ALK_CONFIG_KEYS_SIZE +
+                                    JSON_STRING_SIZE(sizeof("title") - 1) + JSON_STRING_SIZE(MAX_TITLE_PAYLOAD_LEN) +
+                                    JSON_STRING_SIZE(sizeof("asOf") - 1) + UNKNOWN_FIELDS_SIZE;
+
+// The longest a measure alk command can be, with every field (the widest
+// number's 24 chars), a full length title & no whitespace. It has to make it
+// through the inbox.
+const size_t MAX_NUMBER_PAYLOAD_LEN = 24;
+#define ALK_CONFIG_FIELD_PAYLOAD_LEN(name, type) +(sizeof(#name) - 1 + sizeof("\"\":,") - 1 + MAX_NUMBER_PAYLOAD_LEN)
+const size_t MAX_MEASURE_ALK_PAYLOAD_LEN = sizeof("{}") - 1 ALK_MEASUREMENT_CONFIG_FIELDS(ALK_CONFIG_FIELD_PAYLOAD_LEN) +
+                                           sizeof("\"title\":\"\",") - 1 + MAX_TITLE_PAYLOAD_LEN +
+                                           sizeof("\"asOf\":") - 1 + MAX_NUMBER_PAYLOAD_LEN;
+#undef ALK_CONFIG_FIELD_PAYLOAD_LEN
+
+static_assert(MAX_MEASURE_ALK_PAYLOAD_LEN < richiev::mqtt::MAX_INBOX_PAYLOAD_LEN, "A full measure alk command has to fit in the inbox");
+
+// the debug & config commands, a handful of short scalar fields
+const size_t SMALL_COMMAND_DOC_SIZE = JSON_OBJECT_SIZE(4) + 4 * JSON_STRING_SIZE(24);
+using SmallCommandDoc = StaticJsonDocument<SMALL_COMMAND_DOC_SIZE>;
+
+/*******************************
+ * Decoding
+ *******************************/
+// Parses the payload into doc, which must end up being an object. An empty
+// payload is treated as an empty object (eg debug/restart sends nothing).
+static DecodeStatus parse(const Payload &payload, JsonDocument &doc, const JsonDocument *filter = nullptr) {
+    if (payload.length == 0) {
+        doc.to<JsonObject>();
+        return DecodeStatus();
+    }
+
+    DeserializationError error = filter == nullptr
+                                     ? deserializeJson(doc, payload.data, payload.length)
+                                     : deserializeJson(doc, payload.data, payload.length, DeserializationOption::Filter(*filter));
+    if (error) {
+        return DecodeStatus::failed(error.c_str());
+    }
+    if (!doc.is<JsonObject>()) {
+        return DecodeStatus::failed("expected an object");
+    }
+    return DecodeStatus();
+}
+
+template <typename T>
+DecodeStatus readField(JsonObjectConst obj, const char *name, T &target) {
+    JsonVariantConst value = obj[name];
+    // absent, keep what's already there
+    if (value.isNull()) return DecodeStatus();
+    if (!value.is<T>()) return DecodeStatus::failed("wrong type", name);
+
+    target = value.as<T>();
+    return DecodeStatus();
+}
+
+static DecodeStatus readField(JsonObjectConst obj, const char *name, std::string &target) {
+    JsonVariantConst value = obj[name];
+    if (value.isNull()) return DecodeStatus();
+    if (!value.is<const char *>()) return DecodeStatus::failed("wrong type", name);
+
+    target = value.as<const char *>();
+    return DecodeStatus();
+}
+
+static bool isAlkConfigField(const char *key) {
+#define ALK_CONFIG_FIELD_MATCHES(name, type) \
+    if (strcmp(key, #name) == 0) return true;
+    ALK_MEASUREMENT_CONFIG_FIELDS(ALK_CONFIG_FIELD_MATCHES)
+#undef ALK_CONFIG_FIELD_MATCHES
+    return false;
+}
+
+static bool isMeasureAlkField(const char *key) {
+    return isAlkConfigField(key) || strcmp(key, "title") == 0 || strcmp(key, "asOf") == 0;
+}
+
+// keeps only the measure alk command's fields, the keys are literals so aren't copied
+using MeasureAlkFilterDoc = StaticJsonDocument<JSON_OBJECT_SIZE(ALK_CONFIG_FIELD_COUNT + 2)>;
+
+static void buildMeasureAlkFilter(MeasureAlkFilterDoc &filter) {
+#define ALK_CONFIG_FIELD_FILTER(name, type) filter[#name] = true;
+    ALK_MEASUREMENT_CONFIG_FIELDS(ALK_CONFIG_FIELD_FILTER)
+#undef ALK_CONFIG_FIELD_FILTER
+    filter["title"] = true;
+    filter["asOf"] = true;
+}
+
+struct MeasureAlkCommand {
+    alk_measure::AlkMeasurementConfig config;
+    std::string title;
+    bool hasAsOf = false;
+    unsigned long asOf = 0;
+};
+
+// Decodes a measure alk command, starting from the given default config and
+// overriding whichever fields the payload has
+static DecodeStatus decodeMeasureAlk(const Payload &payload, const alk_measure::AlkMeasurementConfig &defaults, MeasureAlkCommand &command) {
+    const char *noMemory = DeserializationError(DeserializationError::NoMemory).c_str();
+
+    StaticJsonDocument<MEASURE_ALK_DOC_SIZE> doc;
+    DecodeStatus status = parse(payload, doc);
+    if (!status.ok() && strcmp(status.error, noMemory) == 0) {
+        // too many unknown fields to keep, drop them all as it's parsed
+        Serial.println("Ignoring the measure alk command's unknown fields");
+        MeasureAlkFilterDoc filter;
+        buildMeasureAlkFilter(filter);
+        status = parse(payload, doc, &filter);
+        // the known fields always fit, apart from a title that's too long
+        if (!status.ok() && strcmp(status.error, noMemory) == 0) return DecodeStatus::failed("title too long", "title");
+    }
+    if (!status.ok()) return status;
+
+    JsonObjectConst obj = doc.as<JsonObjectConst>();
+    for (JsonPairConst kv : obj) {
+        const char *key = kv.key().c_str();
+        if (!isMeasureAlkField(key)) {
+            Serial.print("Ignoring the measure alk command's unknown field=");
+            Serial.println(key);
+        }
+    }
+
+    command.config = defaults;
+#define ALK_CONFIG_FIELD_READ(name, type)                      \
+    status = readField<type>(obj, #name, command.config.name); \
+    if (!status.ok()) return status;
+    ALK_MEASUREMENT_CONFIG_FIELDS(ALK_CONFIG_FIELD_READ)
+#undef ALK_CONFIG_FIELD_READ
+
+    status = readField(obj, "title", command.title);
+    if (!status.ok()) return status;
+    if (command.title.size() > MAX_TITLE_PAYLOAD_LEN) return DecodeStatus::failed("title too long", "title");
+
+    command.hasAsOf = obj.containsKey("asOf");
+    status = readField<unsigned long>(obj, "asOf", command.asOf);
+    if (!status.ok()) return status;
+
+    return DecodeStatus();
+}
+
+}  // namespace commands
+}  // namespace buff
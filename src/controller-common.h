@@ -0,0 +1,305 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+// Buff Libraries
+#include "buff-metrics.h"
+#include "commands.h"
+#include "mqtt-common.h"
+#include "mqtt-dispatch.h"
+#include "ph-controller.h"
+#include "profiler.h"
+#include "readings/alk-measure.h"
+#include "readings/reading-store.h"
+#include "scheduler.h"
+#include "time-common.h"
+
+namespace buff {
+namespace controller {
+
+/*******************************
+ * Controller common
+ *
+ * The measurement side of the controller: the measurement command handlers,
+ * pH acquisition & the auto measurement's steps, and every task's job
+ * schedule. No hardware in here, so the host simulator (sim/host-sim.cpp)
+ * runs exactly what the device does; controller.h & main.cpp add the
+ * device's own handlers, job bodies & setup.
+ *******************************/
+const unsigned int AUTO_PH_SAMPLE_COUNT = 15;
+const unsigned int MANUAL_PH_SAMPLE_COUNT = 10;
+const unsigned int ALK_STEP_INTERVAL_MS = 1000;
+const uint32_t NETWORK_PERIOD_MS = 10;
+// new worst cases over this are logged as they're noticed
+const uint32_t STALL_LOG_THRESHOLD_US = 100 * 1000;
+const size_t STANDARD_PH_MAVG_LENGTH = 30;
+
+using richiev::mqtt::Payload;
+
+/*******************************
+ * Shared vars
+ *******************************/
+inline std::shared_ptr<alk_measure::AlkMeasurer> alkMeasurer = nullptr;
+inline std::shared_ptr<ph::controller::PHReader> phReader = nullptr;
+inline std::shared_ptr<mqtt::Publisher> publisher = nullptr;
+inline std::shared_ptr<buff_time::TimeWrapper> timeClient = nullptr;
+
+inline ph::controller::PHReadingStats<STANDARD_PH_MAVG_LENGTH> phReadingStats;
+
+// Everything a measurement needs lives in these (and on the stack), not the
+// heap, so weeks of measurements don't fragment it. Emptied in one go when the
+// measurement is done.
+inline std::optional<alk_measure::AlkMeasureLooper<AUTO_PH_SAMPLE_COUNT>> autoMeasureLooper;
+inline std::optional<alk_measure::AlkMeasureLooper<MANUAL_PH_SAMPLE_COUNT>> manualMeasureLooper;
+
+// Process task, as auto measurements begin & once they're done and cleared
+// away (eg for the heap metrics)
+inline void (*onAutoMeasurementBegun)() = nullptr;
+inline void (*onAutoMeasurementDone)(unsigned long durationMS) = nullptr;
+
+/*******************************
+ * Measurements
+ *******************************/
+template <size_t N>
+void debugOutputAction(const alk_measure::MeasurementStepResult<N>& stepResult) {
+    Serial.print("nextAction=");
+    Serial.print(alk_measure::MEASUREMENT_ACTION_TO_NAME.at(stepResult.nextAction).c_str());
+    Serial.print("(");
+    Serial.print(stepResult.nextAction);
+    Serial.print("), nextMeasurementStepAction=");
+    Serial.print(alk_measure::MEASUREMENT_STEP_ACTION_TO_NAME.at(stepResult.nextMeasurementStepAction).c_str());
+    Serial.print("(");
+    Serial.print(stepResult.nextMeasurementStepAction);
+    Serial.print("), numPHReadings=");
+    if (stepResult.measuredPHStats) {
+        Serial.print(stepResult.measuredPHStats->readingCount());
+    } else {
+        Serial.print(0);
+    }
+    Serial.print("), calibratedPH_mavg=");
+    Serial.print(stepResult.alkReading.phReading.calibratedPH_mavg);
+    Serial.print(", reagentVolumeML=");
+    Serial.print(stepResult.alkReading.reagentVolumeML);
+    Serial.print(", alkReadingDKH=");
+    Serial.print(stepResult.alkReading.alkReadingDKH);
+}
+
+inline unsigned long lastMeasureAsOf = 0;
+
+template <typename F>
+void runAfterIdempotenceCheck(const unsigned long asOf, F&& f) {
+    if (asOf <= lastMeasureAsOf) {
+        Serial.print("Refusing to trigger because of time mismatch (idempotence check). asOf=");
+        Serial.print(asOf);
+        Serial.print("<= lastMeasureAsOf=");
+        Serial.print(lastMeasureAsOf);
+        Serial.println();
+    } else {
+        f();
+    }
+}
+
+inline void beginAutoMeasurement(const alk_measure::AlkMeasurementConfig& config, const std::string& title) {
+    if (onAutoMeasurementBegun != nullptr) onAutoMeasurementBegun();
+    alk_measure::beginAlkMeasureLoop(autoMeasureLooper, alkMeasurer, publisher, timeClient, config, title);
+}
+
+template <typename Dispatcher>
+void registerMeasurementHandlers(Dispatcher& dispatcher) {
+    dispatcher.on(mqtt::measureAlk, [](const Payload& payload) {
+        Serial.println("Executing an alk measurement");
+        if (alkMeasurer == nullptr) return;  // TODO: raise
+        if (autoMeasureLooper) {
+            // TODO: should this work this way? Should I reset?
+            metrics::measurementTriggersIgnored.increment();
+            return;
+        }
+
+        commands::MeasureAlkCommand command;
+        auto status = commands::decodeMeasureAlk(payload, alkMeasurer->getDefaultAlkMeasurementConfig(), command);
+        if (!status.ok()) {
+            commands::printDecodeError(mqtt::measureAlk.c_str(), status);
+            return;
+        }
+
+        auto title = command.title.substr(0, reading_store::MAX_TITLE_LEN);
+        auto asOf = command.hasAsOf ? command.asOf : millis();
+        runAfterIdempotenceCheck(asOf, [&]() {
+            beginAutoMeasurement(command.config, title);
+        });
+    });
+
+    dispatcher.on("execute/measure_alk/manual/begin", [](const Payload& payload) {
+        Serial.println("Preparing to begin a manual alk measurement");
+        if (alkMeasurer == nullptr) return;  // TODO: raise
+
+        commands::MeasureAlkCommand command;
+        auto status = commands::decodeMeasureAlk(payload, alkMeasurer->getDefaultAlkMeasurementConfig(), command);
+        if (!status.ok()) {
+            commands::printDecodeError("execute/measure_alk/manual/begin", status);
+            return;
+        }
+
+        auto title = command.title.substr(0, reading_store::MAX_TITLE_LEN);
+        alk_measure::beginAlkMeasureLoop(manualMeasureLooper, alkMeasurer, publisher, timeClient, command.config, title);
+
+        Serial.print("Alk measurement begin completed, ");
+        debugOutputAction(manualMeasureLooper->getLastStepResult());
+        Serial.print(", ");
+        Serial.write((const uint8_t*)payload.data, payload.length);
+        Serial.println();
+    });
+
+    dispatcher.on("execute/measure_alk/manual/next_step", [](const Payload& payload) {
+        if (!manualMeasureLooper) return;  // TODO: raise
+
+        Serial.print("Performing next alk measurement step, ");
+        debugOutputAction(manualMeasureLooper->getLastStepResult());
+        Serial.println();
+
+        auto result = manualMeasureLooper->nextStep();
+        Serial.print("Alk measurement step completed, ");
+        debugOutputAction(result);
+        Serial.println();
+    });
+}
+
+/*******************************
+ * Measurement progress
+ *
+ * Published by the process task for the others.
+ *******************************/
+// for the web server's progress display
+inline std::atomic<unsigned long> currentMeasurementDurationMS{0};
+
+// what the measurement's doing, for the profiler's worst case captures. The
+// action is in the high half & the step action in the low half, so they're
+// always read as a pair.
+const uint32_t MEASUREMENT_IDLE = UINT32_MAX;
+inline std::atomic<uint32_t> currentMeasurementActions{MEASUREMENT_IDLE};
+
+inline uint32_t packMeasurementActions(const alk_measure::MeasurementAction action, const alk_measure::MeasurementStepAction stepAction) {
+    return ((uint32_t)action << 16) | ((uint32_t)stepAction & 0xFFFF);
+}
+
+template <typename K>
+const char* nameOr(const std::map<K, std::string>& names, const K key) {
+    const auto found = names.find(key);
+    return found == names.end() ? "?" : found->second.c_str();
+}
+
+inline void describeProfileContext(char* out, const size_t size) {
+    const uint32_t actions = currentMeasurementActions.load(std::memory_order_relaxed);
+    if (actions == MEASUREMENT_IDLE) {
+        snprintf(out, size, "idle");
+        return;
+    }
+    snprintf(out, size, "%s/%s",
+             nameOr(alk_measure::MEASUREMENT_ACTION_TO_NAME, (alk_measure::MeasurementAction)(actions >> 16)),
+             nameOr(alk_measure::MEASUREMENT_STEP_ACTION_TO_NAME, (alk_measure::MeasurementStepAction)(actions & 0xFFFF)));
+}
+
+/*******************************
+ * Process jobs
+ *******************************/
+inline void readPH() {
+    richiev::metrics::ProfileScope profile(metrics::phSubsystemDuration);
+    auto phReading = phReader->readNewPHSignalWithStats<STANDARD_PH_MAVG_LENGTH>(phReadingStats);
+    phReading.asOfAdjustedSec = timeClient->getAdjustedTimeSeconds();
+    publisher->publishPH(phReading);
+}
+
+inline void loopAlkMeasurement(unsigned long loopAsOf) {
+    if (autoMeasureLooper) {
+        Serial.print(loopAsOf);
+        Serial.print(" Performing measurement step");
+        auto& result = autoMeasureLooper->nextStep();
+        Serial.print(loopAsOf);
+        Serial.println(" Completed measurement step");
+        debugOutputAction(result);
+        if (result.nextAction == alk_measure::MeasurementAction::MEASURE_DONE) {
+            Serial.println("Completed measurement loop");
+            const unsigned long durationMS = result.asOfMS - result.measurementStartedAtMS;
+            autoMeasureLooper.reset();
+            if (onAutoMeasurementDone != nullptr) onAutoMeasurementDone(durationMS);
+        }
+    }
+}
+
+// every ALK_STEP_INTERVAL_MS after the previous step finished
+inline void stepAlkMeasurement() {
+    richiev::metrics::ProfileScope profile(metrics::controllerSubsystemDuration);
+    loopAlkMeasurement(millis());
+
+    unsigned long currentDurationMS = 0;
+    uint32_t actions = MEASUREMENT_IDLE;
+    if (autoMeasureLooper) {
+        const auto& lastStep = autoMeasureLooper->getLastStepResult();
+        currentDurationMS = lastStep.asOfMS - lastStep.measurementStartedAtMS;
+        actions = packMeasurementActions(lastStep.nextAction, lastStep.nextMeasurementStepAction);
+    }
+    currentMeasurementDurationMS.store(currentDurationMS, std::memory_order_relaxed);
+    currentMeasurementActions.store(actions, std::memory_order_relaxed);
+}
+
+// dosers, pH acquisition & measurements. dispatchCommands runs the received
+// commands' handlers, wherever they're queued.
+template <typename Scheduler>
+void registerProcessJobs(Scheduler& process, richiev::scheduling::JobFunc dispatchCommands) {
+    using richiev::scheduling::Pacing;
+
+    process.every("ph", phReader->getReadIntervalMS(), readPH, 50 * 1000);
+    process.every("commands", 20, dispatchCommands, 5 * 1000);
+    // steps block while dosing, so no budget, and space them from when the last one finished
+    process.every("measurement", ALK_STEP_INTERVAL_MS, stepAlkMeasurement, 0, Pacing::FIXED_DELAY);
+}
+
+/*******************************
+ * UI & network jobs
+ *******************************/
+inline void logStalls() {
+    richiev::metrics::forEachNewStall(STALL_LOG_THRESHOLD_US, [](const richiev::metrics::ProfiledSection& section, const richiev::metrics::WorstCase& worst) {
+        Serial.print("Stall section=");
+        Serial.print(section.section);
+        Serial.print(", duration_us=");
+        Serial.print(worst.durationUS);
+        Serial.print(", at_ms=");
+        Serial.print(worst.atMS);
+        Serial.print(", context=");
+        Serial.println(worst.context);
+    });
+}
+
+// What the UI task runs. The host has no display or OTA, so leaves those null.
+struct UIJobs {
+    richiev::scheduling::JobFunc applyReadings;
+    richiev::scheduling::JobFunc loopWeb;
+    richiev::scheduling::JobFunc loopDisplay = nullptr;
+    richiev::scheduling::JobFunc loopOTA = nullptr;
+};
+
+// web server, display, OTA & the reading store
+template <typename Scheduler>
+void registerUIJobs(Scheduler& ui, const UIJobs& jobs) {
+    if (jobs.loopDisplay != nullptr) ui.every("display", 10, jobs.loopDisplay, 10 * 1000);
+    ui.every("web", 20, jobs.loopWeb, 20 * 1000);
+    ui.every("readings", 100, jobs.applyReadings, 20 * 1000);
+    if (jobs.loopOTA != nullptr) ui.every("ota", 100, jobs.loopOTA, 5 * 1000);
+    ui.every("stalls", 5000, logStalls, 5 * 1000);
+}
+
+// MQTT in & out, whatever carries it
+template <typename Scheduler>
+void registerNetworkJobs(Scheduler& network, richiev::scheduling::JobFunc loopNetwork) {
+    network.every("network", NETWORK_PERIOD_MS, loopNetwork, 5 * 1000);
+}
+
+}  // namespace controller
+}  // namespace buff
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <optional>
 // Arduino Libraries
 #include <ArduinoJson.h>
 #include <TinyMqtt.h>
@@ -9,7 +11,11 @@
 
 // Buff Libraries
 #include "buff-displays/monitoring-display.h"
+#include "buff-metrics.h"
+#include "commands.h"
+#include "controller-common.h"
 #include "doser/doser.h"
+#include "event-bus.h"
 #include "inputs.h"
 #include "readings/alk-measure.h"
 
@@ -19,167 +25,105 @@
 
 #include "mqtt-common.h"
 #include "mqtt.h"
+#include "network-task.h"
+#include "profiler.h"
 #include "readings/reading-store.h"
+#include "readings/trace-store.h"
+#include "spsc-queue.h"
 #include "time-common.h"
 #include "web-server.h"
 
 namespace buff {
 namespace controller {
 
-const unsigned int AUTO_PH_SAMPLE_COUNT = 15;
-const unsigned int MANUAL_PH_SAMPLE_COUNT = 10;
-const unsigned int ALK_STEP_INTERVAL_MS = 1000;
-
 /*******************************
  * Handlers
  *******************************/
-using TopicProcessorMap = std::map<std::string,
-                                   std::function<void(const std::string& payload)>>;
-TopicProcessorMap topicsToProcessor;
+// debug/* handlers can be switched off as a group via config/debugHandlers
+const uint8_t DEBUG_HANDLER_GROUP = 1;
 
-std::shared_ptr<alk_measure::AlkMeasurer> alkMeasurer = nullptr;
 std::shared_ptr<doser::BuffDosers> buffDosersPtr = nullptr;
-std::shared_ptr<mqtt::Publisher> publisher = nullptr;
-std::shared_ptr<buff_time::TimeWrapper> timeClient = nullptr;
 
 std::unique_ptr<web_server::BuffWebServer> webServer;
 std::shared_ptr<reading_store::ReadingStore> readingStore;
 
-std::unique_ptr<alk_measure::AlkMeasureLooper<AUTO_PH_SAMPLE_COUNT>> autoMeasureLooper = nullptr;
-std::unique_ptr<alk_measure::AlkMeasureLooper<MANUAL_PH_SAMPLE_COUNT>> manualMeasureLooper = nullptr;
+using CommandDoc = commands::SmallCommandDoc;
 
-StaticJsonDocument<200> parseInput(const std::string payload) {
-    StaticJsonDocument<200> doc;
-    DeserializationError error = deserializeJson(doc, payload);
+// free heap when the running auto measurement began, see measurementHeapDelta
+int32_t measurementStartFreeHeap = 0;
 
-    if (error) {
-        Serial.print(F("deserializeJson() failed: "));
-        Serial.println(error.f_str());
+bool parseInput(const char* topic, const Payload& payload, JsonDocument& doc) {
+    auto status = commands::parse(payload, doc);
+    if (!status.ok()) {
+        commands::printDecodeError(topic, status);
     }
-    return doc;
-}
-
-ph::PHReading parsePH(const StaticJsonDocument<200> doc) {
-    ph::PHReading reading = {
-        .asOfMS = doc["asOf"].as<ulong>(),
-        .asOfAdjustedSec = doc["asOfAdjustedSec"].as<ulong>(),
-
-        .rawPH = doc["rawPH"].as<float>(),
-        .rawPH_mavg = doc["rawPH_mavg"].as<float>(),
-
-        .calibratedPH = doc["calibratedPH"].as<float>(),
-        .calibratedPH_mavg = doc["calibratedPH_mavg"].as<float>()};
-
-    return reading;
+    return status.ok();
 }
 
 void debugOutputPH(const ph::PHReading& reading) {
     monitoring_display::displayPH(reading.rawPH, reading.calibratedPH, reading.rawPH_mavg, reading.calibratedPH_mavg, reading.asOfMS, reading.asOfAdjustedSec);
 }
 
-void debugOutputAlk(const StaticJsonDocument<200> doc, const std::string& payload) {
+void debugOutputAlk(const alk_measure::AlkReading& reading) {
     Serial.println("Calculated alk ");
     Serial.print("alkReadingDKH=");
-    Serial.print(doc["alkReadingDKH"].as<float>());
-    Serial.print(", ");
-    Serial.print(payload.c_str());
-    Serial.println();
-}
-
-template <size_t N>
-void debugOutputAction(const alk_measure::MeasurementStepResult<N>& stepResult) {
-    Serial.print("nextAction=");
-    Serial.print(alk_measure::MEASUREMENT_ACTION_TO_NAME.at(stepResult.nextAction).c_str());
-    Serial.print("(");
-    Serial.print(stepResult.nextAction);
-    Serial.print("), nextMeasurementStepAction=");
-    Serial.print(alk_measure::MEASUREMENT_STEP_ACTION_TO_NAME.at(stepResult.nextMeasurementStepAction).c_str());
-    Serial.print("(");
-    Serial.print(stepResult.nextMeasurementStepAction);
-    Serial.print("), numPHReadings=");
-    if (stepResult.measuredPHStats) {
-        Serial.print(stepResult.measuredPHStats->readingCount());
-    } else {
-        Serial.print(0);
-    }
-    Serial.print("), calibratedPH_mavg=");
-    Serial.print(stepResult.alkReading.phReading.calibratedPH_mavg);
+    Serial.print(reading.alkReadingDKH);
     Serial.print(", reagentVolumeML=");
-    Serial.print(stepResult.alkReading.reagentVolumeML);
-    Serial.print(", alkReadingDKH=");
-    Serial.print(stepResult.alkReading.alkReadingDKH);
+    Serial.print(reading.reagentVolumeML);
+    Serial.print(", title=");
+    Serial.print(reading.title.c_str());
+    Serial.println();
 }
 
-std::shared_ptr<doser::Doser> selectDoser(doser::BuffDosers& buffDosers, const StaticJsonDocument<200>& doc) {
+std::shared_ptr<doser::Doser> selectDoser(doser::BuffDosers& buffDosers, const JsonDocument& doc) {
     auto doserString = doc["doser"].as<std::string>();
     auto measurementDoserType = doser::lookupMeasurementDoserType(doserString);
     return buffDosers.selectDoser(measurementDoserType);
 }
 
-unsigned long lastMeasureAsOf = 0;
+std::unique_ptr<richiev::mqtt::Dispatcher> buildHandlers(doser::BuffDosers& buffDosers) {
+    auto dispatcherPtr = std::make_unique<richiev::mqtt::Dispatcher>();
+    auto& dispatcher = *dispatcherPtr;
 
-void runAfterIdempotenceCheck(const unsigned long asOf, std::function<void()> f) {
-    if (asOf <= lastMeasureAsOf) {
-        Serial.print("Refusing to trigger because of time mismatch (idempotence check). asOf=");
-        Serial.print(asOf);
-        Serial.print("<= lastMeasureAsOf=");
-        Serial.print(lastMeasureAsOf);
-        Serial.println();
-    } else {
-        f();
-    }
-}
-
-#define LOAD_FROM_DOC(target, name, type)    \
-    if (doc.containsKey(#name)) {            \
-        target.name = doc[#name].as<type>(); \
-    }
+    dispatcher.on("debug/restart", [&](const Payload& payload) {
+        Serial.println("Restarting");
+        ESP.restart();
+    }, DEBUG_HANDLER_GROUP);
 
-alk_measure::AlkMeasurementConfig buildAlkMeasureConfig(const StaticJsonDocument<200>& doc) {
-    auto beginAlkMeasureConf = alkMeasurer->getDefaultAlkMeasurementConfig();
-    LOAD_FROM_DOC(beginAlkMeasureConf, primeTankWaterFillVolumeML, float);
-    LOAD_FROM_DOC(beginAlkMeasureConf, primeReagentReverseVolumeML, float);
-    LOAD_FROM_DOC(beginAlkMeasureConf, primeReagentVolumeML, float);
-    LOAD_FROM_DOC(beginAlkMeasureConf, measurementTankWaterVolumeML, float);
-    LOAD_FROM_DOC(beginAlkMeasureConf, extraPurgeVolumeML, float);
-    LOAD_FROM_DOC(beginAlkMeasureConf, initialReagentDoseVolumeML, float);
-    LOAD_FROM_DOC(beginAlkMeasureConf, incrementalReagentDoseVolumeML, float);
-    LOAD_FROM_DOC(beginAlkMeasureConf, stirAmountML, float);
-    LOAD_FROM_DOC(beginAlkMeasureConf, stirTimes, int);
-    LOAD_FROM_DOC(beginAlkMeasureConf, reagentStrengthMoles, float);
-    if (doc.containsKey("reagentStrengthMoles")) {
-        beginAlkMeasureConf.reagentStrengthMoles = doc["reagentStrengthMoles"].as<float>();
-    }
-    return beginAlkMeasureConf;
-}
+    // {"reset": true} to start looking for stalls afresh
+    dispatcher.on("debug/profile", [&](const Payload& payload) {
+        CommandDoc doc;
+        if (!parseInput("debug/profile", payload, doc)) return;
 
-std::unique_ptr<richiev::mqtt::TopicProcessorMap> buildHandlers(doser::BuffDosers& buffDosers) {
-    auto topicsToProcessorPtr = std::make_unique<richiev::mqtt::TopicProcessorMap>();
-    auto& topicsToProcessor = *topicsToProcessorPtr;
+        std::string report;
+        richiev::metrics::renderProfileReport(report);
+        Serial.print(report.c_str());
+        network::requestProfileReport();
 
-    topicsToProcessor["debug/restart"] = [&](const std::string& payload) {
-        Serial.println("Restarting");
-        ESP.restart();
-    };
+        if (doc["reset"].as<bool>()) {
+            richiev::metrics::resetProfileWorstCases();
+        }
+    }, DEBUG_HANDLER_GROUP);
 
-    topicsToProcessor["debug/clear"] = [&](const std::string& payload) {
+    dispatcher.on("debug/clear", [&](const Payload& payload) {
         Serial.println("Clearing settings out");
         nvs_flash_erase();
         nvs_flash_init();
-    };
+    }, DEBUG_HANDLER_GROUP);
 
-    topicsToProcessor["debug/dosers/disable"] = [&](const std::string& payload) {
+    dispatcher.on("debug/dosers/disable", [&](const Payload& payload) {
         Serial.println("Disabling doser stepper");
         buffDosersPtr->disableDosers();
-    };
+    }, DEBUG_HANDLER_GROUP);
 
-    topicsToProcessor["debug/dosers/enable"] = [&](const std::string& payload) {
+    dispatcher.on("debug/dosers/enable", [&](const Payload& payload) {
         Serial.println("Enabling doser stepper");
         buffDosersPtr->enableDosers();
-    };
+    }, DEBUG_HANDLER_GROUP);
 
-    topicsToProcessor["debug/triggerML"] = [&](const std::string& payload) {
-        auto doc = parseInput(payload);
+    dispatcher.on("debug/triggerML", [&](const Payload& payload) {
+        CommandDoc doc;
+        if (!parseInput("debug/triggerML", payload, doc)) return;
         auto doser = selectDoser(*buffDosersPtr, doc);
 
         buffDosersPtr->enableDosers();
@@ -191,34 +135,37 @@ std::unique_ptr<richiev::mqtt::TopicProcessorMap> buildHandlers(doser::BuffDoser
         } else {
             doser->doseML(outputML);
         }
-    };
+    }, DEBUG_HANDLER_GROUP);
 
-    topicsToProcessor["debug/triggerSteps"] = [&](const std::string& payload) {
-        auto doc = parseInput(payload);
+    dispatcher.on("debug/triggerSteps", [&](const Payload& payload) {
+        CommandDoc doc;
+        if (!parseInput("debug/triggerSteps", payload, doc)) return;
         auto doser = selectDoser(*buffDosersPtr, doc);
 
         buffDosersPtr->enableDosers();
 
         auto steps = doc.containsKey("steps") ? doc["steps"].as<int>() : 200;
         doser->debugRotateSteps(steps);
-    };
+    }, DEBUG_HANDLER_GROUP);
 
-    topicsToProcessor["debug/stirrer/disable"] = [&](const std::string& payload) {
+    dispatcher.on("debug/stirrer/disable", [&](const Payload& payload) {
         analogWrite(inputs::PIN_CONFIG.STIRRER_PIN, 0);
-    };
+    }, DEBUG_HANDLER_GROUP);
 
-    topicsToProcessor["debug/stirrer/enable"] = [&](const std::string& payload) {
-        auto doc = parseInput(payload);
+    dispatcher.on("debug/stirrer/enable", [&](const Payload& payload) {
+        CommandDoc doc;
+        if (!parseInput("debug/stirrer/enable", payload, doc)) return;
         int value = inputs::PIN_CONFIG.STIRRER_PWM_VALUE;
         if (doc.containsKey("value")) {
             value = doc["value"].as<int>();
         }
 
         analogWrite(inputs::PIN_CONFIG.STIRRER_PIN, value);
-    };
+    }, DEBUG_HANDLER_GROUP);
 
-    topicsToProcessor["debug/triggerRotations"] = [&](const std::string& payload) {
-        auto doc = parseInput(payload);
+    dispatcher.on("debug/triggerRotations", [&](const Payload& payload) {
+        CommandDoc doc;
+        if (!parseInput("debug/triggerRotations", payload, doc)) return;
         auto doser = selectDoser(*buffDosersPtr, doc);
 
         int degreesRotation = 0;
@@ -232,62 +179,13 @@ std::unique_ptr<richiev::mqtt::TopicProcessorMap> buildHandlers(doser::BuffDoser
 
         Serial << "Outputting via degreesRotation=" << degreesRotation << endl;
         doser->debugRotateDegrees(degreesRotation);
-    };
-
-    topicsToProcessor[mqtt::measureAlk] = [&](const std::string& payload) {
-        Serial.println("Executing an alk measurement");
-        if (alkMeasurer == nullptr) return;        // TODO: raise
-        if (autoMeasureLooper != nullptr) return;  // TODO: should this work this way? Should I reset?
-
-        auto doc = parseInput(payload);
-        auto beginAlkMeasureConf = buildAlkMeasureConfig(doc);
-
-        auto title = doc["title"].as<std::string>();
-        title = title.substr(0, reading_store::MAX_TITLE_LEN);
-
-        auto asOf = millis();
-        if (doc.containsKey("asOf")) {
-            asOf = doc["asOf"].as<unsigned long>();
-        }
-        runAfterIdempotenceCheck(asOf, [&]() {
-            autoMeasureLooper = std::move(alk_measure::beginAlkMeasureLoop<AUTO_PH_SAMPLE_COUNT>(alkMeasurer, publisher, timeClient, beginAlkMeasureConf, title));
-        });
-    };
-
-    topicsToProcessor["execute/measure_alk/manual/begin"] = [&](const std::string& payload) {
-        Serial.println("Preparing to begin a manual alk measurement");
-        if (alkMeasurer == nullptr) return;  // TODO: raise
-
-        auto doc = parseInput(payload);
-        auto beginAlkMeasureConf = buildAlkMeasureConfig(doc);
-
-        auto title = doc["title"].as<std::string>();
-        title = title.substr(0, reading_store::MAX_TITLE_LEN);
+    }, DEBUG_HANDLER_GROUP);
 
-        manualMeasureLooper = std::move(alk_measure::beginAlkMeasureLoop<MANUAL_PH_SAMPLE_COUNT>(alkMeasurer, publisher, timeClient, beginAlkMeasureConf, title));
+    registerMeasurementHandlers(dispatcher);
 
-        Serial.print("Alk measurement begin completed, ");
-        debugOutputAction(manualMeasureLooper->getLastStepResult());
-        Serial.print(", ");
-        Serial.print(payload.c_str());
-        Serial.println();
-    };
-
-    topicsToProcessor["execute/measure_alk/manual/next_step"] = [&](const std::string& payload) {
-        if (manualMeasureLooper == nullptr) return;  // TODO: raise
-
-        Serial.print("Performing next alk measurement step, ");
-        debugOutputAction(manualMeasureLooper->getLastStepResult());
-        Serial.println();
-
-        auto result = manualMeasureLooper->nextStep();
-        Serial.print("Alk measurement step completed, ");
-        debugOutputAction(result);
-        Serial.println();
-    };
-
-    topicsToProcessor["config/mlPerFullRotation"] = [&](const std::string& payload) {
-        auto doc = parseInput(payload);
+    dispatcher.on("config/mlPerFullRotation", [&](const Payload& payload) {
+        CommandDoc doc;
+        if (!parseInput("config/mlPerFullRotation", payload, doc)) return;
         auto doser = selectDoser(*buffDosersPtr, doc);
 
         const auto newML = doc["ml"].as<float>();
@@ -295,52 +193,111 @@ std::unique_ptr<richiev::mqtt::TopicProcessorMap> buildHandlers(doser::BuffDoser
                << " to=" << newML << endl;
         auto calibr = std::make_unique<doser::Calibrator>(newML);
         doser->calibrator = std::move(calibr);
-    };
+    });
+
+    // the dispatcher outlives the handlers, but dispatcherPtr doesn't
+    auto* dispatcherRaw = dispatcherPtr.get();
+    dispatcher.on("config/debugHandlers", [dispatcherRaw](const Payload& payload) {
+        CommandDoc doc;
+        if (!parseInput("config/debugHandlers", payload, doc)) return;
+        const bool enabled = doc["enabled"].as<bool>();
+        Serial << "Setting debug handlers enabled=" << enabled << endl;
+        dispatcherRaw->setGroupEnabled(DEBUG_HANDLER_GROUP, enabled);
+    });
+
+    Serial << "Initialized topic_handler_count=" << dispatcher.handlerCount() << endl;
+    return std::move(dispatcherPtr);
+}
 
-    topicsToProcessor[mqtt::phRead] = [](const std::string& payload) {
-        auto doc = parseInput(payload);
+/*******************************
+ * Cross task queues
+ *
+ * Readings are produced on the process task, but the store & display belong
+ * to the UI task; web triggered measurements go the other way.
+ *******************************/
+richiev::SPSCQueue<ph::PHReading, 8> uiPHReadings;
+richiev::SPSCQueue<alk_measure::AlkReading, 4> uiAlkReadings;
+richiev::SPSCQueue<alk_measure::TriggerRequest, 4> feedRequests;
 
-        ph::PHReading reading = parsePH(doc);
-        debugOutputPH(reading);
-        readingStore->addPHReading(reading);
-    };
+/*******************************
+ * Local reading consumers
+ *******************************/
+void subscribeToReadings() {
+    events::phReadings.subscribe([](const ph::PHReading& reading) {
+        if (!uiPHReadings.push(reading)) metrics::taskQueueDropped.increment();
+    });
+
+    events::alkReadings.subscribe([](const alk_measure::AlkReading& reading) {
+        if (!uiAlkReadings.push(reading)) metrics::taskQueueDropped.increment();
+    });
+}
 
-    topicsToProcessor[mqtt::alkRead] = [](const std::string& payload) {
-        auto doc = parseInput(payload);
+// On the UI task
+void applyReadings() {
+    richiev::metrics::ProfileScope profile(metrics::readingsSubsystemDuration);
 
-        debugOutputAlk(doc, payload);
+    ph::PHReading phReading;
+    while (uiPHReadings.pop(phReading)) {
+        debugOutputPH(phReading);
+        readingStore->addPHReading(phReading);
+    }
+
+    alk_measure::AlkReading reading;
+    while (uiAlkReadings.pop(reading)) {
+        debugOutputAlk(reading);
 
-        alk_measure::PersistedAlkReading alkReading;
-        LOAD_FROM_DOC(alkReading, asOfAdjustedSec, unsigned long);
-        LOAD_FROM_DOC(alkReading, alkReadingDKH, float);
-        alkReading.title = doc["title"].as<std::string>();
+        alk_measure::PersistedAlkReading alkReading = {
+            .asOfAdjustedSec = reading.asOfAdjustedSec,
+            .alkReadingDKH = reading.alkReadingDKH,
+            .title = reading.title};
         readingStore->addAlkReading(alkReading);
         persistReadingStore(readingStore);
 
         monitoring_display::updateDisplay(readingStore);
-    };
-
-    Serial << "Initialized topic_processor_count=" << topicsToProcessor.size() << endl;
-    return std::move(topicsToProcessorPtr);
+    }
 }
 
 std::unique_ptr<alk_measure::AlkMeasurer> alkMeasureSetup(std::shared_ptr<doser::BuffDosers> buffDosers, const alk_measure::AlkMeasurementConfig alkMeasureConf, const std::shared_ptr<ph::controller::PHReader> phReader) {
     return std::make_unique<alk_measure::AlkMeasurer>(buffDosers, alkMeasureConf, phReader);
 }
 
-void setupController(std::shared_ptr<MqttBroker> mqttBroker, std::shared_ptr<MqttClient> mqttClient, std::shared_ptr<doser::BuffDosers> buffDosers, std::shared_ptr<ph::controller::PHReader> phReader, const alk_measure::AlkMeasurementConfig& alkMeasureConf, std::shared_ptr<mqtt::Publisher> pub, std::shared_ptr<buff_time::TimeWrapper> t) {
+void setupController(std::shared_ptr<MqttBroker> mqttBroker, std::shared_ptr<MqttClient> mqttClient, std::shared_ptr<doser::BuffDosers> buffDosers, std::shared_ptr<ph::controller::PHReader> reader, const alk_measure::AlkMeasurementConfig& alkMeasureConf, std::shared_ptr<mqtt::Publisher> pub, std::shared_ptr<buff_time::TimeWrapper> t) {
     buffDosersPtr = buffDosers;
+    phReader = reader;
     publisher = pub;
     timeClient = t;
     alkMeasurer = std::move(alkMeasureSetup(buffDosers, alkMeasureConf, phReader));
 
-    std::shared_ptr<richiev::mqtt::TopicProcessorMap> handlers = std::move(buildHandlers(*buffDosers));
+    onAutoMeasurementBegun = []() { measurementStartFreeHeap = ESP.getFreeHeap(); };
+    onAutoMeasurementDone = [](unsigned long /* durationMS */) {
+        metrics::measurementHeapDelta.set((int32_t)ESP.getFreeHeap() - measurementStartFreeHeap);
+    };
+
+    auto traceStore = std::make_shared<measurement_trace::TraceStore>();
+    if (traceStore->begin()) {
+        measurement_trace::traceStore = traceStore;
+        auto traceRecorder = std::make_shared<measurement_trace::TraceRecorder>();
+        traceRecorder->onFinished = [](const std::string& title, const uint8_t* data, size_t length) {
+            if (!measurement_trace::traceStore->submit(title, data, length)) {
+                Serial.println("Trace queue full, dropping the measurement's trace");
+                metrics::taskQueueDropped.increment();
+            }
+        };
+        alkMeasurer->traceTo(traceRecorder);
+    } else {
+        Serial.println("Failed to open the measurement trace ring, measurements won't be traced");
+    }
+
+    std::shared_ptr<richiev::mqtt::Dispatcher> handlers = std::move(buildHandlers(*buffDosers));
+
+    richiev::metrics::profileContext() = describeProfileContext;
 
     readingStore = std::move(reading_store::setupReadingStore(reading_store::READINGS_TO_KEEP));
+    subscribeToReadings();
     webServer = std::make_unique<web_server::BuffWebServer>(timeClient);
 
     richiev::mqtt::setupMQTT(mqttBroker, mqttClient, handlers);
-    webServer->setupWebServer(readingStore);
+    webServer->setupWebServer(readingStore, traceStore);
 
     monitoring_display::setupDisplay(readingStore, publisher);
 
@@ -349,37 +306,35 @@ void setupController(std::shared_ptr<MqttBroker> mqttBroker, std::shared_ptr<Mqt
 #endif
 }
 
-void loopAlkMeasurement(unsigned long loopAsOf) {
-    if (autoMeasureLooper != nullptr &&
-        (autoMeasureLooper->getLastStepResult().asOfMS + ALK_STEP_INTERVAL_MS) <= loopAsOf) {
-        Serial.print(loopAsOf);
-        Serial.print(" Performing measurement step");
-        auto& result = autoMeasureLooper->nextStep();
-        Serial.print(loopAsOf);
-        Serial.println(" Completed measurement step");
-        debugOutputAction(result);
-        if (result.nextAction == alk_measure::MeasurementAction::MEASURE_DONE) {
-            Serial.println("Completed measurement loop");
-            autoMeasureLooper.reset();
-        }
+/*******************************
+ * Scheduled jobs
+ *******************************/
+// Process task, picks up measurements requested from the web
+void handleFeedRequests() {
+    alk_measure::TriggerRequest pendingRequest;
+    if (feedRequests.pop(pendingRequest)) {
+        runAfterIdempotenceCheck(pendingRequest.asOf, [&]() {
+            beginAutoMeasurement(alkMeasurer->getDefaultAlkMeasurementConfig(), pendingRequest.title);
+        });
     }
 }
 
-void loopController() {
-    auto pendingRequest = webServer->retrievePendingFeedRequest();
-    if (pendingRequest) {
-        runAfterIdempotenceCheck(pendingRequest->asOf, [&]() {
-            autoMeasureLooper = std::move(alk_measure::beginAlkMeasureLoop<AUTO_PH_SAMPLE_COUNT>(alkMeasurer, publisher, timeClient, alkMeasurer->getDefaultAlkMeasurementConfig(), pendingRequest->title));
-        });
+// UI task
+void loopWeb() {
+    {
+        richiev::metrics::ProfileScope profile(metrics::webSubsystemDuration);
+        webServer->loopWebServer(currentMeasurementDurationMS.load(std::memory_order_relaxed));
     }
-    unsigned long currentDurationMS = 0;
-    if (autoMeasureLooper) {
-        currentDurationMS = autoMeasureLooper->getLastStepResult().asOfMS -
-                            autoMeasureLooper->getLastStepResult().measurementStartedAtMS;
+    auto pendingRequest = webServer->retrievePendingFeedRequest();
+    if (pendingRequest && !feedRequests.push(std::move(*pendingRequest))) {
+        Serial.println("Measurement request queue full, dropping request");
+        metrics::taskQueueDropped.increment();
     }
-    webServer->loopWebServer(currentDurationMS);
-    loopAlkMeasurement(millis());
+}
 
+// UI task
+void loopDisplay() {
+    richiev::metrics::ProfileScope profile(metrics::displaySubsystemDuration);
     monitoring_display::loopDisplay();
 }
 
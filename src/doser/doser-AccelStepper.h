@@ -20,6 +20,7 @@ class AccelStepperDoser : public Doser {
     std::shared_ptr<AccelStepper> stepper;
 
     virtual void doseML(const float outputML, Calibrator* aCalibrator = nullptr) {
+        richiev::metrics::ScopedTimer timer(doseDuration);
         if (aCalibrator == nullptr) aCalibrator = calibrator.get();
 
         const double partialRotation = aCalibrator->partialRotationsForMLOutput(outputML);
@@ -40,13 +41,12 @@ class AccelStepperDoser : public Doser {
     }
 
     virtual void setup() {
-        const auto rps = config.motorRPM / 60.0;
-        const long stepsPerRevolution = partialRotationToSteps(1.0);
-        const auto maxSpeed = rps * stepsPerRevolution;
+        const auto limits = motionLimits();
         Serial.print("[AS] Setting max speed, steps=");
-        Serial.println(maxSpeed);
-        stepper->setMaxSpeed(maxSpeed);
-        stepper->setAcceleration(maxSpeed);
+        Serial.println(limits.maxSpeed);
+        stepper->setMaxSpeed(limits.maxSpeed);
+        // AccelStepper only does symmetric trapezoids
+        stepper->setAcceleration(limits.accel);
         stepper->setMinPulseWidth(80);
     }
 
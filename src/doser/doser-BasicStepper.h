@@ -20,6 +20,7 @@ class BasicStepperDoser : public Doser {
     std::shared_ptr<A4988> stepper;
 
     virtual void doseML(const float outputML, Calibrator* aCalibrator = nullptr) {
+        richiev::metrics::ScopedTimer timer(doseDuration);
         if (aCalibrator == nullptr) aCalibrator = calibrator.get();
 
         const double partialRotation = aCalibrator->partialRotationsForMLOutput(outputML);
@@ -40,6 +41,17 @@ class BasicStepperDoser : public Doser {
 
     virtual void setup() {
         stepper->begin(config.motorRPM, config.microStepType);
+        // without ramps configured StepperDriver runs at a constant speed, as
+        // this doser always used to. inputs-common.h's configs all have them,
+        // so the default board's dosers ramp too now.
+        if (config.accelRPMPerSec > 0 || config.decelRPMPerSec > 0) {
+            // StepperDriver wants full steps
+            const float fullStepsPerRPM = config.fullStepsPerRotation / 60.0;
+            const float cruise = config.motorRPM * fullStepsPerRPM;
+            const float accel = config.accelRPMPerSec > 0 ? config.accelRPMPerSec * fullStepsPerRPM : cruise;
+            const float decel = config.decelRPMPerSec > 0 ? config.decelRPMPerSec * fullStepsPerRPM : cruise;
+            stepper->setSpeedProfile(BasicStepperDriver::LINEAR_SPEED, min(accel, 32767.0f), min(decel, 32767.0f));
+        }
     }
 
     virtual void debugRotateDegrees(const int degreesRotation) {
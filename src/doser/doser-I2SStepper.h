@@ -0,0 +1,168 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <cmath>
+#include <memory>
+
+#include "mks-skinny/I2SOut.h"
+#include "mks-skinny/Pins.h"
+
+// Buff Libraries
+#include "doser/doser-common.h"
+#include "doser/step-pulser.h"
+
+namespace buff {
+namespace doser {
+
+/*******************************
+ * I2S stepping
+ *
+ * On the MKS DLC32 the step/dir pins hang off the I2S shift registers. In
+ * stepping mode the I2S driver fills its DMA buffers ahead of time by calling
+ * a pulse callback, so pulses come out with sample (4us) accuracy no matter
+ * what the CPU is doing, and the requesting task just sleeps until its move
+ * is done. Needs USE_I2S_OUT_STREAM_IMPL.
+ *******************************/
+// how long the step pin is held high for, A4988/TMC2208 need ~1us
+const uint32_t I2S_STEP_PULSE_US = 8;
+
+inline StepPulser i2sStepPulser;
+inline uint8_t i2sStepPins[MAX_STEP_CHANNELS] = {};
+
+// Called by the I2S task as it fills DMA buffers, not from an ISR
+static void onI2SPulse() {
+    uint32_t gapUS = 0;
+    const uint8_t stepMask = i2sStepPulser.next(gapUS);
+
+    if (stepMask != 0) {
+        for (size_t i = 0; i < MAX_STEP_CHANNELS; i++) {
+            if (stepMask & (1 << i)) i2s_out_write(i2sStepPins[i], HIGH);
+        }
+        i2s_out_push_sample(I2S_STEP_PULSE_US);
+        for (size_t i = 0; i < MAX_STEP_CHANNELS; i++) {
+            if (stepMask & (1 << i)) i2s_out_write(i2sStepPins[i], LOW);
+        }
+    }
+    i2s_out_set_pulse_period(gapUS);
+
+    // let the DMA drain & drop back to static outputs until the next move
+    if (!i2sStepPulser.anyRunning()) i2s_out_set_passthrough();
+}
+
+static void beginI2SStepping() {
+    static bool begun = false;
+    if (begun) return;
+    begun = true;
+
+    // a no-op if setup_mks already has
+    i2s_out_init();
+    i2s_out_set_pulse_callback(onI2SPulse);
+    i2s_out_set_pulse_period(PULSER_IDLE_GAP_US);
+}
+
+// A step/dir driver on the I2S expander, the I2S equivalent of an AccelStepper
+class I2SStepper {
+   public:
+    const size_t channel;
+    const short stepPin;
+    const short dirPin;
+
+    I2SStepper(const size_t ch, const short step, const short dir) : channel(ch), stepPin(step), dirPin(dir) {}
+
+    void setup() {
+        beginI2SStepping();
+        i2sStepPins[channel] = stepPin - I2S_OUT_PIN_BASE;
+    }
+
+    // Starts a move, returns straight away
+    bool start(const long steps, const StepRamp &ramp) {
+        if (steps == 0) return true;
+        if (running()) return false;
+
+        // written before the first step is due, which is at least a sample later
+        digitalWrite(dirPin, steps > 0 ? HIGH : LOW);
+        if (!i2sStepPulser.start(channel, labs(steps), ramp)) return false;
+        i2s_out_set_stepping();
+        return true;
+    }
+
+    bool running() const { return i2sStepPulser.running(channel); }
+
+    void waitUntilDone() {
+        while (running()) {
+            // the pulser may have been heading back to passthrough as this move started
+            if (i2s_out_get_pulser_status() != STEPPING) i2s_out_set_stepping();
+            vTaskDelay(1);
+        }
+    }
+};
+
+class I2SStepperDoser : public Doser {
+   private:
+    // planned at compile time from the same config, see inputs.h
+    const StepRamp _ramp;
+
+    void move(const long steps) {
+        stepper->start(steps, _ramp);
+        stepper->waitUntilDone();
+    }
+
+   public:
+    I2SStepperDoser(DoserConfig doserConfig, std::shared_ptr<I2SStepper> s, const StepRamp ramp) : Doser(doserConfig), _ramp(ramp), stepper(s) {}
+
+    std::shared_ptr<I2SStepper> stepper;
+
+    virtual void doseML(const float outputML, Calibrator* aCalibrator = nullptr) {
+        richiev::metrics::ScopedTimer timer(doseDuration);
+        if (aCalibrator == nullptr) aCalibrator = calibrator.get();
+
+        const double partialRotation = aCalibrator->partialRotationsForMLOutput(outputML);
+        const long steps = partialRotationToSteps(partialRotation);
+        Serial.print("[I2S] Outputting mlToOutput=");
+        Serial.print(outputML);
+        Serial.print("ml,");
+        Serial.print(" via partialRotation=");
+        Serial.print(partialRotation);
+        Serial.print(" via steps=");
+        Serial.print(steps);
+        Serial.print(" with mlPerFullRotation=");
+        Serial.print(aCalibrator->getMlPerFullRotation());
+        Serial.println();
+
+        move(steps);
+    }
+
+    virtual void setup() {
+        const auto limits = motionLimits();
+        Serial.print("[I2S] Setting max speed, steps=");
+        Serial.print(limits.maxSpeed);
+        Serial.print(", accelSteps=");
+        Serial.print(_ramp.accelSteps);
+        Serial.print(", decelSteps=");
+        Serial.println(_ramp.decelSteps);
+        stepper->setup();
+    }
+
+    virtual void debugRotateDegrees(const int degreesRotation) {
+        const long steps = degreesToFullSteps(degreesRotation);
+        Serial.print("[I2S] Outputting via degreesRotation=");
+        Serial.print(degreesRotation);
+        Serial.print(" via steps=");
+        Serial.print(steps);
+        Serial.println();
+
+        move(steps);
+    }
+
+    virtual void debugRotateSteps(const long steps) {
+        Serial.print("[I2S] Outputting via steps=");
+        Serial.print(steps);
+        Serial.println();
+
+        move(steps);
+    }
+};
+
+}  // namespace doser
+}  // namespace buff
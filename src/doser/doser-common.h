@@ -3,12 +3,15 @@
 #include <Arduino.h>
 
 #include <cmath>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 
 // Buff Libraries
+#include "buff-metrics.h"
 #include "doser/doser-config.h"
+#include "doser/step-ramp.h"
 
 namespace buff {
 namespace doser {
@@ -47,6 +50,9 @@ class Doser {
 
     std::shared_ptr<Calibrator> calibrator;
 
+    // where dose durations get recorded, set up by setupDoser
+    richiev::metrics::Histogram* doseDuration = nullptr;
+
     virtual void doseML(const float outputML, Calibrator* aCalibrator = nullptr) = 0;
 
     virtual void setup() = 0;
@@ -63,6 +69,11 @@ class Doser {
         const double partialRotation = (degrees / fullRotation);
         return partialRotationToSteps(partialRotation);
     }
+
+    // The configured motion profile, in (micro)steps
+    MotionLimits motionLimits() const {
+        return motionLimitsFor(config);
+    }
 };
 
 class BuffDosers {
@@ -85,6 +96,14 @@ class BuffDosers {
         }
     }
 
+    // told about each dose made through doseML below, eg to trace a measurement
+    std::function<void(MeasurementDoserType doserType, float ml)> onDose;
+
+    void doseML(const MeasurementDoserType doserType, const float outputML) {
+        if (onDose) onDose(doserType, outputML);
+        selectDoser(doserType)->doseML(outputML);
+    }
+
     // TODO: return emplace value
     void emplace(const MeasurementDoserType doserType, std::shared_ptr<Doser> doser) {
         _doserTypeToDoser.emplace(doserType, doser);
@@ -112,6 +131,7 @@ static MeasurementDoserType lookupMeasurementDoserType(const std::string doserTy
 template <class STEPPER_TYPE>
 static void setupDoser(BuffDosers& buffDosers, const MeasurementDoserType &doserType, std::shared_ptr<Doser> doser, std::shared_ptr<STEPPER_TYPE> stepper) {
     doser->calibrator = std::move(std::make_unique<Calibrator>(doser->config.mlPerFullRotation));
+    doser->doseDuration = metrics::doseDurationFor(doserType);
     doser->setup();
 
     // TODO: if this was a UART based stepper, we could explicitly set the microStepType
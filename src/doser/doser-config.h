@@ -2,6 +2,7 @@
 
 // #include <Arduino.h>
 
+#include <map>
 #include <memory>
 #include <string>
 
@@ -35,6 +36,14 @@ struct DoserConfig {
     // A4988 = 1
     // TMC2208 = -1
     int clockwiseDirectionMultiplier = 1;
+
+    // Motion profile, in rotations so they hold whatever the microstepping.
+    // 0 accel/decel is the old behaviour of getting to motorRPM in a second.
+    float accelRPMPerSec = 0;
+    float decelRPMPerSec = 0;
+    // how quickly the acceleration itself can change, 0 for no limit (only
+    // honoured by the I2S driver, the others can't do S-curves)
+    float jerkRPMPerSec2 = 0;
 };
 
 enum MeasurementDoserType {
@@ -2,3 +2,7 @@
 
 #include "doser/doser-AccelStepper.h"
 #include "doser/doser-BasicStepper.h"
+
+#ifdef I2S_STEPPER_DRIVER
+#include "doser/doser-I2SStepper.h"
+#endif
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace buff {
+namespace doser {
+
+/*******************************
+ * Motion profiles
+ *
+ * Plans a move as a jerk limited S-curve: acceleration ramps up at the jerk
+ * limit, holds, ramps back down into the cruise, and the mirror image to stop
+ * (with its own deceleration limit). Not snapping straight to full
+ * acceleration is what lets a loaded pump run close to its real top speed
+ * without stalling.
+ *
+ * Short moves that can't reach the cruise speed peak lower, and with no jerk
+ * limit it degrades to a plain trapezoid.
+ *
+ * Everything's in steps & seconds, and it's all constexpr so moves with
+ * fixed limits can be planned at compile time (see step-ramp.h).
+ *******************************/
+constexpr float constexprSqrt(const float x) {
+    if (x <= 0) return 0;
+    // Newton's from above, which only ever decreases until it's converged
+    float root = x > 1 ? x : 1;
+    for (int i = 0; i < 128; i++) {
+        const float next = (root + x / root) / 2;
+        if (next >= root) break;
+        root = next;
+    }
+    return root;
+}
+
+constexpr float constexprAbs(const float x) { return x < 0 ? -x : x; }
+
+struct MotionLimits {
+    float maxSpeed;
+    float accel;
+    float decel;
+    // 0 for unlimited (a trapezoid)
+    float jerk = 0;
+};
+
+class MotionProfile {
+   private:
+    static const size_t MAX_SEGMENTS = 7;
+
+    // a stretch of constant jerk, with the state at its start
+    struct Segment {
+        float durationS = 0;
+        float jerk = 0;
+        float startPos = 0;
+        float startSpeed = 0;
+        float startAccel = 0;
+    };
+
+    Segment _segments[MAX_SEGMENTS] = {};
+    size_t _segmentCount = 0;
+    float _distance = 0;
+    float _durationS = 0;
+    float _peakSpeed = 0;
+
+    // the jerk & constant phases of getting between 0 and speed, at an accel limit
+    static constexpr void rampTimes(const float speed, const float accel, const float jerk, float &jerkS, float &constS, float &peakAccel) {
+        if (jerk <= 0) {
+            jerkS = 0;
+            peakAccel = accel;
+        } else if (speed * jerk >= accel * accel) {
+            jerkS = accel / jerk;
+            peakAccel = accel;
+        } else {
+            // never reaches the accel limit
+            jerkS = constexprSqrt(speed / jerk);
+            peakAccel = jerk * jerkS;
+        }
+        constS = speed / peakAccel - jerkS;
+        if (constS < 0) constS = 0;
+    }
+
+    // a ramp between 0 and speed covers speed * duration / 2, whatever its shape
+    static constexpr float rampDistance(const float speed, const float accel, const float jerk) {
+        float jerkS = 0, constS = 0, peakAccel = 0;
+        rampTimes(speed, accel, jerk, jerkS, constS, peakAccel);
+        return speed * (2 * jerkS + constS) / 2;
+    }
+
+    constexpr void addSegment(const float durationS, const float jerk, const float accel) {
+        if (durationS <= 0) return;
+
+        Segment &s = _segments[_segmentCount];
+        s.durationS = durationS;
+        s.jerk = jerk;
+        s.startAccel = accel;
+        if (_segmentCount == 0) {
+            s.startPos = 0;
+            s.startSpeed = 0;
+        } else {
+            const Segment &prev = _segments[_segmentCount - 1];
+            s.startPos = positionIn(prev, prev.durationS);
+            s.startSpeed = speedIn(prev, prev.durationS);
+        }
+        _segmentCount++;
+        _durationS += durationS;
+    }
+
+    constexpr void addRamp(const float speed, const float accel, const float jerk, const float sign) {
+        float jerkS = 0, constS = 0, peakAccel = 0;
+        rampTimes(speed, accel, jerk, jerkS, constS, peakAccel);
+        addSegment(jerkS, sign * jerk, 0);
+        addSegment(constS, 0, sign * peakAccel);
+        addSegment(jerkS, -sign * jerk, sign * peakAccel);
+    }
+
+    static constexpr float positionIn(const Segment &s, const float t) {
+        return s.startPos + s.startSpeed * t + s.startAccel * t * t / 2 + s.jerk * t * t * t / 6;
+    }
+
+    static constexpr float speedIn(const Segment &s, const float t) {
+        return s.startSpeed + s.startAccel * t + s.jerk * t * t / 2;
+    }
+
+    constexpr const Segment *segmentAt(float &t) const {
+        for (size_t i = 0; i < _segmentCount; i++) {
+            if (t <= _segments[i].durationS || i == _segmentCount - 1) return &_segments[i];
+            t -= _segments[i].durationS;
+        }
+        return nullptr;
+    }
+
+   public:
+    static constexpr MotionProfile plan(const float distance, const MotionLimits &limits) {
+        MotionProfile profile;
+        if (distance <= 0 || limits.maxSpeed <= 0 || limits.accel <= 0 || limits.decel <= 0) return profile;
+
+        const float jerk = limits.jerk;
+        float peak = limits.maxSpeed;
+        if (rampDistance(peak, limits.accel, jerk) + rampDistance(peak, limits.decel, jerk) > distance) {
+            // too short to cruise, find the peak speed that just fits
+            float lo = 0;
+            float hi = peak;
+            for (int i = 0; i < 32; i++) {
+                const float mid = (lo + hi) / 2;
+                if (rampDistance(mid, limits.accel, jerk) + rampDistance(mid, limits.decel, jerk) > distance) {
+                    hi = mid;
+                } else {
+                    lo = mid;
+                }
+            }
+            peak = lo;
+        }
+        if (peak <= 0) return profile;
+
+        const float cruiseDistance = distance - rampDistance(peak, limits.accel, jerk) - rampDistance(peak, limits.decel, jerk);
+        profile._peakSpeed = peak;
+        profile._distance = distance;
+        profile.addRamp(peak, limits.accel, jerk, 1);
+        profile.addSegment(cruiseDistance / peak, 0, 0);
+        profile.addRamp(peak, limits.decel, jerk, -1);
+        return profile;
+    }
+
+    // Just getting from stopped up to speed, which played backwards is also
+    // how to stop from it
+    static constexpr MotionProfile ramp(const float speed, const float accel, const float jerk = 0) {
+        MotionProfile profile;
+        if (speed <= 0 || accel <= 0) return profile;
+
+        profile._peakSpeed = speed;
+        profile._distance = rampDistance(speed, accel, jerk);
+        profile.addRamp(speed, accel, jerk, 1);
+        return profile;
+    }
+
+    constexpr bool empty() const { return _segmentCount == 0; }
+    constexpr float distance() const { return _distance; }
+    constexpr float durationS() const { return _durationS; }
+    constexpr float peakSpeed() const { return _peakSpeed; }
+
+    constexpr float positionAt(float t) const {
+        if (empty() || t <= 0) return 0;
+        if (t >= _durationS) return _distance;
+        const Segment *s = segmentAt(t);
+        return positionIn(*s, t);
+    }
+
+    constexpr float speedAt(float t) const {
+        if (empty() || t <= 0 || t >= _durationS) return 0;
+        const Segment *s = segmentAt(t);
+        return speedIn(*s, t);
+    }
+
+    // When the move reaches position, searching from fromS (eg the previous step's time)
+    constexpr float timeAt(const float position, const float fromS = 0) const {
+        if (position <= 0) return 0;
+        if (position >= _distance) return _durationS;
+
+        // Newton's method, falling back to bisection where it'd leave the bracket
+        float lo = fromS > 0 ? fromS : 0;
+        float hi = _durationS;
+        float t = lo;
+        for (int i = 0; i < 24; i++) {
+            const float error = positionAt(t) - position;
+            if (constexprAbs(error) < 1e-3f) break;
+            if (error < 0) {
+                lo = t;
+            } else {
+                hi = t;
+            }
+
+            const float speed = speedAt(t);
+            float next = speed > 0 ? t - error / speed : lo;
+            if (next <= lo || next >= hi) next = (lo + hi) / 2;
+            t = next;
+        }
+        return t;
+    }
+};
+
+}  // namespace doser
+}  // namespace buff
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Buff Libraries
+#include "doser/step-ramp.h"
+
+namespace buff {
+namespace doser {
+
+/*******************************
+ * Step pulser
+ *
+ * Works out when each stepper channel's next step pulse is due, for a
+ * hardware pulser (the I2S engine) to play out. It's called once per pulse
+ * event, says which channels step now and how long until the next event, so
+ * step timing is set by the DMA stream rather than by whoever's polling.
+ *
+ * Each move follows its doser's precomputed step ramp (see step-ramp.h), so
+ * working out a step is a couple of table lookups.
+ *
+ * start/running are for the task requesting moves, next() is for the pulse
+ * callback; a channel is only touched by the callback while it's running.
+ *******************************/
+const size_t MAX_STEP_CHANNELS = 3;
+
+// longest gap between events when nothing's due (keeps the callback ticking over)
+const uint32_t PULSER_IDLE_GAP_US = 1000;
+// gaps shorter than this are stretched, the pulse itself takes a few samples
+const uint32_t PULSER_MIN_GAP_US = 12;
+// steps due within this of now go out with this event
+const int32_t PULSER_DUE_WITHIN_US = 2;
+
+class StepPulser {
+   private:
+    struct Channel {
+        std::atomic<bool> active{false};
+        StepRamp ramp;
+        uint32_t steps = 0;
+        uint32_t stepped = 0;
+        int32_t untilNextUS = 0;
+    };
+
+    Channel _channels[MAX_STEP_CHANNELS];
+
+   public:
+    // Starts a move of steps on an idle channel
+    bool start(const size_t channel, const uint32_t steps, const StepRamp &ramp) {
+        if (channel >= MAX_STEP_CHANNELS || steps == 0 || ramp.empty()) return false;
+
+        Channel &c = _channels[channel];
+        if (c.active.load(std::memory_order_acquire)) return false;
+
+        c.ramp = ramp;
+        c.steps = steps;
+        c.stepped = 0;
+        c.untilNextUS = ramp.ticksBefore(0, steps) * STEP_RAMP_TICK_US;
+
+        c.active.store(true, std::memory_order_release);
+        return true;
+    }
+
+    bool running(const size_t channel) const {
+        return channel < MAX_STEP_CHANNELS && _channels[channel].active.load(std::memory_order_acquire);
+    }
+
+    bool anyRunning() const {
+        for (size_t i = 0; i < MAX_STEP_CHANNELS; i++) {
+            if (running(i)) return true;
+        }
+        return false;
+    }
+
+    // Pulse callback only. Returns a bit per channel that steps now, and sets
+    // how long until next() should be called again.
+    uint8_t next(uint32_t &gapUS) {
+        uint8_t stepMask = 0;
+        int32_t gap = PULSER_IDLE_GAP_US;
+
+        for (size_t i = 0; i < MAX_STEP_CHANNELS; i++) {
+            Channel &c = _channels[i];
+            if (!c.active.load(std::memory_order_acquire)) continue;
+
+            if (c.untilNextUS <= PULSER_DUE_WITHIN_US) {
+                stepMask |= 1 << i;
+                if (++c.stepped == c.steps) {
+                    c.active.store(false, std::memory_order_release);
+                    continue;
+                }
+                c.untilNextUS += c.ramp.ticksBefore(c.stepped, c.steps - c.stepped) * STEP_RAMP_TICK_US;
+            }
+            if (c.untilNextUS < gap) gap = c.untilNextUS;
+        }
+
+        gapUS = gap < (int32_t)PULSER_MIN_GAP_US ? PULSER_MIN_GAP_US : gap;
+        for (size_t i = 0; i < MAX_STEP_CHANNELS; i++) {
+            if (_channels[i].active.load(std::memory_order_relaxed)) _channels[i].untilNextUS -= (int32_t)gapUS;
+        }
+        return stepMask;
+    }
+};
+
+}  // namespace doser
+}  // namespace buff
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Buff Libraries
+#include "doser/doser-config.h"
+#include "doser/motion-profile.h"
+
+namespace buff {
+namespace doser {
+
+/*******************************
+ * Step ramps
+ *
+ * A doser's moves all share the same acceleration & deceleration ramps, just
+ * cut short on short moves, so they're planned once at compile time into
+ * tables of the gap before each step. Stepping then costs a couple of table
+ * lookups rather than solving the motion profile for every step.
+ *
+ * Gaps are in ticks of the I2S sample period, which is as fine as the pulses
+ * can be placed anyway, and keeps the slowest first steps in 16 bits.
+ *******************************/
+const uint32_t STEP_RAMP_TICK_US = 4;
+
+// The configured motion profile, in (micro)steps
+constexpr MotionLimits motionLimitsFor(const DoserConfig &config) {
+    const float stepsPerRPM = (float)config.fullStepsPerRotation * config.microStepType / 60;
+    const float maxSpeed = config.motorRPM * stepsPerRPM;
+    return {.maxSpeed = maxSpeed,
+            .accel = config.accelRPMPerSec > 0 ? config.accelRPMPerSec * stepsPerRPM : maxSpeed,
+            .decel = config.decelRPMPerSec > 0 ? config.decelRPMPerSec * stepsPerRPM : maxSpeed,
+            .jerk = config.jerkRPMPerSec2 * stepsPerRPM};
+}
+
+constexpr size_t rampSteps(const float speed, const float accel, const float jerk) {
+    const float distance = MotionProfile::ramp(speed, accel, jerk).distance();
+    const size_t steps = (size_t)distance;
+    return steps < distance ? steps + 1 : (steps > 0 ? steps : 1);
+}
+
+constexpr size_t accelRampSteps(const MotionLimits &limits) { return rampSteps(limits.maxSpeed, limits.accel, limits.jerk); }
+constexpr size_t decelRampSteps(const MotionLimits &limits) { return rampSteps(limits.maxSpeed, limits.decel, limits.jerk); }
+
+constexpr uint16_t toRampTicks(const float seconds) {
+    const float ticks = seconds * 1e6f / STEP_RAMP_TICK_US + 0.5f;
+    return ticks >= UINT16_MAX ? UINT16_MAX : (ticks < 1 ? 1 : (uint16_t)ticks);
+}
+
+// A view of a doser's ramp tables, cheap to copy around
+struct StepRamp {
+    const uint16_t *accelTicks = nullptr;
+    size_t accelSteps = 0;
+    const uint16_t *decelTicks = nullptr;
+    size_t decelSteps = 0;
+    uint16_t cruiseTicks = 0;
+
+    bool empty() const { return cruiseTicks == 0; }
+
+    // The gap before the next step, having done stepped with remaining to go.
+    // Whichever's slower of speeding up from the start & slowing down for the
+    // end, which is what cuts the ramps short on short moves.
+    uint32_t ticksBefore(const uint32_t stepped, const uint32_t remaining) const {
+        const uint16_t up = stepped < accelSteps ? accelTicks[stepped] : cruiseTicks;
+        // stopping is speeding up played backwards
+        const uint16_t down = remaining <= decelSteps ? decelTicks[remaining - 1] : cruiseTicks;
+        return up > down ? up : down;
+    }
+};
+
+template <size_t ACCEL_STEPS, size_t DECEL_STEPS>
+class StepRampTable {
+   private:
+    uint16_t _accelTicks[ACCEL_STEPS] = {};
+    uint16_t _decelTicks[DECEL_STEPS] = {};
+    uint16_t _cruiseTicks = 0;
+
+    static constexpr void fill(uint16_t *ticks, const size_t steps, const float speed, const float accel, const float jerk) {
+        const auto ramp = MotionProfile::ramp(speed, accel, jerk);
+        float lastS = 0;
+        for (size_t i = 0; i < steps; i++) {
+            // the last step can land just after the ramp's done, at full speed
+            const float position = i + 1;
+            const float stepS = position <= ramp.distance() ? ramp.timeAt(position, lastS) : ramp.durationS() + (position - ramp.distance()) / speed;
+            ticks[i] = toRampTicks(stepS - lastS);
+            // a ramp only ever speeds up, don't let rounding say otherwise
+            if (i > 0 && ticks[i] > ticks[i - 1]) ticks[i] = ticks[i - 1];
+            lastS = stepS;
+        }
+    }
+
+   public:
+    constexpr explicit StepRampTable(const MotionLimits &limits) {
+        fill(_accelTicks, ACCEL_STEPS, limits.maxSpeed, limits.accel, limits.jerk);
+        fill(_decelTicks, DECEL_STEPS, limits.maxSpeed, limits.decel, limits.jerk);
+        _cruiseTicks = toRampTicks(1 / limits.maxSpeed);
+    }
+
+    StepRamp ramp() const {
+        return {.accelTicks = _accelTicks,
+                .accelSteps = ACCEL_STEPS,
+                .decelTicks = _decelTicks,
+                .decelSteps = DECEL_STEPS,
+                .cruiseTicks = _cruiseTicks};
+    }
+};
+
+// The ramp tables for limits that are known at compile time, eg
+//   constexpr auto fillStepRamp = STEP_RAMP_TABLE(motionLimitsFor(fillDoserConfig));
+#define STEP_RAMP_TABLE(limits) \
+    buff::doser::StepRampTable<buff::doser::accelRampSteps(limits), buff::doser::decelRampSteps(limits)>(limits)
+
+}  // namespace doser
+}  // namespace buff
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+
+// Buff Libraries
+#include "event-channel.h"
+#include "mqtt-common.h"
+#include "readings/alk-measure-common.h"
+#include "readings/ph-common.h"
+
+namespace buff {
+namespace events {
+
+/*******************************
+ * Channels
+ *******************************/
+using PHChannel = richiev::events::Channel<ph::PHReading>;
+using AlkChannel = richiev::events::Channel<alk_measure::AlkReading>;
+
+inline PHChannel phReadings;
+inline AlkChannel alkReadings;
+
+/*******************************
+ * Publisher
+ *******************************/
+// Delivers readings to the local subscribers (store, display, MQTT mirror)
+// directly, rather than round tripping them through the MQTT broker.
+class BusPublisher : public mqtt::Publisher {
+   private:
+    std::shared_ptr<mqtt::Publisher> _commandPublisher;
+    PHChannel& _phReadings;
+    AlkChannel& _alkReadings;
+
+   public:
+    // commands (eg measure alk) still go out over MQTT, so anything
+    // listening for them sees the request. Readings go to the global
+    // channels unless others are given (eg a test's own).
+    BusPublisher(std::shared_ptr<mqtt::Publisher> commandPublisher, PHChannel& phChannel = phReadings, AlkChannel& alkChannel = alkReadings)
+        : _commandPublisher(commandPublisher), _phReadings(phChannel), _alkReadings(alkChannel) {}
+
+    void publishPH(const ph::PHReading& phReading) {
+        _phReadings.publish(phReading);
+    }
+
+    void publishAlkReading(const alk_measure::AlkReading& alkReading) {
+        _alkReadings.publish(alkReading);
+    }
+
+    void publishMeasureAlk(const std::string& title, const unsigned long asOfMS) {
+        _commandPublisher->publishMeasureAlk(title, asOfMS);
+    }
+};
+
+/*******************************
+ * Outbound mirroring
+ *******************************/
+// Mirrors every reading out to MQTT for external consumers (eg home automation)
+static void mirrorReadingsTo(std::shared_ptr<mqtt::Publisher> mirror) {
+    phReadings.subscribe([mirror](const ph::PHReading& reading) { mirror->publishPH(reading); });
+    alkReadings.subscribe([mirror](const alk_measure::AlkReading& reading) { mirror->publishAlkReading(reading); });
+}
+
+}  // namespace events
+}  // namespace buff
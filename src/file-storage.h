@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+
+namespace buff {
+namespace storage {
+
+// A fixed size file in SPIFFS, as storage for a RecordRing
+class FileStorage {
+   private:
+    const char *_path;
+    const size_t _size;
+    fs::File _file;
+
+   public:
+    FileStorage(const char *path, const size_t size) : _path(path), _size(size) {}
+
+    bool begin() {
+        if (!SPIFFS.begin()) return false;
+
+        if (!SPIFFS.exists(_path)) {
+            // SPIFFS can't seek past the end, so allocate it all up front
+            fs::File created = SPIFFS.open(_path, FILE_WRITE);
+            if (!created) return false;
+            uint8_t zeros[64] = {0};
+            for (size_t written = 0; written < _size; written += sizeof(zeros)) {
+                created.write(zeros, min(sizeof(zeros), _size - written));
+            }
+            created.close();
+        }
+
+        _file = SPIFFS.open(_path, "r+");
+        return (bool)_file && _file.size() >= _size;
+    }
+
+    size_t size() const { return _size; }
+
+    bool read(const size_t offset, void *buf, const size_t length) {
+        return _file.seek(offset) && _file.read((uint8_t *)buf, length) == length;
+    }
+
+    bool write(const size_t offset, const void *buf, const size_t length) {
+        if (!_file.seek(offset) || _file.write((const uint8_t *)buf, length) != length) return false;
+        _file.flush();
+        return true;
+    }
+};
+
+}  // namespace storage
+}  // namespace buff
@@ -0,0 +1,78 @@
+#pragma once
+
+// Buff Libraries
+#include "doser/doser-config.h"
+#include "readings/alk-measure-common.h"
+
+namespace buff {
+namespace inputs {
+
+/*******************************
+ * Measurement inputs
+ *
+ * The doser & measurement settings, apart from the rest of inputs.h as they
+ * don't depend on the board, so the host simulator (sim/sim-inputs.h)
+ * measures with exactly what the device does.
+ *******************************/
+// how often to read a new ph value
+const unsigned long PH_READ_INTERVAL_MS = 1000;
+
+// fill & drain move a lot of water and just need to get it done, the
+// reagent pump eases in & out so it doesn't dribble at the end of a dose.
+// Most reagent doses are only 0.1ml (a bit over half a turn), so its ramps
+// are kept short: a 0.1ml dose takes ~0.9s, against ~0.57s at full speed
+// throughout (and ~2s with ramps a sixth as steep).
+// The ramps only shape the ends of a dose, the cruise speeds (motorRPM) are
+// as they always were, so fill & drain take as long as ever (eg ~220s to
+// drain 200ml). They're left there until faster ones are proven not to
+// stall or slip the pumps on the hardware.
+constexpr DoserConfig fillDoserConfig = {.mlPerFullRotation = 0.269, .motorRPM = 120,
+                                         //
+                                         .microStepType = SIXTEENTH,
+                                         .fullStepsPerRotation = 200,
+                                         .clockwiseDirectionMultiplier = -1,
+                                         .accelRPMPerSec = 240,
+                                         .decelRPMPerSec = 240,
+                                         .jerkRPMPerSec2 = 2400};
+
+constexpr DoserConfig reagentDoserConfig = {.mlPerFullRotation = 0.175, .motorRPM = 60,
+                                            //
+                                            .microStepType = SIXTEENTH,
+                                            .fullStepsPerRotation = 200,
+                                            .clockwiseDirectionMultiplier = 1,
+                                            .accelRPMPerSec = 360,
+                                            .decelRPMPerSec = 180,
+                                            .jerkRPMPerSec2 = 3600};
+
+constexpr DoserConfig drainDoserConfig = {.mlPerFullRotation = 0.3, .motorRPM = 180,
+                                          //
+                                          .microStepType = SIXTEENTH,
+                                          .fullStepsPerRotation = 200,
+                                          .clockwiseDirectionMultiplier = -1,
+                                          .accelRPMPerSec = 360,
+                                          .decelRPMPerSec = 360,
+                                          .jerkRPMPerSec2 = 3600};
+
+const alk_measure::AlkMeasurementConfig alkMeasureConf = {
+    .primeTankWaterFillVolumeML = 1.0,
+    .primeReagentReverseVolumeML = -2.6,
+    .primeReagentVolumeML = 2.9,
+
+    .measurementTankWaterVolumeML = 200,
+
+    // .measurementTankWaterVolumeML = 200,
+    // .extraPurgeVolumeML = 50,
+
+    // .initialReagentDoseVolumeML = 3.0,
+    // .incrementalReagentDoseVolumeML = 0.1,
+
+    // .stirAmountML = 3.0,
+    // .stirTimes = 10,
+
+    // .reagentStrengthMoles = 0.1,
+
+    // Adjustment for the manual 0.1 HCL mix
+    .calibrationMultiplier = 1.0};
+
+}  // namespace inputs
+}  // namespace buff
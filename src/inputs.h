@@ -6,8 +6,11 @@
 // Buff Libraries
 #include "doser/doser-config.h"
 #include "inputs-board-config.h"
+#include "inputs-common.h"
+#include "mqtt-common.h"
 #include "ph-robotank-sensor.h"
 #include "readings/ph.h"
+#include "upstream-bridge.h"
 
 // Other inputs
 // const std::string wifiSSID;
@@ -24,6 +27,18 @@ namespace inputs {
 const int MQTT_BROKER_PORT = 1883;
 const float DEFAULT_TRIGGER_OUTPUT_ML = 3.0;
 
+// how readings/ph & readings/alk are encoded, MSGPACK ones go to readings/<x>/msgpack
+const mqtt::TelemetryEncoding telemetryEncoding = mqtt::TelemetryEncoding::JSON;
+
+// Optionally forward readings to a central broker, buffered in flash while it's
+// unreachable, and take commands from it. Leave the host empty to disable.
+const upstream::UpstreamConfig upstreamConfig = {
+    .host = "",
+    .port = 1883,
+    .forwardFilters = {mqtt::alkRead, mqtt::alkReadMsgPack, "readings/ph/history"},
+    .commandFilters = {mqtt::measureAlk},
+};
+
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
 #define BUFF_NAME TOSTRING(OPT_BUFF_NAME)
@@ -41,8 +56,7 @@ const auto roboTankPHSensorI2CAddress = 98l;
 defineRoboTankSignalReaderFunc(roboTankPHSensorI2CAddress)
 
     const ph::PHReadConfig phReadConfig = {
-        // how often to read a new ph value
-        .readIntervalMS = 1000,
+        .readIntervalMS = PH_READ_INTERVAL_MS,
 
         .phReadFunc = nameForRoboTankSignalReaderFunc(roboTankPHSensorI2CAddress)};
 
@@ -62,25 +76,27 @@ const auto PIN_CONFIG = ESP32_CONFIG;
 const auto PIN_CONFIG = MKS_DLC32_CONFIG;
 #endif
 
-const DoserConfig fillDoserConfig = {.mlPerFullRotation = 0.269, .motorRPM = 120,
-                                     //
-                                     .microStepType = SIXTEENTH,
-                                     .fullStepsPerRotation = 200,
-                                     .clockwiseDirectionMultiplier = -1};
-
-const DoserConfig reagentDoserConfig = {.mlPerFullRotation = 0.175, .motorRPM = 60,
-                                        //
-                                        .microStepType = SIXTEENTH,
-                                        .fullStepsPerRotation = 200,
-                                        .clockwiseDirectionMultiplier = 1};
-
-const DoserConfig drainDoserConfig = {.mlPerFullRotation = 0.3, .motorRPM = 180,
-                                      //
-                                      .microStepType = SIXTEENTH,
-                                      .fullStepsPerRotation = 200,
-                                      .clockwiseDirectionMultiplier = -1};
-
-#ifdef ACCEL_STEPPER_DRIVER
+// the dosers' & measurement's settings are in inputs-common.h
+#ifdef I2S_STEPPER_DRIVER
+// pulses come from the I2S DMA stream, one channel per doser, with the
+// ramps worked out at compile time
+constexpr auto fillStepRamp = STEP_RAMP_TABLE(doser::motionLimitsFor(fillDoserConfig));
+constexpr auto reagentStepRamp = STEP_RAMP_TABLE(doser::motionLimitsFor(reagentDoserConfig));
+constexpr auto drainStepRamp = STEP_RAMP_TABLE(doser::motionLimitsFor(drainDoserConfig));
+
+const std::map<MeasurementDoserType, std::shared_ptr<doser::I2SStepper>> doserSteppers = {
+    {MeasurementDoserType::FILL, std::make_shared<doser::I2SStepper>(0, PIN_CONFIG.FILL_WATER_STEP_PIN, PIN_CONFIG.FILL_WATER_DIR_PIN)},
+    {MeasurementDoserType::REAGENT, std::make_shared<doser::I2SStepper>(1, PIN_CONFIG.REAGENT_STEP_PIN, PIN_CONFIG.REAGENT_DIR_PIN)},
+    {MeasurementDoserType::DRAIN, std::make_shared<doser::I2SStepper>(2, PIN_CONFIG.DRAIN_WATER_STEP_PIN, PIN_CONFIG.DRAIN_WATER_DIR_PIN)},
+};
+
+std::map<MeasurementDoserType, std::shared_ptr<doser::Doser>> doserInstances = {
+    {MeasurementDoserType::FILL, std::make_shared<doser::I2SStepperDoser>(fillDoserConfig, doserSteppers.at(MeasurementDoserType::FILL), fillStepRamp.ramp())},
+    {MeasurementDoserType::REAGENT, std::make_shared<doser::I2SStepperDoser>(reagentDoserConfig, doserSteppers.at(MeasurementDoserType::REAGENT), reagentStepRamp.ramp())},
+    {MeasurementDoserType::DRAIN, std::make_shared<doser::I2SStepperDoser>(drainDoserConfig, doserSteppers.at(MeasurementDoserType::DRAIN), drainStepRamp.ramp())},
+};
+
+#elif defined(ACCEL_STEPPER_DRIVER)
 const std::map<MeasurementDoserType, std::shared_ptr<AccelStepper>> doserSteppers = {
     {MeasurementDoserType::FILL, std::make_shared<AccelStepper>(AccelStepper::DRIVER, PIN_CONFIG.FILL_WATER_STEP_PIN, PIN_CONFIG.FILL_WATER_DIR_PIN)},
     {MeasurementDoserType::REAGENT, std::make_shared<AccelStepper>(AccelStepper::DRIVER, PIN_CONFIG.REAGENT_STEP_PIN, PIN_CONFIG.REAGENT_DIR_PIN)},
@@ -107,26 +123,5 @@ std::map<MeasurementDoserType, std::shared_ptr<doser::Doser>> doserInstances = {
 };
 #endif
 
-alk_measure::AlkMeasurementConfig alkMeasureConf = {
-    .primeTankWaterFillVolumeML = 1.0,
-    .primeReagentReverseVolumeML = -2.6,
-    .primeReagentVolumeML = 2.9,
-
-    .measurementTankWaterVolumeML = 200,
-
-    // .measurementTankWaterVolumeML = 200,
-    // .extraPurgeVolumeML = 50,
-
-    // .initialReagentDoseVolumeML = 3.0,
-    // .incrementalReagentDoseVolumeML = 0.1,
-
-    // .stirAmountML = 3.0,
-    // .stirTimes = 10,
-
-    // .reagentStrengthMoles = 0.1,
-
-    // Adjustment for the manual 0.1 HCL mix
-    .calibrationMultiplier = 1.0};
-
 }  // namespace inputs
 }  // namespace buff
@@ -11,38 +11,42 @@
 #include "mks-skinny/I2SOut.h"
 
 // Buff Libraries
+#include "buff-metrics.h"
 #include "readings/alk-measure.h"
 #include "controller.h"
 #include "doser/doser.h"
+#include "event-bus.h"
 #include "inputs.h"
 #include "mqtt-publish.h"
 #include "mqtt.h"
 #include "mywifi.h"
+#include "network-task.h"
 #include "ntp.h"
 #include "ota.h"
 #include "ph-controller.h"
+#include "tasks.h"
 
 namespace buff {
 /*******************************
  * Shared vars
  *******************************/
-const size_t STANDARD_PH_MAVG_LENGTH = 30;
 auto phReader = std::make_shared<ph::controller::PHReader>(inputs::phReadConfig, inputs::phCalibrator);
-ph::controller::PHReadingStats<STANDARD_PH_MAVG_LENGTH> phReadingStats;
 
 auto mqttBroker = std::make_shared<MqttBroker>(inputs::MQTT_BROKER_PORT);
 auto mqttClient = std::make_shared<MqttClient>(mqttBroker.get());
 
-auto publisher = std::make_shared<mqtt::MQTTPublisher>(mqttClient);
+auto mqttPublisher = std::make_shared<mqtt::MQTTPublisher>(network::outbox, inputs::telemetryEncoding);
+auto publisher = std::make_shared<events::BusPublisher>(mqttPublisher);
 
-std::shared_ptr<NTPClient> ntpClient;
-std::shared_ptr<buff_time::TimeWrapper> timeClient;
+auto timeClient = std::make_shared<buff_time::TimeWrapper>(buff_time::timeService);
 
 std::shared_ptr<doser::BuffDosers> buffDosers;
 
 /**************************
  * Setup & Loop
  **************************/
+void registerJobs();
+
 void setup() {
     Serial.begin(115200);
     Wire.begin(inputs::PIN_CONFIG.I2C_SDA, inputs::PIN_CONFIG.I2C_SCL);
@@ -54,28 +58,46 @@ void setup() {
     // TODO: make this configurable
     setupPH_RoboTankPHBoard();
 
-    // trigger a NTP refresh
-    ntpClient = std::move(ntp::setupNTP());
-    timeClient = std::make_shared<ntp::NTPTimeWrapper>(ntpClient);
+    // syncs in the background, readings use time since boot until it has
+    ntp::setupNTP();
 
     controller::setupController(mqttBroker, mqttClient, buffDosers, phReader, inputs::alkMeasureConf, publisher, timeClient);
+    // after the controller, so local consumers see readings before they're mirrored out
+    events::mirrorReadingsTo(mqttPublisher);
+
+    upstream::beginUpstreamBridge(inputs::upstreamConfig, inputs::hostname);
+    network::setupNetwork(mqttBroker, mqttClient);
+    registerJobs();
+    tasks::startScheduledTask(tasks::NETWORK_TASK, tasks::networkScheduler);
+    tasks::startScheduledTask(tasks::UI_TASK, tasks::uiScheduler);
+    tasks::startScheduledTask(tasks::PROCESS_TASK, tasks::processScheduler);
 }
 
-void loop() {
-    auto phReadingPtr = phReader->readNewPHSignalIfTimeAndUpdate<STANDARD_PH_MAVG_LENGTH>(phReadingStats);
-    if (phReadingPtr != nullptr) {
-        phReadingPtr->asOfAdjustedSec = timeClient->getAdjustedTimeSeconds();
-        publisher->publishPH(*phReadingPtr);
-    }
-
-    ntp::loopNTP(ntpClient);
-
-    controller::loopController();
+/**************************
+ * Jobs
+ **************************/
+void dispatchCommands() {
+    richiev::metrics::ProfileScope profile(metrics::mqttSubsystemDuration);
+    richiev::mqtt::dispatchInbox();
+    controller::handleFeedRequests();
+}
 
-    richiev::mqtt::loopMQTT(mqttBroker, mqttClient);
+void loopOTA() {
+    richiev::metrics::ProfileScope profile(metrics::otaSubsystemDuration);
     richiev::ota::loopOTA();
 }
 
+// Everything periodic, and how often it runs (see tasks.h for where)
+void registerJobs() {
+    // the same schedules as in the host simulator
+    controller::registerProcessJobs(tasks::processScheduler, dispatchCommands);
+    controller::registerUIJobs(tasks::uiScheduler, {.applyReadings = controller::applyReadings,
+                                                    .loopWeb = controller::loopWeb,
+                                                    .loopDisplay = controller::loopDisplay,
+                                                    .loopOTA = loopOTA});
+    controller::registerNetworkJobs(tasks::networkScheduler, network::loopNetwork);
+}
+
 }  // namespace buff
 
 /**************************
@@ -86,5 +108,6 @@ void setup() {
 }
 
 void loop() {
-    buff::loop();
+    // everything runs in the tasks started by setup
+    vTaskDelete(nullptr);
 }
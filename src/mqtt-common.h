@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+
+// Buff Libraries
 #include "readings/alk-measure-common.h"
 #include "readings/ph-common.h"
 
@@ -9,12 +13,25 @@ const std::string alkRead("readings/alk");
 const std::string measureAlk("execute/measure_alk");
 const std::string phRead("readings/ph");
 
+// Readings can also be published MessagePack encoded, on the reading topic
+// plus this suffix (eg readings/ph/msgpack). Same fields as the JSON.
+const std::string msgPackSuffix("/msgpack");
+const std::string alkReadMsgPack = alkRead + msgPackSuffix;
+const std::string phReadMsgPack = phRead + msgPackSuffix;
+
+enum class TelemetryEncoding : uint8_t {
+    JSON,
+    MSGPACK,
+    // for migrating consumers over
+    JSON_AND_MSGPACK,
+};
+
 // TODO: this should live outside mqtt
 class Publisher {
    public:
     virtual void publishPH(const ph::PHReading& phReading) = 0;
     virtual void publishAlkReading(const alk_measure::AlkReading& alkReading) = 0;
-    virtual void publishMeasureAlk(const std::string& title, const unsigned long asOfMS);
+    virtual void publishMeasureAlk(const std::string& title, const unsigned long asOfMS) = 0;
 
     virtual ~Publisher() {}
 };
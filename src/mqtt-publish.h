@@ -4,29 +4,41 @@
 
 // Arduino Libraries
 #include <ArduinoJson.h>
-#include <TinyMqtt.h>
 
 // Buff Libraries
+#include "buff-metrics.h"
 #include "mqtt-common.h"
+#include "mqtt-outbox.h"
 #include "readings/alk-measure.h"
 #include "readings/ph-common.h"
 
 namespace buff {
 namespace mqtt {
 
+// Every pH reading is also batched into an array of [asOfAdjustedSec, calibratedPH_mavg]
+// samples published on this topic, since readings/ph only carries the latest one
+const std::string phHistory("readings/ph/history");
+const unsigned long PH_HISTORY_INTERVAL_MS = 60 * 1000;
+
+// Serializes readings into the outbox, which the network task publishes from.
+// Never blocks on the network.
 class MQTTPublisher : public Publisher {
    public:
-    MQTTPublisher(std::shared_ptr<MqttClient> mqttClient) : _mqttClient(mqttClient) {}
-
-    virtual void publishMessage(const Topic& topic, const DynamicJsonDocument& doc) {
-        String serializedDoc;
-        serializeJson(doc, serializedDoc);
+    MQTTPublisher(std::shared_ptr<richiev::mqtt::DefaultOutbox> outbox, const TelemetryEncoding encoding = TelemetryEncoding::JSON)
+        : _outbox(outbox), _encoding(encoding) {
+        _outbox->setEnvelope(phHistory.c_str(), PH_HISTORY_INTERVAL_MS);
+    }
 
-        _mqttClient->publish(topic, serializedDoc);
+    virtual void publishMessage(const std::string& topic, const JsonDocument& doc) {
+        char payload[richiev::mqtt::MAX_QUEUED_PAYLOAD_LEN];
+        size_t length;
+        if (encodeJSON(doc, payload, length)) {
+            _outbox->send(topic.c_str(), payload, length);
+        }
     }
 
     void publishPH(const ph::PHReading& phReading) {
-        DynamicJsonDocument updateDoc(256);
+        StaticJsonDocument<JSON_OBJECT_SIZE(6)> updateDoc;
 
         updateDoc["asOf"] = phReading.asOfMS;
         updateDoc["asOfAdjustedSec"] = phReading.asOfAdjustedSec;
@@ -35,35 +47,83 @@ class MQTTPublisher : public Publisher {
         updateDoc["calibratedPH"] = phReading.calibratedPH;
         updateDoc["calibratedPH_mavg"] = phReading.calibratedPH_mavg;
 
-        publishMessage(Topic(phRead), updateDoc);
+        char payload[richiev::mqtt::MAX_QUEUED_PAYLOAD_LEN];
+        // only the latest reading matters if the network falls behind
+        size_t length;
+        if (sendsJSON() && encodeJSON(updateDoc, payload, length)) {
+            _outbox->coalesce(phRead.c_str(), payload, length);
+        }
+        if (sendsMsgPack() && encodeMsgPack(updateDoc, payload, length)) {
+            _outbox->coalesce(phReadMsgPack.c_str(), payload, length);
+        }
+
+        const int sampleLength = snprintf(payload, sizeof(payload), "[%lu,%.2f]", phReading.asOfAdjustedSec, phReading.calibratedPH_mavg);
+        if (sampleLength > 0 && (size_t)sampleLength < sizeof(payload)) {
+            _outbox->batch(payload, sampleLength);
+        }
     }
 
     void publishAlkReading(const alk_measure::AlkReading& alkReading) {
-        DynamicJsonDocument updateDoc(512);
+        StaticJsonDocument<JSON_OBJECT_SIZE(7)> updateDoc;
 
         updateDoc["asOf"] = alkReading.asOfMS;
         updateDoc["asOfAdjustedSec"] = alkReading.asOfAdjustedSec;
-        updateDoc["title"] = alkReading.title;
+        // stored by pointer, alkReading outlives the doc
+        updateDoc["title"] = alkReading.title.c_str();
         updateDoc["reagentVolumeML"] = alkReading.reagentVolumeML;
         updateDoc["tankWaterVolumeML"] = alkReading.tankWaterVolumeML;
         updateDoc["alkReadingDKH"] = alkReading.alkReadingDKH;
 
         updateDoc["calibratedPH_mavg"] = alkReading.phReading.calibratedPH_mavg;
 
-        publishMessage(Topic(alkRead), updateDoc);
+        if (sendsJSON()) {
+            publishMessage(alkRead, updateDoc);
+        }
+        if (sendsMsgPack()) {
+            char payload[richiev::mqtt::MAX_QUEUED_PAYLOAD_LEN];
+            size_t length;
+            if (encodeMsgPack(updateDoc, payload, length)) {
+                _outbox->send(alkReadMsgPack.c_str(), payload, length);
+            }
+        }
     }
 
     void publishMeasureAlk(const std::string& title, const unsigned long asOfMS) {
-        DynamicJsonDocument updateDoc(128);
+        StaticJsonDocument<JSON_OBJECT_SIZE(2)> updateDoc;
 
         updateDoc["asOf"] = asOfMS;
-        updateDoc["title"] = title;
+        updateDoc["title"] = title.c_str();
 
-        publishMessage(Topic(measureAlk), updateDoc);
+        publishMessage(measureAlk, updateDoc);
     }
 
    private:
-    std::shared_ptr<MqttClient> _mqttClient;
+    std::shared_ptr<richiev::mqtt::DefaultOutbox> _outbox;
+    const TelemetryEncoding _encoding;
+
+    bool sendsJSON() const { return _encoding != TelemetryEncoding::MSGPACK; }
+    bool sendsMsgPack() const { return _encoding != TelemetryEncoding::JSON; }
+
+    // serializeJson & serializeMsgPack cut anything too big for the outbox's
+    // slots short, so it's measured first, and dropped & counted instead.
+    // serializeJson needs room for its terminator too.
+    static bool encodeJSON(const JsonDocument& doc, char (&payload)[richiev::mqtt::MAX_QUEUED_PAYLOAD_LEN], size_t& length) {
+        if (measureJson(doc) >= sizeof(payload)) {
+            metrics::oversizedMessagesDropped.increment();
+            return false;
+        }
+        length = serializeJson(doc, payload, sizeof(payload));
+        return true;
+    }
+
+    static bool encodeMsgPack(const JsonDocument& doc, char (&payload)[richiev::mqtt::MAX_QUEUED_PAYLOAD_LEN], size_t& length) {
+        if (measureMsgPack(doc) > sizeof(payload)) {
+            metrics::oversizedMessagesDropped.increment();
+            return false;
+        }
+        length = serializeMsgPack(doc, payload, sizeof(payload));
+        return true;
+    }
 };
 
 }  // namespace mqtt
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TinyMqtt.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+// Buff Libraries
+#include "buff-metrics.h"
+#include "metrics.h"
+#include "mqtt-outbox.h"
+#include "mqtt.h"
+#include "readings/trace-store.h"
+#include "tasks.h"
+#include "upstream-bridge.h"
+
+namespace buff {
+namespace network {
+
+/*******************************
+ * Network task
+ *
+ * Owns the MQTT broker & client: runs their loops and publishes whatever's
+ * in the outbox (forwarding it upstream too, if bridged). Received messages
+ * go into the inbox, and are dispatched from the process task
+ * (richiev::mqtt::dispatchInbox). Finished measurement traces are written to
+ * flash from here too.
+ *******************************/
+inline auto outbox = std::make_shared<richiev::mqtt::DefaultOutbox>();
+
+// the profile report's too big for the outbox, so it's published straight from the network task
+const char *const PROFILE_REPORT_TOPIC = "stats/profile";
+inline std::atomic<bool> profileReportRequested{false};
+
+static void requestProfileReport() {
+    profileReportRequested.store(true, std::memory_order_relaxed);
+}
+
+inline std::shared_ptr<MqttBroker> mqttBroker = nullptr;
+inline std::shared_ptr<MqttClient> mqttClient = nullptr;
+
+static bool publish(const char *topic, const char *payload, size_t length) {
+    if (upstream::bridge != nullptr) {
+        upstream::bridge->forward(topic, payload, length);
+    }
+    return mqttClient->publish(Topic(topic), payload, length) == MqttOk;
+}
+
+// every controller::NETWORK_PERIOD_MS
+static void loopNetwork() {
+    {
+        richiev::metrics::ProfileScope profile(metrics::networkSubsystemDuration);
+        richiev::mqtt::loopMQTT(mqttBroker, mqttClient);
+        if (upstream::bridge != nullptr) {
+            upstream::bridge->loop(millis());
+        }
+        outbox->drain(millis(), publish);
+    }
+    if (measurement_trace::traceStore != nullptr) {
+        measurement_trace::traceStore->persistPending();
+    }
+
+    if (profileReportRequested.exchange(false, std::memory_order_relaxed)) {
+        std::string report;
+        richiev::metrics::renderProfileReport(report);
+        publish(PROFILE_REPORT_TOPIC, report.c_str(), report.size());
+    }
+}
+
+static void setupNetwork(std::shared_ptr<MqttBroker> broker, std::shared_ptr<MqttClient> client) {
+    richiev::mqtt::inbox = std::make_shared<richiev::mqtt::DefaultInbox>();
+    mqttBroker = broker;
+    mqttClient = client;
+}
+
+/*******************************
+ * Metrics
+ *******************************/
+#define BUFF_OUTBOX_COUNTER(var, name, help, field) \
+    inline richiev::metrics::CallbackCounter var(name, help, []() -> uint32_t { return outbox->stats().field.load(std::memory_order_relaxed); });
+
+BUFF_OUTBOX_COUNTER(outboxEnqueued, "buff_mqtt_outbox_enqueued_total", "Messages accepted into the MQTT outbox", enqueued)
+BUFF_OUTBOX_COUNTER(outboxDropped, "buff_mqtt_outbox_dropped_total", "Messages dropped because the MQTT outbox was full", dropped)
+BUFF_OUTBOX_COUNTER(outboxCoalesced, "buff_mqtt_outbox_coalesced_total", "Messages replaced by a newer one before being sent", coalesced)
+BUFF_OUTBOX_COUNTER(outboxPublished, "buff_mqtt_outbox_published_total", "Messages published from the MQTT outbox", published)
+BUFF_OUTBOX_COUNTER(outboxPublishFailures, "buff_mqtt_outbox_publish_failures_total", "Messages the MQTT client failed to publish", publishFailures)
+
+#undef BUFF_OUTBOX_COUNTER
+
+inline richiev::metrics::CallbackGauge outboxDepth("buff_mqtt_outbox_depth", "Messages waiting in the MQTT outbox", []() -> int32_t { return outbox->depth(); });
+inline richiev::metrics::CallbackGauge outboxHighWater("buff_mqtt_outbox_high_water", "Most messages ever waiting in the MQTT outbox", []() -> int32_t { return outbox->stats().highWater.load(std::memory_order_relaxed); });
+inline richiev::metrics::CallbackCounter inboxDropped("buff_mqtt_inbox_dropped_total", "Received messages dropped because the inbox was full", []() -> uint32_t {
+    return richiev::mqtt::inbox != nullptr ? richiev::mqtt::inbox->dropped() : 0;
+});
+
+}  // namespace network
+}  // namespace buff
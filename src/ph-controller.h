@@ -6,6 +6,7 @@
 #include "RVMovingAvg.h"
 
 // Buff Libraries
+#include "buff-metrics.h"
 #include "readings/ph.h"
 
 /*******************************
@@ -21,7 +22,8 @@ class PHReadingStats {
     RVMovingAvg<NUM_SAMPLES, unsigned int, unsigned long> _rawPHStats;
     RVMovingAvg<NUM_SAMPLES, unsigned int, unsigned long> _calibPHStats;
 
-    const float phMetricScaleFactor = 10000;
+    // static, so the stats stay assignable (they're held by value in a measurement)
+    static constexpr float phMetricScaleFactor = 10000;
 
     PHReading _mostRecentReading;
 
@@ -42,11 +44,11 @@ class PHReadingStats {
         return _mostRecentReading;
     }
 
-    size_t readingCount() {
+    size_t readingCount() const {
         return _rawPHStats.size();
     }
 
-    bool receivedMinReadings() {
+    bool receivedMinReadings() const {
         return readingCount() >= NUM_SAMPLES;
     }
 };
@@ -56,8 +58,6 @@ class PHReader {
     const PHCalibrator _phCalibrator;
     const PHReadConfig _phReadConfig;
 
-    unsigned long nextPHReadTime = 0;
-
    public:
     PHReader(const PHReadConfig phReadConfig, const PHCalibrator &phCalibrator) : _phReadConfig(phReadConfig), _phCalibrator(phCalibrator) {}
 
@@ -66,7 +66,11 @@ class PHReader {
             currentMillis = millis();
         }
 
-        const auto ph = (_phReadConfig.phReadFunc)();
+        float ph;
+        {
+            richiev::metrics::ScopedTimer timer(metrics::phReadDuration);
+            ph = (_phReadConfig.phReadFunc)();
+        }
         const auto calibratedPH = _phCalibrator.convert(ph);
 
         PHReading phReading = {.asOfMS = currentMillis, .rawPH = ph, .calibratedPH = calibratedPH};
@@ -79,19 +83,13 @@ class PHReader {
         return phReadingStats.addAlkReading(phReading);
     }
 
-    template <size_t NUM_SAMPLES>
-    std::unique_ptr<PHReading> readNewPHSignalIfTimeAndUpdate(PHReadingStats<NUM_SAMPLES> &phReadingStats) {
-        unsigned long currentMillis = millis();
-
-        if (nextPHReadTime > currentMillis) {
-            return nullptr;
-        }
-
-        auto phReading = readNewPHSignalWithStats<NUM_SAMPLES>(phReadingStats, currentMillis);
-
-        nextPHReadTime = millis() + _phReadConfig.readIntervalMS;
+    const PHCalibrator &getCalibrator() const {
+        return _phCalibrator;
+    }
 
-        return std::make_unique<PHReading>(phReadingStats.mostRecentReading());
+    // how often readings should be taken, the caller schedules them
+    unsigned int getReadIntervalMS() const {
+        return _phReadConfig.readIntervalMS;
     }
 };
 
@@ -60,5 +60,26 @@ struct AlkMeasurementConfig {
     float calibrationMultiplier = 1.0;
 };
 
+// Every AlkMeasurementConfig field, as X(name, type). Used to derive the
+// command decoding schema, keep in sync with the struct.
+#define ALK_MEASUREMENT_CONFIG_FIELDS(X)      \
+    X(primeTankWaterFillVolumeML, float)     \
+    X(primeReagentReverseVolumeML, float)    \
+    X(primeReagentVolumeML, float)           \
+    X(measurementTankWaterVolumeML, float)   \
+    X(extraPurgeVolumeML, float)             \
+    X(initialReagentDoseVolumeML, float)     \
+    X(maxReagentDoseML, float)               \
+    X(incrementalReagentDoseVolumeML, float) \
+    X(stirAmountML, float)                   \
+    X(stirTimes, int)                        \
+    X(reagentStrengthMoles, float)           \
+    X(calibrationMultiplier, float)
+
+#define ALK_CONFIG_FIELD_SIZE(name, type) +sizeof(type)
+static_assert(sizeof(AlkMeasurementConfig) == 0 ALK_MEASUREMENT_CONFIG_FIELDS(ALK_CONFIG_FIELD_SIZE),
+              "AlkMeasurementConfig has fields missing from ALK_MEASUREMENT_CONFIG_FIELDS");
+#undef ALK_CONFIG_FIELD_SIZE
+
 }  // namespace alk_measure
 }  // namespace buff
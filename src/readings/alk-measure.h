@@ -2,11 +2,15 @@
 
 #include <Arduino.h>
 
+#include <optional>
+
 // Buff Libraries
+#include "buff-metrics.h"
 #include "doser/doser.h"
 #include "mqtt-common.h"
 #include "ph-controller.h"
 #include "readings/alk-measure-common.h"
+#include "readings/measurement-trace.h"
 #include "readings/ph.h"
 #include "time-common.h"
 
@@ -41,43 +45,47 @@ static const std::map<MeasurementStepAction, std::string> MEASUREMENT_STEP_ACTIO
      {DOSE, "DOSE"},
      {STEP_DONE, "STEP_DONE"}};
 
-static void stirForABit(doser::BuffDosers &buffDosers, const AlkMeasurementConfig &alkMeasureConf) {
-    std::shared_ptr<doser::Doser> drainDoser = buffDosers.selectDoser(MeasurementDoserType::DRAIN);
+static richiev::metrics::Histogram *stepDurationFor(const MeasurementAction action) {
+    switch (action) {
+        case PRIME:
+            return &metrics::primeStepDuration;
+        case CLEAN_AND_FILL:
+            return &metrics::cleanAndFillStepDuration;
+        case MEASURE:
+            return &metrics::measureStepDuration;
+        case CLEANUP:
+            return &metrics::cleanupStepDuration;
+        default:
+            return nullptr;
+    }
+}
 
+static void stirForABit(doser::BuffDosers &buffDosers, const AlkMeasurementConfig &alkMeasureConf) {
     // just blow some liquid out to cause some bubbles
-    drainDoser->doseML(-alkMeasureConf.stirAmountML);
+    buffDosers.doseML(MeasurementDoserType::DRAIN, -alkMeasureConf.stirAmountML);
 }
 
 // Pushes a bit of fluid out of the fill dosers, to make sure when we begin
 // using them for measurement that we don't miss some initial drops. This
 // helps counteract the effects of any back-siphoning.
 static void primeDosers(std::shared_ptr<doser::BuffDosers> buffDosers, const AlkMeasurementConfig &alkMeasureConf) {
-    std::shared_ptr<doser::Doser> waterFillDoser = buffDosers->selectDoser(MeasurementDoserType::FILL);
-    std::shared_ptr<doser::Doser> reagentDoser = buffDosers->selectDoser(MeasurementDoserType::REAGENT);
-
-    waterFillDoser->doseML(alkMeasureConf.primeTankWaterFillVolumeML / 2.0);
-    reagentDoser->doseML(alkMeasureConf.primeReagentReverseVolumeML);
-    reagentDoser->doseML(alkMeasureConf.primeReagentVolumeML);
-    waterFillDoser->doseML(alkMeasureConf.primeTankWaterFillVolumeML / 2.0);
+    buffDosers->doseML(MeasurementDoserType::FILL, alkMeasureConf.primeTankWaterFillVolumeML / 2.0);
+    buffDosers->doseML(MeasurementDoserType::REAGENT, alkMeasureConf.primeReagentReverseVolumeML);
+    buffDosers->doseML(MeasurementDoserType::REAGENT, alkMeasureConf.primeReagentVolumeML);
+    buffDosers->doseML(MeasurementDoserType::FILL, alkMeasureConf.primeTankWaterFillVolumeML / 2.0);
 }
 
 static void drainMeasurementVessel(doser::BuffDosers &buffDosers, const AlkMeasurementConfig &alkMeasureConf) {
-    std::shared_ptr<doser::Doser> drainDoser = buffDosers.selectDoser(MeasurementDoserType::DRAIN);
-
-    drainDoser->doseML(alkMeasureConf.measurementTankWaterVolumeML + alkMeasureConf.extraPurgeVolumeML);
+    buffDosers.doseML(MeasurementDoserType::DRAIN, alkMeasureConf.measurementTankWaterVolumeML + alkMeasureConf.extraPurgeVolumeML);
 }
 
 static void fillMeasurementVessel(doser::BuffDosers &buffDosers, const AlkMeasurementConfig &alkMeasureConf, AlkReading &alkReading) {
-    std::shared_ptr<doser::Doser> waterFillDoser = buffDosers.selectDoser(MeasurementDoserType::FILL);
-
-    waterFillDoser->doseML(alkMeasureConf.measurementTankWaterVolumeML);
+    buffDosers.doseML(MeasurementDoserType::FILL, alkMeasureConf.measurementTankWaterVolumeML);
     alkReading.tankWaterVolumeML += alkMeasureConf.measurementTankWaterVolumeML;
 }
 
 static void addReagentDose(doser::BuffDosers &buffDosers, const float amountML, AlkReading &alkReading) {
-    std::shared_ptr<doser::Doser> reagentDoser = buffDosers.selectDoser(MeasurementDoserType::REAGENT);
-
-    reagentDoser->doseML(amountML);
+    buffDosers.doseML(MeasurementDoserType::REAGENT, amountML);
     alkReading.reagentVolumeML += amountML;
 }
 
@@ -112,10 +120,15 @@ class MeasurementStepResult {
     AlkReading alkReading;
     AlkReading primeAndCleanupScratchData;
 
-    std::shared_ptr<ph::controller::PHReadingStats<NUM_SAMPLES>> measuredPHStats;
+    // held by value, it's started afresh every dose cycle and would otherwise
+    // be a heap allocation each time
+    std::optional<ph::controller::PHReadingStats<NUM_SAMPLES>> measuredPHStats;
 
     AlkMeasurementConfig alkMeasureConf;
 
+    // the trace the measurement's recorded in (see AlkMeasurer::traceTo), 0 if it isn't
+    uint32_t traceID = 0;
+
     void setTime(const unsigned long asOf, const unsigned long asOfAdjustedSec) {
         this->asOfMS = alkReading.asOfMS = primeAndCleanupScratchData.asOfMS = asOf;
         this->asOfAdjustedSec = alkReading.asOfAdjustedSec = primeAndCleanupScratchData.asOfAdjustedSec = asOfAdjustedSec;
@@ -127,29 +140,17 @@ class AlkMeasurer {
     std::shared_ptr<doser::BuffDosers> _buffDosers;
     const AlkMeasurementConfig _defaultAlkMeasurementConf;
     const std::shared_ptr<ph::controller::PHReader> _phReader;
-
-   public:
-    AlkMeasurer(std::shared_ptr<doser::BuffDosers> buffDosers, const AlkMeasurementConfig alkMeasureConf, const std::shared_ptr<ph::controller::PHReader> phReader) : _buffDosers(buffDosers), _defaultAlkMeasurementConf(alkMeasureConf), _phReader(phReader) {}
+    std::shared_ptr<measurement_trace::TraceRecorder> _trace = nullptr;
+    // the measurement being recorded, 0 if none is
+    uint32_t _tracingID = 0;
+    uint32_t _lastTraceID = 0;
+    // whether the step running is the recorded measurement's, so its doses are
+    bool _tracingStep = false;
 
     template <size_t NUM_SAMPLES>
-    MeasurementStepResult<NUM_SAMPLES> begin(const unsigned long asOfMS, const unsigned long asOfAdjustedSec, const std::string &title) {
-        return begin<NUM_SAMPLES>(_defaultAlkMeasurementConf, asOfMS, asOfAdjustedSec, title);
-    }
+    MeasurementStepResult<NUM_SAMPLES> measureAlkStep(std::shared_ptr<mqtt::Publisher> publisher, std::shared_ptr<buff_time::TimeWrapper> timeClient, const MeasurementStepResult<NUM_SAMPLES> &prevResult) {
+        richiev::metrics::ScopedTimer stepTimer(stepDurationFor(prevResult.nextAction));
 
-    template <size_t NUM_SAMPLES>
-    MeasurementStepResult<NUM_SAMPLES> begin(const AlkMeasurementConfig &alkMeasureConf, const unsigned long asOfMS, const unsigned long asOfAdjustedSec, const std::string &title) {
-        MeasurementStepResult<NUM_SAMPLES> r;
-        r.nextAction = PRIME;
-        r.nextMeasurementStepAction = STEP_INITIALIZE;
-        r.alkMeasureConf = alkMeasureConf;
-        r.measurementStartedAtMS = asOfMS;
-        r.setTime(asOfMS, asOfAdjustedSec);
-        r.alkReading.title = title;
-        return r;
-    }
-
-    template <size_t NUM_SAMPLES>
-    MeasurementStepResult<NUM_SAMPLES> measureAlk(std::shared_ptr<mqtt::Publisher> publisher, std::shared_ptr<buff_time::TimeWrapper> timeClient, const MeasurementStepResult<NUM_SAMPLES> &prevResult) {
         // TODO: wrap this in a transaction/finally equivalent
         if (prevResult.nextAction == PRIME) {
             MeasurementStepResult<NUM_SAMPLES> r = prevResult;
@@ -184,10 +185,11 @@ class AlkMeasurer {
             MeasurementStepResult<NUM_SAMPLES> r = prevResult;
 
             if (prevResult.nextMeasurementStepAction == MeasurementStepAction::STEP_INITIALIZE) {
-                r.measuredPHStats = std::make_shared<ph::controller::PHReadingStats<NUM_SAMPLES>>();
+                r.measuredPHStats.emplace();
                 r.nextMeasurementStepAction = MeasurementStepAction::MEASURE_PH;
             } else if (prevResult.nextMeasurementStepAction == MeasurementStepAction::MEASURE_PH) {
                 auto newPHReading = _phReader->readNewPHSignal();
+                if (_tracingStep) _trace->phSample(newPHReading.rawPH, newPHReading.asOfMS);
                 auto phReading = r.measuredPHStats->addAlkReading(newPHReading);
                 r.alkReading.phReading = phReading;
 
@@ -243,6 +245,77 @@ class AlkMeasurer {
         assert(false);
     }
 
+   public:
+    AlkMeasurer(std::shared_ptr<doser::BuffDosers> buffDosers, const AlkMeasurementConfig alkMeasureConf, const std::shared_ptr<ph::controller::PHReader> phReader) : _buffDosers(buffDosers), _defaultAlkMeasurementConf(alkMeasureConf), _phReader(phReader) {}
+    AlkMeasurer(const AlkMeasurer &) = delete;
+
+    ~AlkMeasurer() {
+        if (_trace != nullptr) _buffDosers->onDose = nullptr;
+    }
+
+    // Records measurements begun from here on, their pH samples, doses &
+    // decisions. One's recorded at a time: a measurement begun while another's
+    // being recorded (eg a manual one during an auto one) isn't.
+    void traceTo(std::shared_ptr<measurement_trace::TraceRecorder> trace) {
+        _trace = trace;
+        _buffDosers->onDose = [this](MeasurementDoserType doserType, float ml) {
+            if (_tracingStep) _trace->dose(doserType, ml, millis());
+        };
+    }
+
+    // Stops recording the measurement if it's the one being recorded, eg it's
+    // being replaced before it finished
+    template <size_t NUM_SAMPLES>
+    void abandon(const MeasurementStepResult<NUM_SAMPLES> &result) {
+        if (_trace == nullptr || result.traceID == 0 || result.traceID != _tracingID) return;
+        _trace->abandon();
+        _tracingID = 0;
+    }
+
+    template <size_t NUM_SAMPLES>
+    MeasurementStepResult<NUM_SAMPLES> begin(const unsigned long asOfMS, const unsigned long asOfAdjustedSec, const std::string &title) {
+        return begin<NUM_SAMPLES>(_defaultAlkMeasurementConf, asOfMS, asOfAdjustedSec, title);
+    }
+
+    template <size_t NUM_SAMPLES>
+    MeasurementStepResult<NUM_SAMPLES> begin(const AlkMeasurementConfig &alkMeasureConf, const unsigned long asOfMS, const unsigned long asOfAdjustedSec, const std::string &title) {
+        MeasurementStepResult<NUM_SAMPLES> r;
+        r.nextAction = PRIME;
+        r.nextMeasurementStepAction = STEP_INITIALIZE;
+        r.alkMeasureConf = alkMeasureConf;
+        r.measurementStartedAtMS = asOfMS;
+        r.setTime(asOfMS, asOfAdjustedSec);
+        r.alkReading.title = title;
+        if (_trace != nullptr && _tracingID == 0) {
+            r.traceID = _tracingID = ++_lastTraceID;
+            _trace->begin(title, NUM_SAMPLES, alkMeasureConf, _phReader->getCalibrator(), asOfMS, asOfAdjustedSec);
+        } else if (_trace != nullptr) {
+            Serial.print("Already tracing a measurement, not tracing title=");
+            Serial.println(title.c_str());
+        }
+        return r;
+    }
+
+    template <size_t NUM_SAMPLES>
+    MeasurementStepResult<NUM_SAMPLES> measureAlk(std::shared_ptr<mqtt::Publisher> publisher, std::shared_ptr<buff_time::TimeWrapper> timeClient, const MeasurementStepResult<NUM_SAMPLES> &prevResult) {
+        const bool traced = _trace != nullptr && prevResult.traceID != 0 && prevResult.traceID == _tracingID;
+        _tracingStep = traced;
+        MeasurementStepResult<NUM_SAMPLES> r = measureAlkStep(publisher, timeClient, prevResult);
+        _tracingStep = false;
+
+        if (traced && prevResult.nextAction != MEASURE_DONE) {
+            // taking another sample is implied by the sample
+            if (r.nextAction != MEASURE || r.nextMeasurementStepAction != MEASURE_PH) {
+                _trace->step(r.nextAction, r.nextMeasurementStepAction, r.asOfMS);
+            }
+            if (r.nextAction == MEASURE_DONE) {
+                _trace->finish(r.alkReading);
+                _tracingID = 0;
+            }
+        }
+        return r;
+    }
+
     const AlkMeasurementConfig getDefaultAlkMeasurementConfig() {
         return _defaultAlkMeasurementConf;
     }
@@ -267,12 +340,15 @@ class AlkMeasureLooper {
     }
 };
 
+// Starts a measurement in looper, replacing (and abandoning) any previous one. Loopers are kept
+// in fixed storage (see controller.h) rather than allocated per measurement.
 template <size_t NUM_SAMPLES>
-static std::unique_ptr<AlkMeasureLooper<NUM_SAMPLES>> beginAlkMeasureLoop(std::shared_ptr<AlkMeasurer> alkMeasurer, std::shared_ptr<mqtt::Publisher> publisher, std::shared_ptr<buff_time::TimeWrapper> timeClient, const AlkMeasurementConfig &beginAlkMeasureConf, const std::string &title) {
+static AlkMeasureLooper<NUM_SAMPLES> &beginAlkMeasureLoop(std::optional<AlkMeasureLooper<NUM_SAMPLES>> &looper, std::shared_ptr<AlkMeasurer> alkMeasurer, std::shared_ptr<mqtt::Publisher> publisher, std::shared_ptr<buff_time::TimeWrapper> timeClient, const AlkMeasurementConfig &beginAlkMeasureConf, const std::string &title) {
+    if (looper) alkMeasurer->abandon(looper->getLastStepResult());
     auto beginResult = alkMeasurer->begin<NUM_SAMPLES>(beginAlkMeasureConf, millis(), timeClient->getAdjustedTimeSeconds(), title);
-    auto looper = std::make_unique<AlkMeasureLooper<NUM_SAMPLES>>(alkMeasurer, publisher, timeClient, beginResult);
+    looper.emplace(alkMeasurer, publisher, timeClient, beginResult);
 
-    return std::move(looper);
+    return *looper;
 };
 
 }  // namespace alk_measure
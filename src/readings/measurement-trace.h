@@ -0,0 +1,360 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Buff Libraries
+#include "doser/doser-config.h"
+#include "readings/alk-measure-common.h"
+#include "readings/ph.h"
+
+namespace buff {
+namespace measurement_trace {
+
+/*******************************
+ * Measurement traces
+ *
+ * A compact binary record of one measurement as it ran in the field: the
+ * config & pH calibration it used, every raw pH sample, dose and decision,
+ * with their timing, and the result. The device keeps the last few in a ring
+ * in flash (served from /export/traces), and on the desktop they can be fed
+ * back through AlkMeasurer (see sim/trace-replay.h) to reproduce exactly what
+ * the measurement did.
+ *
+ * Layout, little endian like both the ESP32 & the desktop:
+ *   header  version, flags, sample count, start times, calibration points,
+ *           config (in ALK_MEASUREMENT_CONFIG_FIELDS order), result
+ *   events  type, ms since the previous event (varint), then
+ *             PH_SAMPLE  raw pH (f32)
+ *             DOSE       doser type (u8), ml (f32)
+ *             STEP       next action << 4 | next step action (u8)
+ *
+ * Steps that just take another pH sample aren't recorded, the sample that
+ * follows says as much, which keeps a typical measurement around 2-3KB.
+ *******************************/
+const uint8_t TRACE_VERSION = 1;
+
+// A trace stops recording events once it's this big, flagged TRUNCATED
+const size_t MAX_TRACE_LENGTH = 8000;
+// Longer titles are cut short
+const size_t MAX_TITLE_LENGTH = 63;
+
+enum TraceFlags : uint8_t {
+    FINISHED = 1,
+    TRUNCATED = 2
+};
+
+enum EventType : uint8_t {
+    PH_SAMPLE = 1,
+    DOSE = 2,
+    STEP = 3
+};
+
+struct Event {
+    EventType type;
+    // since the measurement began
+    unsigned long atMS = 0;
+
+    // raw pH for PH_SAMPLE, ml for DOSE
+    float value = 0;
+    MeasurementDoserType doserType = FILL;
+    // MeasurementAction & MeasurementStepAction, for STEP
+    uint8_t action = 0;
+    uint8_t stepAction = 0;
+
+    // the same thing happened, whenever it did
+    bool sameAs(const Event &other) const {
+        return type == other.type && value == other.value && doserType == other.doserType &&
+               action == other.action && stepAction == other.stepAction;
+    }
+};
+
+struct Trace {
+    std::string title;
+    uint8_t flags = 0;
+    uint16_t numSamples = 0;
+    unsigned long startedAtMS = 0;
+    unsigned long startedAtAdjustedSec = 0;
+
+    float lowActualPH = 4.0;
+    float lowReadPH = 4.0;
+    float highActualPH = 7.0;
+    float highReadPH = 7.0;
+
+    alk_measure::AlkMeasurementConfig config;
+
+    float alkReadingDKH = 0;
+    float tankWaterVolumeML = 0;
+    float reagentVolumeML = 0;
+
+    std::vector<Event> events;
+
+    bool finished() const { return flags & FINISHED; }
+    bool truncated() const { return flags & TRUNCATED; }
+
+    ph::PHCalibrator calibrator() const {
+        return ph::PHCalibrator({.actualPH = lowActualPH, .readPH = lowReadPH}, {.actualPH = highActualPH, .readPH = highReadPH});
+    }
+};
+
+/*******************************
+ * Encoding
+ *******************************/
+class Writer {
+   private:
+    uint8_t *_data;
+    const size_t _capacity;
+    size_t _length = 0;
+
+   public:
+    Writer(uint8_t *data, const size_t capacity, const size_t length = 0) : _data(data), _capacity(capacity), _length(length) {}
+
+    template <typename T>
+    void put(const T value) {
+        if (_length + sizeof(T) > _capacity) return;
+        memcpy(_data + _length, &value, sizeof(T));
+        _length += sizeof(T);
+    }
+
+    void putVarint(uint32_t value) {
+        while (value >= 0x80) {
+            put<uint8_t>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        put<uint8_t>(value);
+    }
+
+    size_t length() const { return _length; }
+};
+
+class Reader {
+   private:
+    const uint8_t *_data;
+    const size_t _length;
+    size_t _offset = 0;
+    bool _ok = true;
+
+   public:
+    Reader(const uint8_t *data, const size_t length) : _data(data), _length(length) {}
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (_offset + sizeof(T) > _length) {
+            _ok = false;
+            return value;
+        }
+        memcpy(&value, _data + _offset, sizeof(T));
+        _offset += sizeof(T);
+        return value;
+    }
+
+    uint32_t getVarint() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35 && _ok; shift += 7) {
+            const uint8_t byte = get<uint8_t>();
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        _ok = false;
+        return value;
+    }
+
+    bool ok() const { return _ok; }
+    bool atEnd() const { return _offset >= _length; }
+};
+
+// type + varint + doser type + f32
+const size_t MAX_EVENT_LENGTH = 1 + 5 + 1 + 4;
+
+/*******************************
+ * Recorder
+ *
+ * Fed by AlkMeasurer (see AlkMeasurer::traceTo) on the process task. The
+ * trace is built up in RAM and handed to onFinished once the measurement's
+ * done, a measurement that's abandoned part way is never handed over.
+ *******************************/
+class TraceRecorder {
+   private:
+    uint8_t _data[MAX_TRACE_LENGTH];
+    size_t _length = 0;
+    // where the result gets written once it's known
+    size_t _resultOffset = 0;
+
+    bool _recording = false;
+    std::string _title;
+    unsigned long _lastEventMS = 0;
+
+    static const size_t FLAGS_OFFSET = 1;
+
+    bool beginEvent(const EventType type, const unsigned long asOfMS) {
+        if (!_recording) return false;
+        if (_length + MAX_EVENT_LENGTH > MAX_TRACE_LENGTH) {
+            _data[FLAGS_OFFSET] |= TRUNCATED;
+            return false;
+        }
+        Writer writer(_data, MAX_TRACE_LENGTH, _length);
+        writer.put<uint8_t>(type);
+        writer.putVarint(asOfMS - _lastEventMS);
+        _length = writer.length();
+        _lastEventMS = asOfMS;
+        return true;
+    }
+
+   public:
+    // given each finished trace, eg to keep it in flash
+    std::function<void(const std::string &title, const uint8_t *data, size_t length)> onFinished;
+
+    void begin(const std::string &title, const uint16_t numSamples, const alk_measure::AlkMeasurementConfig &config, const ph::PHCalibrator &calibrator, const unsigned long asOfMS, const unsigned long asOfAdjustedSec) {
+        _title = title.substr(0, MAX_TITLE_LENGTH);
+        _lastEventMS = asOfMS;
+        _recording = true;
+
+        Writer writer(_data, MAX_TRACE_LENGTH);
+        writer.put<uint8_t>(TRACE_VERSION);
+        writer.put<uint8_t>(0);
+        writer.put<uint16_t>(numSamples);
+        writer.put<uint32_t>(asOfMS);
+        writer.put<uint32_t>(asOfAdjustedSec);
+        writer.put<float>(calibrator.lowPoint().actualPH);
+        writer.put<float>(calibrator.lowPoint().readPH);
+        writer.put<float>(calibrator.highPoint().actualPH);
+        writer.put<float>(calibrator.highPoint().readPH);
+#define PUT_CONFIG_FIELD(name, type) writer.put<type>(config.name);
+        ALK_MEASUREMENT_CONFIG_FIELDS(PUT_CONFIG_FIELD)
+#undef PUT_CONFIG_FIELD
+        _resultOffset = writer.length();
+        writer.put<float>(0);
+        writer.put<float>(0);
+        writer.put<float>(0);
+        _length = writer.length();
+    }
+
+    void phSample(const float rawPH, const unsigned long asOfMS) {
+        if (!beginEvent(PH_SAMPLE, asOfMS)) return;
+        Writer writer(_data, MAX_TRACE_LENGTH, _length);
+        writer.put<float>(rawPH);
+        _length = writer.length();
+    }
+
+    void dose(const MeasurementDoserType doserType, const float ml, const unsigned long asOfMS) {
+        if (!beginEvent(DOSE, asOfMS)) return;
+        Writer writer(_data, MAX_TRACE_LENGTH, _length);
+        writer.put<uint8_t>(doserType);
+        writer.put<float>(ml);
+        _length = writer.length();
+    }
+
+    void step(const uint8_t action, const uint8_t stepAction, const unsigned long asOfMS) {
+        if (!beginEvent(STEP, asOfMS)) return;
+        Writer writer(_data, MAX_TRACE_LENGTH, _length);
+        writer.put<uint8_t>(action << 4 | (stepAction & 0x0F));
+        _length = writer.length();
+    }
+
+    void finish(const alk_measure::AlkReading &alkReading) {
+        if (!_recording) return;
+        _recording = false;
+        _data[FLAGS_OFFSET] |= FINISHED;
+
+        Writer writer(_data, MAX_TRACE_LENGTH, _resultOffset);
+        writer.put<float>(alkReading.alkReadingDKH);
+        writer.put<float>(alkReading.tankWaterVolumeML);
+        writer.put<float>(alkReading.reagentVolumeML);
+
+        if (onFinished) onFinished(_title, _data, _length);
+    }
+
+    // drops the measurement being recorded, eg it was replaced before it finished
+    void abandon() { _recording = false; }
+
+    bool recording() const { return _recording; }
+};
+
+/*******************************
+ * Decoding
+ *******************************/
+static bool decode(const std::string &title, const uint8_t *data, const size_t length, Trace &trace) {
+    Reader reader(data, length);
+    if (reader.get<uint8_t>() != TRACE_VERSION) return false;
+
+    trace = Trace();
+    trace.title = title;
+    trace.flags = reader.get<uint8_t>();
+    trace.numSamples = reader.get<uint16_t>();
+    trace.startedAtMS = reader.get<uint32_t>();
+    trace.startedAtAdjustedSec = reader.get<uint32_t>();
+    trace.lowActualPH = reader.get<float>();
+    trace.lowReadPH = reader.get<float>();
+    trace.highActualPH = reader.get<float>();
+    trace.highReadPH = reader.get<float>();
+#define GET_CONFIG_FIELD(name, type) trace.config.name = reader.get<type>();
+    ALK_MEASUREMENT_CONFIG_FIELDS(GET_CONFIG_FIELD)
+#undef GET_CONFIG_FIELD
+    trace.alkReadingDKH = reader.get<float>();
+    trace.tankWaterVolumeML = reader.get<float>();
+    trace.reagentVolumeML = reader.get<float>();
+
+    unsigned long atMS = 0;
+    while (reader.ok() && !reader.atEnd()) {
+        Event event;
+        event.type = (EventType)reader.get<uint8_t>();
+        atMS += reader.getVarint();
+        event.atMS = atMS;
+
+        if (event.type == PH_SAMPLE) {
+            event.value = reader.get<float>();
+        } else if (event.type == DOSE) {
+            event.doserType = (MeasurementDoserType)reader.get<uint8_t>();
+            event.value = reader.get<float>();
+        } else if (event.type == STEP) {
+            const uint8_t actions = reader.get<uint8_t>();
+            event.action = actions >> 4;
+            event.stepAction = actions & 0x0F;
+        } else {
+            return false;
+        }
+        if (reader.ok()) trace.events.push_back(event);
+    }
+    return reader.ok();
+}
+
+/*******************************
+ * Export
+ *
+ * /export/traces is the stored traces back to back, each as
+ *   title length (u8), title, trace length (u16), trace
+ *******************************/
+static void writeExportRecord(std::string &out, const char *title, const size_t titleLength, const uint8_t *data, const size_t length) {
+    const uint8_t exportTitleLength = titleLength < MAX_TITLE_LENGTH ? titleLength : MAX_TITLE_LENGTH;
+    const uint16_t exportLength = length;
+    out.append((const char *)&exportTitleLength, sizeof(exportTitleLength));
+    out.append(title, exportTitleLength);
+    out.append((const char *)&exportLength, sizeof(exportLength));
+    out.append((const char *)data, exportLength);
+}
+
+// False if the export is cut short or a trace can't be decoded, traces before that are still added
+static bool decodeExport(const uint8_t *data, const size_t length, std::vector<Trace> &traces) {
+    Reader reader(data, length);
+    while (!reader.atEnd()) {
+        const uint8_t titleLength = reader.get<uint8_t>();
+        std::string title(titleLength, 0);
+        for (auto &c : title) c = reader.get<uint8_t>();
+        const uint16_t traceLength = reader.get<uint16_t>();
+        std::vector<uint8_t> traceData(traceLength);
+        for (auto &b : traceData) b = reader.get<uint8_t>();
+        if (!reader.ok()) return false;
+
+        Trace trace;
+        if (!decode(title, traceData.data(), traceData.size(), trace)) return false;
+        traces.push_back(std::move(trace));
+    }
+    return true;
+}
+
+}  // namespace measurement_trace
+}  // namespace buff
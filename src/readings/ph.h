@@ -29,6 +29,9 @@ class PHCalibrator {
    public:
     PHCalibrator(CalibrationPoint lowPoint, CalibrationPoint highPoint) : _lowPoint(lowPoint), _highPoint(highPoint){};
 
+    const CalibrationPoint &lowPoint() const { return _lowPoint; }
+    const CalibrationPoint &highPoint() const { return _highPoint; }
+
     float convert(float reading) const {
         // pHx - the pH of the sample
         // pHref1 - the pH of the calibration buffer 1 (generally 4)
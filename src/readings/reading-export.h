@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+
+// Buff Libraries
+#include "html-template.h"
+#include "readings/alk-measure-common.h"
+
+/*******************************
+ * Row formats for the bulk history export (/export/readings.*).
+ * Each writer appends a single row, so callers can stream rows out as they go.
+ *******************************/
+namespace buff {
+namespace reading_export {
+
+using richiev::templates::Fixed;
+using richiev::templates::render;
+
+// CSV field, quoted with embedded quotes doubled (RFC 4180)
+struct CSVQuoted {
+    const std::string &text;
+    explicit CSVQuoted(const std::string &s) : text(s) {}
+};
+
+// JSON string contents, escaped (without the surrounding quotes)
+struct JSONEscaped {
+    const std::string &text;
+    explicit JSONEscaped(const std::string &s) : text(s) {}
+};
+
+inline void write(std::string &out, const CSVQuoted &value) {
+    out += '"';
+    for (const char c : value.text) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+inline void write(std::string &out, const JSONEscaped &value) {
+    for (const char c : value.text) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    const char *hex = "0123456789abcdef";
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0xF];
+                    out += hex[c & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+}
+
+static void writeCSVHeader(std::string &out) {
+    out += "asOfAdjustedSec,alkReadingDKH,title\n";
+}
+
+static void writeCSVRow(std::string &out, const alk_measure::PersistedAlkReading &reading) {
+    static constexpr auto rowTemplate = RV_TEMPLATE("{},{},{}\n");
+    render(out, rowTemplate, reading.asOfAdjustedSec, Fixed(reading.alkReadingDKH, 1), CSVQuoted(reading.title));
+}
+
+static void writeNDJSONRow(std::string &out, const alk_measure::PersistedAlkReading &reading) {
+    static constexpr auto rowTemplate = RV_TEMPLATE(R"({"asOfAdjustedSec":{},"alkReadingDKH":{},"title":"{}"})");
+    render(out, rowTemplate, reading.asOfAdjustedSec, Fixed(reading.alkReadingDKH, 1), JSONEscaped(reading.title));
+    out += '\n';
+}
+
+}  // namespace reading_export
+}  // namespace buff
@@ -56,6 +56,21 @@ class ReadingStore {
         return sorted;
     }
 
+    // Visits readings with asOfAdjustedSec > sinceSec, oldest first (ring order
+    // starting from the tip). Doesn't copy or allocate, so it's safe to use for
+    // streaming out the full history.
+    template <typename F>
+    void forEachReadingSince(const unsigned long sinceSec, F&& visit) const {
+        const size_t size = _mostRecentReadings.size();
+        for (size_t i = 0; i < size; i++) {
+            const auto& reading = _mostRecentReadings[(_tipIndex + i) % size];
+            // empty slot
+            if (reading.alkReadingDKH == 0) continue;
+            if (reading.asOfAdjustedSec <= sinceSec) continue;
+            visit(reading);
+        }
+    }
+
     // TODO: this method taking these params is ugly
     const std::set<std::string> getRecentTitles(const std::vector<std::reference_wrapper<alk_measure::PersistedAlkReading>>& readings) {
         std::set<std::string> values;
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Buff Libraries
+#include "file-storage.h"
+#include "readings/measurement-trace.h"
+#include "record-ring.h"
+#include "spsc-queue.h"
+
+namespace buff {
+namespace measurement_trace {
+
+/*******************************
+ * Trace store
+ *
+ * The last few measurements' traces, in a ring in flash titled by
+ * measurement. The process task submits traces as measurements finish, and
+ * the network task writes them to flash (persistPending), flash writes are
+ * too slow for the process task. The web server reads them for
+ * /export/traces, so the ring is locked, though never while a trace is
+ * being sent.
+ *******************************/
+const char *const TRACE_RING_PATH = "/traces.ring";
+const size_t TRACE_SLOT_SIZE = 8192;
+// 64KB, the last 8 measurements
+const size_t TRACE_SLOT_COUNT = 8;
+
+static_assert(TRACE_SLOT_SIZE >= sizeof(richiev::storage::RecordHeader) + MAX_TITLE_LENGTH + MAX_TRACE_LENGTH,
+              "A full trace has to fit in a slot");
+
+// a finished trace on its way to flash. Set aside up front, so handing one
+// over doesn't touch the heap.
+struct PendingTrace {
+    char title[MAX_TITLE_LENGTH + 1];
+    uint8_t data[MAX_TRACE_LENGTH];
+    size_t length = 0;
+};
+
+// traces that can be waiting to be written, measurements are an hour or so
+// apart & writing takes a few ms, so more would just be RAM
+const uint8_t PENDING_TRACE_SLOTS = 2;
+
+class TraceStore {
+   private:
+    storage::FileStorage _storage;
+    richiev::storage::RecordRing<storage::FileStorage, TRACE_SLOT_SIZE> _ring;
+    bool _open = false;
+    std::mutex _lock;
+
+    PendingTrace _pendingSlots[PENDING_TRACE_SLOTS];
+    // indexes into _pendingSlots, free ones to the process task & filled
+    // ones to the network task
+    richiev::SPSCQueue<uint8_t, 4> _freeSlots;
+    richiev::SPSCQueue<uint8_t, 4> _filledSlots;
+    static_assert(PENDING_TRACE_SLOTS <= decltype(_freeSlots)::capacity(), "Every pending slot has to fit in the queues");
+
+   public:
+    TraceStore() : _storage(TRACE_RING_PATH, sizeof(richiev::storage::RingMeta) + TRACE_SLOT_COUNT * TRACE_SLOT_SIZE), _ring(_storage) {
+        for (uint8_t i = 0; i < PENDING_TRACE_SLOTS; i++) _freeSlots.push(i);
+    }
+
+    bool begin() {
+        std::lock_guard<std::mutex> guard(_lock);
+        _open = _storage.begin() && _ring.open();
+        return _open;
+    }
+
+    void add(const char *title, const uint8_t *data, const size_t length) {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_open) return;
+        if (!_ring.push(title, (const char *)data, length)) {
+            Serial.print("Failed to store the trace of measurement title=");
+            Serial.println(title);
+        }
+    }
+
+    // Process task, copies the trace into a free slot for persistPending.
+    // False if they're all still waiting.
+    bool submit(const std::string &title, const uint8_t *data, const size_t length) {
+        uint8_t index;
+        if (!_freeSlots.pop(index)) return false;
+
+        auto &slot = _pendingSlots[index];
+        const size_t titleLength = std::min(title.size(), MAX_TITLE_LENGTH);
+        memcpy(slot.title, title.data(), titleLength);
+        slot.title[titleLength] = '\0';
+        slot.length = std::min(length, MAX_TRACE_LENGTH);
+        memcpy(slot.data, data, slot.length);
+        _filledSlots.push(index);
+        return true;
+    }
+
+    // Network task, writes the submitted traces
+    void persistPending() {
+        uint8_t index;
+        while (_filledSlots.pop(index)) {
+            const auto &slot = _pendingSlots[index];
+            add(slot.title, slot.data, slot.length);
+            _freeSlots.push(index);
+        }
+    }
+
+    // f(title, titleLength, trace, traceLength) for each stored trace, oldest
+    // first. Each is copied out under the lock & f's called without it, so a
+    // slow f (eg a stalled web client) doesn't hold up add.
+    template <typename F>
+    void forEach(F &&f) {
+        uint32_t sequence, end;
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            if (!_open) return;
+            sequence = _ring.firstSequence();
+            end = _ring.nextSequence();
+        }
+
+        std::string title;
+        std::vector<uint8_t> trace;
+        trace.reserve(MAX_TRACE_LENGTH);
+        for (; sequence < end; sequence++) {
+            bool found;
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                // gone if it's been overwritten since
+                found = _ring.readRecord(sequence, [&](const char *t, size_t titleLength, const char *data, size_t length) {
+                    title.assign(t, titleLength);
+                    trace.assign((const uint8_t *)data, (const uint8_t *)data + length);
+                });
+            }
+            if (found) f(title.c_str(), title.size(), trace.data(), trace.size());
+        }
+    }
+};
+
+// set up by the controller, null if traces aren't being stored
+inline std::shared_ptr<TraceStore> traceStore = nullptr;
+
+}  // namespace measurement_trace
+}  // namespace buff
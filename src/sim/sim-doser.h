@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Buff Libraries
+#include "doser/doser-common.h"
+#include "doser/motion-profile.h"
+#include "sim/virtual-clock.h"
+
+namespace buff {
+namespace sim {
+
+/*******************************
+ * Simulated doser
+ *
+ * A doser for the host that moves a virtual clock rather than a motor. Each
+ * dose is converted to steps like the real drivers do, and takes as long as
+ * the doser's planned motion profile (speed, acceleration & jerk limits from
+ * its config) says it would, so measurement sequences can be timed &
+ * optimised without hardware.
+ *
+ * Doses can also be queued (queueML, then waitUntilIdle), which run back to
+ * back on the same doser and alongside any on other dosers sharing the
+ * clock.
+ *******************************/
+struct SimulatedDose {
+    float ml;
+    long steps;
+    uint64_t startedAtUS;
+    uint64_t durationUS;
+};
+
+class SimulatedDoser : public doser::Doser {
+   private:
+    VirtualClock &_clock;
+    // when the last queued dose finishes
+    uint64_t _busyUntilUS = 0;
+
+    std::vector<SimulatedDose> _doses;
+    long _totalSteps = 0;
+
+    void queueSteps(const float ml, const long steps) {
+        const uint64_t startUS = _busyUntilUS > _clock.nowUS() ? _busyUntilUS : _clock.nowUS();
+        const uint64_t durationUS = durationUSFor(steps);
+
+        _doses.push_back({.ml = ml, .steps = steps, .startedAtUS = startUS, .durationUS = durationUS});
+        _totalSteps += labs(steps);
+        _busyUntilUS = startUS + durationUS;
+        if (doseDuration != nullptr) doseDuration->observe(durationUS);
+        if (onDose && ml != 0) onDose(ml);
+    }
+
+   public:
+    SimulatedDoser(DoserConfig doserConfig, VirtualClock &clock) : Doser(doserConfig), _clock(clock) {}
+
+    // told about each dose as it's queued, eg to have a simulated sample react
+    std::function<void(float ml)> onDose;
+
+    uint64_t durationUSFor(const long steps) const {
+        if (steps == 0) return 0;
+        const auto profile = doser::MotionProfile::plan(labs(steps), motionLimits());
+        return llround(profile.durationS() * 1e6);
+    }
+
+    virtual void doseML(const float outputML, doser::Calibrator *aCalibrator = nullptr) {
+        queueML(outputML, aCalibrator);
+        waitUntilIdle();
+    }
+
+    void queueML(const float outputML, doser::Calibrator *aCalibrator = nullptr) {
+        if (aCalibrator == nullptr) aCalibrator = calibrator.get();
+        queueSteps(outputML, partialRotationToSteps(aCalibrator->partialRotationsForMLOutput(outputML)));
+    }
+
+    void waitUntilIdle() {
+        _clock.advanceToUS(_busyUntilUS);
+    }
+
+    virtual void setup() {}
+
+    virtual void debugRotateDegrees(const int degreesRotation) {
+        queueSteps(0, degreesToFullSteps(degreesRotation));
+        waitUntilIdle();
+    }
+
+    virtual void debugRotateSteps(const long steps) {
+        queueSteps(0, steps);
+        waitUntilIdle();
+    }
+
+    bool busy() const { return _busyUntilUS > _clock.nowUS(); }
+
+    const std::vector<SimulatedDose> &doses() const { return _doses; }
+    long totalSteps() const { return _totalSteps; }
+
+    uint64_t totalDurationUS() const {
+        uint64_t total = 0;
+        for (const auto &dose : _doses) total += dose.durationUS;
+        return total;
+    }
+
+    void clearDoses() {
+        _doses.clear();
+        _totalSteps = 0;
+    }
+};
+
+}  // namespace sim
+}  // namespace buff
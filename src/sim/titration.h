@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+// Buff Libraries
+#include "doser/doser-config.h"
+#include "sim/sim-doser.h"
+#include "sim/virtual-clock.h"
+
+namespace buff {
+namespace sim {
+
+/*******************************
+ * Titration chemistry
+ *
+ * A model of the measurement vessel's contents, for running titrations on the
+ * host. The sample's alkalinity comes from the carbonate system (plus borate,
+ * as in seawater), and its pH is found by solving the charge balance for
+ * whatever's been added, so acid doses give a realistic curve with the sharp
+ * drop around the endpoint.
+ *
+ * The vessel is closed, no CO2 escapes as the acid's added. Constants are
+ * for seawater at 25C & salinity 35.
+ *******************************/
+struct SampleConfig {
+    float alkalinityDKH = 8.0;
+    // before any acid, sets how much carbonate there is for that alkalinity
+    float initialPH = 8.2;
+    float reagentStrengthMoles = 0.1;
+};
+
+// 1 meq/L of alkalinity is 2.8 dKH
+const double DKH_PER_MEQ_L = 2.8;
+
+const double SEAWATER_K1 = 1.41e-6;         // pK1* 5.85
+const double SEAWATER_K2 = 1.07e-9;         // pK2* 8.97
+const double SEAWATER_KB = 2.51e-9;         // pKB* 8.60
+const double SEAWATER_KW = 6.0e-14;         // pKw* 13.22
+const double SEAWATER_BORATE_MOL_L = 4.16e-4;
+
+class TitrationSample {
+   private:
+    const SampleConfig _config;
+
+    double _volumeL = 0;
+    // totals in the vessel, in moles
+    double _alkalinityMol = 0;
+    double _carbonMol = 0;
+    double _borateMol = 0;
+
+    // sample water as it comes from the tank, per litre
+    double _tankAlkalinityMolL = 0;
+    double _tankCarbonMolL = 0;
+
+    static double carbonateCharge(const double h) {
+        // HCO3- + 2 CO3-- per mol of dissolved carbon
+        const double k1h = SEAWATER_K1 * h;
+        const double k1k2 = SEAWATER_K1 * SEAWATER_K2;
+        return (k1h + 2 * k1k2) / (h * h + k1h + k1k2);
+    }
+
+    // alkalinity at a pH, per litre
+    static double alkalinityAt(const double h, const double carbonMolL, const double borateMolL) {
+        return carbonMolL * carbonateCharge(h) + borateMolL * SEAWATER_KB / (SEAWATER_KB + h) + SEAWATER_KW / h - h;
+    }
+
+   public:
+    explicit TitrationSample(const SampleConfig &config) : _config(config) {
+        _tankAlkalinityMolL = config.alkalinityDKH / DKH_PER_MEQ_L / 1000;
+        const double h = pow(10, -config.initialPH);
+        _tankCarbonMolL = (_tankAlkalinityMolL - SEAWATER_BORATE_MOL_L * SEAWATER_KB / (SEAWATER_KB + h) - SEAWATER_KW / h + h) / carbonateCharge(h);
+    }
+
+    void addTankWater(const float ml) {
+        const double litres = ml / 1000.0;
+        _volumeL += litres;
+        _alkalinityMol += _tankAlkalinityMolL * litres;
+        _carbonMol += _tankCarbonMolL * litres;
+        _borateMol += SEAWATER_BORATE_MOL_L * litres;
+    }
+
+    // acid, which just takes away alkalinity
+    void addReagent(const float ml) {
+        const double litres = ml / 1000.0;
+        _volumeL += litres;
+        _alkalinityMol -= _config.reagentStrengthMoles * litres;
+    }
+
+    // takes out some of the (well mixed) sample
+    void remove(const float ml) {
+        if (_volumeL <= 0) return;
+        const double litres = ml / 1000.0;
+        const double kept = litres >= _volumeL ? 0 : 1 - litres / _volumeL;
+        _volumeL *= kept;
+        _alkalinityMol *= kept;
+        _carbonMol *= kept;
+        _borateMol *= kept;
+    }
+
+    float volumeML() const { return _volumeL * 1000; }
+
+    float pH() const {
+        if (_volumeL <= 0) return 7.0;
+
+        // alkalinity only ever falls as the pH does, so bisect for the pH that matches
+        const double alkalinityMolL = _alkalinityMol / _volumeL;
+        const double carbonMolL = _carbonMol / _volumeL;
+        const double borateMolL = _borateMol / _volumeL;
+        double lo = 0;
+        double hi = 14;
+        for (int i = 0; i < 48; i++) {
+            const double mid = (lo + hi) / 2;
+            if (alkalinityAt(pow(10, -mid), carbonMolL, borateMolL) > alkalinityMolL) {
+                hi = mid;
+            } else {
+                lo = mid;
+            }
+        }
+        return (lo + hi) / 2;
+    }
+
+    // What each of the measurement dosers pumping does to the vessel
+    void applyDose(const MeasurementDoserType doserType, const float ml) {
+        switch (doserType) {
+            case FILL:
+                if (ml > 0) {
+                    addTankWater(ml);
+                } else {
+                    remove(-ml);
+                }
+                break;
+            case REAGENT:
+                // reversing draws the sample back up the reagent line
+                if (ml > 0) {
+                    addReagent(ml);
+                } else {
+                    remove(-ml);
+                }
+                break;
+            case DRAIN:
+                // reversing the drain is just stirring with air
+                if (ml > 0) remove(ml);
+                break;
+        }
+    }
+
+    // Has the sample follow what a simulated doser pumps
+    void connect(SimulatedDoser &doser, const MeasurementDoserType doserType) {
+        doser.onDose = [this, doserType](const float ml) { applyDose(doserType, ml); };
+    }
+};
+
+/*******************************
+ * Simulated pH probe
+ *
+ * Reads a titration sample the way a real probe would: lagging behind
+ * changes (a first order response) and with some noise. Seeded, so the same
+ * run reads the same every time.
+ *******************************/
+struct ProbeConfig {
+    float lagS = 5.0;
+    float noisePH = 0.005;
+    uint32_t seed = 1;
+};
+
+class SimulatedPHProbe {
+   private:
+    const TitrationSample &_sample;
+    const VirtualClock &_clock;
+    const ProbeConfig _config;
+
+    std::mt19937 _random;
+    std::normal_distribution<float> _noise;
+
+    bool _settled = false;
+    float _pH = 7.0;
+    uint64_t _lastReadUS = 0;
+
+   public:
+    SimulatedPHProbe(const TitrationSample &sample, const VirtualClock &clock, const ProbeConfig &config = {})
+        : _sample(sample), _clock(clock), _config(config), _random(config.seed), _noise(0, config.noisePH) {}
+
+    float read() {
+        const float actual = _sample.pH();
+        const uint64_t nowUS = _clock.nowUS();
+        if (!_settled || _config.lagS <= 0) {
+            _pH = actual;
+            _settled = true;
+        } else {
+            const float elapsedS = (nowUS - _lastReadUS) / 1e6f;
+            _pH += (actual - _pH) * (1 - expf(-elapsedS / _config.lagS));
+        }
+        _lastReadUS = nowUS;
+
+        return _config.noisePH > 0 ? _pH + _noise(_random) : _pH;
+    }
+};
+
+}  // namespace sim
+}  // namespace buff
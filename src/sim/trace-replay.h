@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Buff Libraries
+#include "controller-common.h"
+#include "doser/doser-common.h"
+#include "mqtt-common.h"
+#include "ph-controller.h"
+#include "readings/alk-measure.h"
+#include "readings/measurement-trace.h"
+#include "time-common.h"
+
+namespace buff {
+namespace sim {
+
+/*******************************
+ * Trace replay
+ *
+ * Feeds a measurement trace from the field (see readings/measurement-trace.h)
+ * back through AlkMeasurer: the recorded raw pH samples are read in order,
+ * with the recorded config & calibration, and the dosers do nothing. The
+ * measurer is traced again as it goes, so what it decided can be compared,
+ * event by event, with what it decided in the field, eg to check a change to
+ * the measurement logic against real sessions.
+ *
+ * Nothing the measurer decides depends on the clock, so a replay always does
+ * the same thing.
+ *******************************/
+struct ReplayResult {
+    // what the replay did, as a trace
+    measurement_trace::Trace replayed;
+
+    // the replay wanted more pH samples than were recorded
+    bool ranOutOfSamples = false;
+    // index of the first event that differs from the recording, -1 if none do
+    long divergedAt = -1;
+    // the same decisions and the same alk as the recording
+    bool matches = false;
+};
+
+// gives up on a replay that's lost its way after this many steps
+const size_t MAX_REPLAY_STEPS = 100000;
+
+class ReplayDoser : public doser::Doser {
+   public:
+    ReplayDoser() : doser::Doser(DoserConfig{}) {}
+
+    virtual void doseML(const float outputML, doser::Calibrator *aCalibrator = nullptr) {}
+    virtual void setup() {}
+    virtual void debugRotateDegrees(const int deg) {}
+    virtual void debugRotateSteps(const long steps) {}
+};
+
+class ReplayPublisher : public mqtt::Publisher {
+   public:
+    void publishPH(const ph::PHReading &phReading) {}
+    void publishAlkReading(const alk_measure::AlkReading &alkReading) {}
+    void publishMeasureAlk(const std::string &title, const unsigned long asOfMS) {}
+};
+
+static long firstDifference(const measurement_trace::Trace &recorded, const measurement_trace::Trace &replayed) {
+    const auto &recordedEvents = recorded.events;
+    const auto &replayedEvents = replayed.events;
+    const size_t common = std::min(recordedEvents.size(), replayedEvents.size());
+    for (size_t i = 0; i < common; i++) {
+        if (!recordedEvents[i].sameAs(replayedEvents[i])) return i;
+    }
+    // a truncated recording says nothing about what came after it
+    if (recordedEvents.size() != replayedEvents.size() && !recorded.truncated()) return common;
+    return -1;
+}
+
+template <size_t NUM_SAMPLES>
+ReplayResult replay(const measurement_trace::Trace &recorded) {
+    ReplayResult result;
+
+    std::vector<float> samples;
+    for (const auto &event : recorded.events) {
+        if (event.type == measurement_trace::PH_SAMPLE) samples.push_back(event.value);
+    }
+    size_t nextSample = 0;
+    const ph::PHReadConfig phReadConfig = {
+        .readIntervalMS = 1000,
+        .phReadFunc = [&samples, &nextSample, &result]() -> float {
+            if (nextSample < samples.size()) return samples[nextSample++];
+            result.ranOutOfSamples = true;
+            return samples.empty() ? 7.0 : samples.back();
+        }};
+    auto phReader = std::make_shared<ph::controller::PHReader>(phReadConfig, recorded.calibrator());
+
+    auto buffDosers = std::make_shared<doser::BuffDosers>(0);
+    for (auto doserType : {FILL, REAGENT, DRAIN}) {
+        buffDosers->emplace(doserType, std::make_shared<ReplayDoser>());
+    }
+
+    auto recorder = std::make_shared<measurement_trace::TraceRecorder>();
+    recorder->onFinished = [&result](const std::string &title, const uint8_t *data, size_t length) {
+        measurement_trace::decode(title, data, length, result.replayed);
+    };
+
+    alk_measure::AlkMeasurer measurer(buffDosers, recorded.config, phReader);
+    measurer.traceTo(recorder);
+
+    auto publisher = std::make_shared<ReplayPublisher>();
+    auto timeClient = std::make_shared<buff_time::TimeWrapper>();
+    auto step = measurer.begin<NUM_SAMPLES>(recorded.startedAtMS, recorded.startedAtAdjustedSec, recorded.title);
+    for (size_t steps = 0; step.nextAction != alk_measure::MEASURE_DONE && steps < MAX_REPLAY_STEPS; steps++) {
+        step = measurer.measureAlk(publisher, timeClient, step);
+    }
+
+    result.divergedAt = firstDifference(recorded, result.replayed);
+    result.matches = result.replayed.finished() && !result.ranOutOfSamples && result.divergedAt < 0 &&
+                     result.replayed.alkReadingDKH == recorded.alkReadingDKH;
+    return result;
+}
+
+// Replays with the sample count the trace was recorded with, either of
+// those the controller measures with
+static bool replay(const measurement_trace::Trace &recorded, ReplayResult &result) {
+    using controller::AUTO_PH_SAMPLE_COUNT;
+    using controller::MANUAL_PH_SAMPLE_COUNT;
+
+    switch (recorded.numSamples) {
+        case MANUAL_PH_SAMPLE_COUNT:
+            result = replay<MANUAL_PH_SAMPLE_COUNT>(recorded);
+            return true;
+        case AUTO_PH_SAMPLE_COUNT:
+            result = replay<AUTO_PH_SAMPLE_COUNT>(recorded);
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace sim
+}  // namespace buff
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+namespace buff {
+namespace sim {
+
+/*******************************
+ * Virtual clock
+ *
+ * Simulated time for running things on the host: only moves when something
+ * says it has (eg a simulated doser finishing a dose), so a measurement that
+ * takes minutes on the device runs as fast as the host can go, and the same
+ * every time.
+ *******************************/
+class VirtualClock {
+   private:
+    uint64_t _nowUS = 0;
+
+   public:
+    uint64_t nowUS() const { return _nowUS; }
+    unsigned long nowMS() const { return _nowUS / 1000; }
+
+    void advanceUS(const uint64_t us) { _nowUS += us; }
+    void advanceMS(const uint64_t ms) { _nowUS += ms * 1000; }
+
+    // never goes backwards
+    void advanceToUS(const uint64_t us) {
+        if (us > _nowUS) _nowUS = us;
+    }
+};
+
+}  // namespace sim
+}  // namespace buff
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <cstdio>
+#include <string>
+
+// Buff Libraries
+#include "metrics.h"
+#include "scheduler.h"
+
+namespace buff {
+namespace tasks {
+
+/*******************************
+ * Task layout
+ *
+ * core 1: process - dosers, pH acquisition & the measurement state machine.
+ *         High priority and alone on its core, so pump timing isn't at the
+ *         mercy of the network or screen.
+ * core 0: ui      - web server, display, OTA & the reading store
+ *         network - MQTT broker/client, outbox, upstream bridge
+ *         (alongside the WiFi/lwIP tasks, which live on core 0 anyway)
+ *
+ * Values cross between them through SPSC queues (readings to the UI,
+ * requests to the process task) or the MQTT outbox/inbox, never by the
+ * process task touching UI state directly.
+ *******************************/
+struct TaskSpec {
+    const char *name;
+    uint32_t stackSize;
+    UBaseType_t priority;
+    BaseType_t core;
+};
+
+const TaskSpec PROCESS_TASK = {.name = "process", .stackSize = 8192, .priority = 10, .core = 1};
+const TaskSpec UI_TASK = {.name = "ui", .stackSize = 12288, .priority = 2, .core = 0};
+// below the UI, so a busy network doesn't make the screen/web laggy
+const TaskSpec NETWORK_TASK = {.name = "network", .stackSize = 8192, .priority = 1, .core = 0};
+
+/*******************************
+ * Scheduling
+ *
+ * Each task runs its periodic work (registered in setup, see
+ * controller-common.h) from a scheduler, and sleeps until the next deadline
+ * in between.
+ *******************************/
+using Scheduler = richiev::scheduling::Scheduler<16, 64>;
+using richiev::scheduling::Pacing;
+
+inline Scheduler processScheduler(micros);
+inline Scheduler uiScheduler(micros);
+inline Scheduler networkScheduler(micros);
+
+// so a job registered with a far off deadline is still noticed promptly
+const uint32_t MAX_SLEEP_MS = 1000;
+
+struct ScheduledTaskContext {
+    const TaskSpec spec;
+    Scheduler &scheduler;
+};
+
+static void runScheduled(void *param) {
+    auto *context = static_cast<ScheduledTaskContext *>(param);
+    while (true) {
+        context->scheduler.runDue(millis());
+        const uint32_t sleepMS = context->scheduler.msUntilNextDeadline(millis(), MAX_SLEEP_MS);
+        // always yield at least a tick, so lower priority tasks on the core get to run
+        const TickType_t sleepTicks = pdMS_TO_TICKS(sleepMS);
+        vTaskDelay(sleepTicks > 0 ? sleepTicks : 1);
+    }
+}
+
+static TaskHandle_t startScheduledTask(const TaskSpec &spec, Scheduler &scheduler) {
+    // lives as long as the task, which is forever
+    auto *context = new ScheduledTaskContext{spec, scheduler};
+    TaskHandle_t handle = nullptr;
+    xTaskCreatePinnedToCore(runScheduled, spec.name, spec.stackSize, context, spec.priority, &handle, spec.core);
+
+    Serial.print("Started task name=");
+    Serial.print(spec.name);
+    Serial.print(", core=");
+    Serial.print(spec.core);
+    Serial.print(", jobs=");
+    Serial.println(scheduler.jobCount());
+    return handle;
+}
+
+/*******************************
+ * Metrics
+ *******************************/
+// One sample per scheduled job, eg buff_job_overruns_total{task="ui",job="web"} 3.
+// Stats are rendered multiplied by renderScale, if given (eg 1e-6 to report
+// micros as seconds).
+class JobStatMetric : public richiev::metrics::Metric {
+   public:
+    using StatFunc = uint32_t (*)(const richiev::scheduling::Job &job);
+
+   private:
+    const richiev::metrics::MetricType _type;
+    const StatFunc _stat;
+    const double _renderScale;
+
+    void renderScheduler(std::string &out, const char *taskName, const Scheduler &scheduler) const {
+        scheduler.forEachJob([&](const richiev::scheduling::Job &job) {
+            char label[64];
+            snprintf(label, sizeof(label), "task=\"%s\",job=\"%s\"", taskName, job.name);
+            char value[24];
+            if (_renderScale == 1) {
+                snprintf(value, sizeof(value), "%u", (unsigned int)_stat(job));
+            } else {
+                snprintf(value, sizeof(value), "%g", _stat(job) * _renderScale);
+            }
+            renderSample(out, "", label, value);
+        });
+    }
+
+   public:
+    JobStatMetric(const char *name, const char *help, const richiev::metrics::MetricType type, const StatFunc stat, const double renderScale = 1)
+        : Metric(name, help, nullptr), _type(type), _stat(stat), _renderScale(renderScale) {}
+
+    richiev::metrics::MetricType type() const { return _type; }
+
+    void render(std::string &out) const {
+        renderScheduler(out, PROCESS_TASK.name, processScheduler);
+        renderScheduler(out, UI_TASK.name, uiScheduler);
+        renderScheduler(out, NETWORK_TASK.name, networkScheduler);
+    }
+};
+
+inline JobStatMetric jobRuns("buff_job_runs_total", "Times each scheduled job has run", richiev::metrics::COUNTER,
+                             [](const richiev::scheduling::Job &job) { return job.stats.runs; });
+inline JobStatMetric jobOverruns("buff_job_overruns_total", "Runs of each scheduled job that went over its budget", richiev::metrics::COUNTER,
+                                 [](const richiev::scheduling::Job &job) { return job.stats.overruns; });
+inline JobStatMetric jobSkipped("buff_job_skipped_total", "Deadlines skipped because a job ran too late", richiev::metrics::COUNTER,
+                                [](const richiev::scheduling::Job &job) { return job.stats.skipped; });
+inline JobStatMetric jobMaxDuration("buff_job_max_duration_seconds", "Longest run of each scheduled job", richiev::metrics::GAUGE,
+                                    [](const richiev::scheduling::Job &job) { return job.stats.maxDurationUS; }, 1e-6);
+inline JobStatMetric jobMaxLateness("buff_job_max_lateness_seconds", "Latest each scheduled job has started after its deadline", richiev::metrics::GAUGE,
+                                    [](const richiev::scheduling::Job &job) { return job.stats.maxLatenessMS; }, 1e-3);
+
+}  // namespace tasks
+}  // namespace buff
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TinyMqtt.h>
+#include <WiFi.h>
+#include <lwip/dns.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Buff Libraries
+#include "file-storage.h"
+#include "metrics.h"
+#include "mqtt-dispatch.h"
+#include "mqtt.h"
+#include "record-ring.h"
+
+namespace buff {
+namespace upstream {
+
+/*******************************
+ * Upstream bridge
+ *
+ * Optionally forwards selected locally published topics to a central broker,
+ * as <topicPrefix><topic> (eg buff/reef-buff/readings/alk), so consumers don't
+ * have to connect to every Buff. While the upstream is unreachable forwarded
+ * messages are kept in a ring in flash, and replayed in order once it's back.
+ *
+ * Commands can come from upstream too: the command filters are subscribed to
+ * (under the prefix) and whatever arrives is handled like a local message.
+ *
+ * Runs on the network task. The MQTT client's connect blocks for seconds when
+ * the upstream's unreachable, so the upstream is first probed with a short
+ * connect timeout, and attempts back off while it stays unreachable. Its
+ * host name's looked up in the background (lwIP's dns_gethostbyname rather
+ * than WiFi.hostByName, which waits for the answer), and the attempt made
+ * once the answer's in.
+ *******************************/
+struct UpstreamConfig {
+    // empty to disable
+    std::string host;
+    uint16_t port;
+
+    // local topics forwarded (and buffered) upstream
+    std::vector<std::string> forwardFilters;
+    // topics subscribed to upstream, handled as if received locally
+    std::vector<std::string> commandFilters;
+};
+
+const char *const RING_PATH = "/upstream.ring";
+// fits a full readings/ph/history envelope
+const size_t RING_SLOT_SIZE = 1600;
+// ~150KB, about an hour and a half of history envelopes plus alk readings
+const size_t RING_SLOT_COUNT = 96;
+
+// how long a connection attempt can hold up the network task
+const int32_t CONNECT_TIMEOUT_MS = 300;
+// between attempts, doubling while the upstream stays unreachable
+const unsigned long RECONNECT_MIN_INTERVAL_MS = 5 * 1000;
+const unsigned long RECONNECT_MAX_INTERVAL_MS = 5 * 60 * 1000;
+// per loop, so replaying a backlog doesn't starve the local broker
+const size_t REPLAY_BATCH_SIZE = 4;
+
+using Ring = richiev::storage::RecordRing<storage::FileStorage, RING_SLOT_SIZE>;
+
+// set by beginUpstreamBridge, for routing upstream messages back to the handlers
+inline std::string commandTopicPrefix;
+
+static void onUpstreamPublish(const MqttClient * /* srce */, const Topic &topic, const char *payload, size_t payloadLength) {
+    const std::string &fullTopic = topic.str();
+    if (fullTopic.compare(0, commandTopicPrefix.size(), commandTopicPrefix) != 0) return;
+    const char *localTopic = fullTopic.c_str() + commandTopicPrefix.size();
+
+    if (richiev::mqtt::inbox != nullptr) {
+        if (!richiev::mqtt::inbox->push(localTopic, payload, payloadLength)) {
+            Serial.print("Inbox full or message too big, dropping upstream msg on topic=");
+            Serial.println(localTopic);
+        }
+        return;
+    }
+    richiev::mqtt::dispatchMessage(localTopic, {.data = payload, .length = payloadLength});
+}
+
+class UpstreamBridge {
+   private:
+    const UpstreamConfig _config;
+    const std::string _topicPrefix;
+    MqttClient _client;
+
+    storage::FileStorage _storage;
+    Ring _ring;
+    bool _ringOpen = false;
+
+    bool _wasConnected = false;
+    unsigned long _lastConnectAttemptMS = 0;
+    unsigned long _reconnectIntervalMS = RECONNECT_MIN_INTERVAL_MS;
+    // resolved until it's unreachable, so attempts don't all look it up.
+    // _address is written by whoever sets _lookup to RESOLVED, lwIP's task if
+    // it had to ask the DNS server.
+    enum LookupState : uint8_t {
+        UNRESOLVED,
+        LOOKING_UP,
+        RESOLVED
+    };
+    IPAddress _address;
+    std::atomic<uint8_t> _lookup{UNRESOLVED};
+    // set by lwIP's task when a lookup finds the address
+    std::atomic<bool> _lookedUp{false};
+
+    // for other tasks (eg the metrics), _client is only touched by the network task
+    std::atomic<bool> _connected{false};
+
+    // scratch for replaying
+    char _topic[richiev::mqtt::MAX_QUEUED_TOPIC_LEN + 32];
+    char _payload[RING_SLOT_SIZE];
+
+    bool shouldForward(const char *topic) const {
+        for (const auto &filter : _config.forwardFilters) {
+            if (richiev::mqtt::matchesFilter(filter.c_str(), topic)) return true;
+        }
+        return false;
+    }
+
+    bool publishUpstream(const char *topic, const char *payload, const size_t length) {
+        const std::string upstreamTopic = _topicPrefix + topic;
+        return _client.publish(Topic(upstreamTopic), payload, length) == MqttOk;
+    }
+
+    void buffer(const char *topic, const char *payload, const size_t length) {
+        if (!_ringOpen || !_ring.push(topic, payload, length)) {
+            dropped++;
+            return;
+        }
+        buffered++;
+    }
+
+    void connectIfTime(const unsigned long nowMS) {
+        if (_client.connected()) {
+            if (!_wasConnected) {
+                _wasConnected = true;
+                _reconnectIntervalMS = RECONNECT_MIN_INTERVAL_MS;
+                Serial.println("Connected to upstream broker");
+                for (const auto &filter : _config.commandFilters) {
+                    _client.subscribe(Topic(_topicPrefix + filter));
+                }
+            }
+            return;
+        }
+
+        if (_wasConnected) {
+            _wasConnected = false;
+            Serial.println("Lost upstream broker, buffering");
+        }
+        // an attempt that was waiting on a lookup goes ahead as soon as it's
+        // found the address, failed ones wait for the next attempt
+        const bool lookedUp = _lookedUp.exchange(false, std::memory_order_acquire);
+        if (!lookedUp && _lastConnectAttemptMS != 0 && nowMS - _lastConnectAttemptMS < _reconnectIntervalMS) return;
+
+        _lastConnectAttemptMS = nowMS;
+        // reset once connected
+        if (!lookedUp) _reconnectIntervalMS = std::min(_reconnectIntervalMS * 2, RECONNECT_MAX_INTERVAL_MS);
+        if (!reachable()) return;
+        _client.connect(_address.toString().c_str(), _config.port);
+    }
+
+    bool reachable() {
+        if (!resolve()) return false;
+
+        WiFiClient probe;
+        const bool reached = probe.connect(_address, _config.port, CONNECT_TIMEOUT_MS);
+        probe.stop();
+        // it may have moved
+        if (!reached) _lookup.store(UNRESOLVED, std::memory_order_relaxed);
+        return reached;
+    }
+
+    // True if the host's address is known, otherwise starts looking it up
+    // (if it isn't already) without waiting for the answer
+    bool resolve() {
+        const uint8_t state = _lookup.load(std::memory_order_acquire);
+        if (state != UNRESOLVED) return state == RESOLVED;
+
+        if (_address.fromString(_config.host.c_str())) {
+            _lookup.store(RESOLVED, std::memory_order_relaxed);
+            return true;
+        }
+
+        _lookup.store(LOOKING_UP, std::memory_order_relaxed);
+        ip_addr_t found;
+        const err_t err = dns_gethostbyname(_config.host.c_str(), &found, onLookedUp, this);
+        if (err == ERR_OK) {
+            // cached
+            _address = IPAddress(ip_2_ip4(&found)->addr);
+            _lookup.store(RESOLVED, std::memory_order_relaxed);
+            return true;
+        }
+        if (err != ERR_INPROGRESS) {
+            Serial.print("Failed to look up the upstream broker host=");
+            Serial.println(_config.host.c_str());
+            _lookup.store(UNRESOLVED, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    // lwIP's task, found is null if the lookup failed
+    static void onLookedUp(const char * /* name */, const ip_addr_t *found, void *arg) {
+        auto *bridge = static_cast<UpstreamBridge *>(arg);
+        if (found != nullptr) bridge->_address = IPAddress(ip_2_ip4(found)->addr);
+        bridge->_lookup.store(found != nullptr ? RESOLVED : UNRESOLVED, std::memory_order_release);
+        if (found != nullptr) bridge->_lookedUp.store(true, std::memory_order_release);
+    }
+
+    void replay() {
+        for (size_t i = 0; i < REPLAY_BATCH_SIZE && _ringOpen; i++) {
+            size_t length = 0;
+            if (!_ring.peek(_topic, sizeof(_topic), _payload, sizeof(_payload), length)) return;
+            // leave it for next time
+            if (!publishUpstream(_topic, _payload, length)) return;
+            _ring.pop();
+            replayed++;
+        }
+    }
+
+   public:
+    uint32_t forwarded = 0;
+    uint32_t buffered = 0;
+    uint32_t replayed = 0;
+    // couldn't even be buffered
+    uint32_t dropped = 0;
+
+    UpstreamBridge(const UpstreamConfig &config, const std::string &topicPrefix)
+        : _config(config), _topicPrefix(topicPrefix), _client(nullptr, topicPrefix), _storage(RING_PATH, sizeof(richiev::storage::RingMeta) + RING_SLOT_COUNT * RING_SLOT_SIZE), _ring(_storage) {}
+
+    void begin() {
+        _ringOpen = _storage.begin() && _ring.open();
+        if (_ringOpen) {
+            Serial.print("Upstream ring opened, pending=");
+            Serial.println(_ring.size());
+        } else {
+            Serial.println("Failed to open the upstream ring, messages won't be buffered");
+        }
+
+        commandTopicPrefix = _topicPrefix;
+        _client.setCallback(onUpstreamPublish);
+    }
+
+    // Called with every message published locally
+    void forward(const char *topic, const char *payload, const size_t length) {
+        if (!shouldForward(topic)) return;
+
+        // anything older has to go out first
+        if (_client.connected() && (!_ringOpen || _ring.empty()) && publishUpstream(topic, payload, length)) {
+            forwarded++;
+            return;
+        }
+        buffer(topic, payload, length);
+    }
+
+    void loop(const unsigned long nowMS) {
+        connectIfTime(nowMS);
+        _client.loop();
+        _connected.store(_client.connected(), std::memory_order_relaxed);
+        if (_client.connected()) replay();
+    }
+
+    // any task
+    bool connected() const { return _connected.load(std::memory_order_relaxed); }
+    size_t pending() const { return _ringOpen ? _ring.size() : 0; }
+    uint32_t overwritten() const { return _ringOpen ? _ring.overwritten() : 0; }
+};
+
+// null unless enabled
+inline std::shared_ptr<UpstreamBridge> bridge = nullptr;
+
+static void beginUpstreamBridge(const UpstreamConfig &config, const std::string &hostname) {
+    if (config.host.empty()) return;
+
+    bridge = std::make_shared<UpstreamBridge>(config, "buff/" + hostname + "/");
+    bridge->begin();
+    Serial.print("Upstream bridge to host=");
+    Serial.println(config.host.c_str());
+}
+
+/*******************************
+ * Metrics
+ *******************************/
+#define BUFF_UPSTREAM_COUNTER(var, name, help, value) \
+    inline richiev::metrics::CallbackCounter var(name, help, []() -> uint32_t { return bridge != nullptr ? bridge->value : 0; });
+
+BUFF_UPSTREAM_COUNTER(upstreamForwarded, "buff_upstream_forwarded_total", "Messages forwarded straight to the upstream broker", forwarded)
+BUFF_UPSTREAM_COUNTER(upstreamBuffered, "buff_upstream_buffered_total", "Messages buffered in flash while the upstream broker was unreachable", buffered)
+BUFF_UPSTREAM_COUNTER(upstreamReplayed, "buff_upstream_replayed_total", "Buffered messages replayed to the upstream broker", replayed)
+BUFF_UPSTREAM_COUNTER(upstreamDropped, "buff_upstream_dropped_total", "Messages that couldn't be forwarded or buffered", dropped)
+BUFF_UPSTREAM_COUNTER(upstreamOverwritten, "buff_upstream_overwritten_total", "Buffered messages overwritten before they could be replayed", overwritten())
+
+#undef BUFF_UPSTREAM_COUNTER
+
+inline richiev::metrics::CallbackGauge upstreamPending("buff_upstream_pending", "Messages buffered waiting for the upstream broker", []() -> int32_t { return bridge != nullptr ? bridge->pending() : 0; });
+inline richiev::metrics::CallbackGauge upstreamConnected("buff_upstream_connected", "Whether the upstream broker is connected", []() -> int32_t { return bridge != nullptr && bridge->connected() ? 1 : 0; });
+
+}  // namespace upstream
+}  // namespace buff
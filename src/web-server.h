@@ -2,12 +2,18 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <SPIFFS.h>
 #include <WebServer.h>  // Built into ESP32
 
 #include <string>
 
+#include "metrics.h"
+#include "profiler.h"
 #include "readings/alk-measure-common.h"
+#include "readings/measurement-trace.h"
+#include "readings/reading-export.h"
 #include "readings/reading-store.h"
+#include "readings/trace-store.h"
 #include "string-manip.h"
 #include "time-common.h"
 #include "web-server-renderers.h"
@@ -15,9 +21,16 @@
 namespace buff {
 namespace web_server {
 
+// Assets are referenced with ?v=WEB_ASSETS_VERSION, so they can be cached forever
+const char* const STATIC_ASSET_CACHE_HEADER = "public, max-age=31536000, immutable";
+
+// Exports are sent in chunks of roughly this size, regardless of how many rows there are
+const size_t EXPORT_CHUNK_SIZE = 1024;
+
 class BuffWebServer {
    private:
     std::shared_ptr<reading_store::ReadingStore> _readingStore = nullptr;
+    std::shared_ptr<measurement_trace::TraceStore> _traceStore = nullptr;
     std::shared_ptr<buff_time::TimeWrapper> _timeClient = nullptr;
     WebServer _server;
 
@@ -118,12 +131,88 @@ class BuffWebServer {
         _server.send(200, "application/json", serializedDoc);
     }
 
-    void setupWebServer(std::shared_ptr<reading_store::ReadingStore> rs) {
+    // Streams every stored reading newer than the optional ?since=<epoch sec>
+    // cursor, oldest first. The backup job passes the newest asOfAdjustedSec it
+    // has seen to only pull what's new.
+    template <typename RowWriter>
+    void handleExport(const char* contentType, void (*writeHeader)(std::string&), RowWriter writeRow) {
+        const unsigned long since = _server.hasArg("since") ? strtoul(_server.arg("since").c_str(), nullptr, 10) : 0;
+
+        std::string chunk;
+        chunk.reserve(EXPORT_CHUNK_SIZE + 256);
+
+        _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _server.send(200, contentType, "");
+
+        if (writeHeader != nullptr) writeHeader(chunk);
+        _readingStore->forEachReadingSince(since, [&](const alk_measure::PersistedAlkReading& reading) {
+            writeRow(chunk, reading);
+            if (chunk.size() >= EXPORT_CHUNK_SIZE) {
+                _server.sendContent(chunk.c_str(), chunk.size());
+                chunk.clear();
+            }
+        });
+        if (!chunk.empty()) {
+            _server.sendContent(chunk.c_str(), chunk.size());
+        }
+        // terminates the chunked response
+        _server.sendContent("");
+    }
+
+    // The stored measurement traces, in measurement_trace's export format, for
+    // replaying on the desktop (see sim/trace-replay.h)
+    void handleExportTraces() {
+        std::string chunk;
+        chunk.reserve(EXPORT_CHUNK_SIZE + measurement_trace::MAX_TRACE_LENGTH);
+
+        _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _server.send(200, "application/octet-stream", "");
+
+        _traceStore->forEach([&](const char* title, size_t titleLength, const uint8_t* data, size_t length) {
+            measurement_trace::writeExportRecord(chunk, title, titleLength, data, length);
+            if (chunk.size() >= EXPORT_CHUNK_SIZE) {
+                _server.sendContent(chunk.c_str(), chunk.size());
+                chunk.clear();
+            }
+        });
+        if (!chunk.empty()) {
+            _server.sendContent(chunk.c_str(), chunk.size());
+        }
+        // terminates the chunked response
+        _server.sendContent("");
+    }
+
+    void handleMetrics() {
+        std::string body;
+        richiev::metrics::registry().render(body);
+        _server.send(200, "text/plain; version=0.0.4", body.c_str());
+    }
+
+    void handleProfile() {
+        std::string body;
+        richiev::metrics::renderProfileReport(body);
+        _server.send(200, "text/plain", body.c_str());
+    }
+
+    void setupWebServer(std::shared_ptr<reading_store::ReadingStore> rs, std::shared_ptr<measurement_trace::TraceStore> traceStore) {
         _readingStore = rs;
+        _traceStore = traceStore;
+
+        // built & uploaded via: pio run -t uploadfs
+        if (SPIFFS.begin()) {
+            _server.serveStatic("/static/", SPIFFS, "/static/", STATIC_ASSET_CACHE_HEADER);
+        } else {
+            Serial.println("Failed to mount SPIFFS, static assets will be missing");
+        }
 
         _server.on("/", [&]() { handleRoot(); });
         _server.on("/execute/measure_alk", [&]() { handleTrigger(); });
         _server.on("/readings.json", [&]() { handleGetReadings(); });
+        _server.on("/export/readings.csv", [&]() { handleExport("text/csv", reading_export::writeCSVHeader, reading_export::writeCSVRow); });
+        _server.on("/export/readings.ndjson", [&]() { handleExport("application/x-ndjson", nullptr, reading_export::writeNDJSONRow); });
+        _server.on("/export/traces", [&]() { handleExportTraces(); });
+        _server.on("/metrics", [&]() { handleMetrics(); });
+        _server.on("/profile", [&]() { handleProfile(); });
         _server.onNotFound([&]() { handleNotFound(); });
         _server.begin();
         Serial.println("HTTP server started");
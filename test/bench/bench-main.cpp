@@ -0,0 +1,161 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+
+namespace buff {
+namespace bench {
+
+/*******************************
+ * Runner
+ *
+ *   .pio/build/desktop_bench/program [--filter substring] [--min-time 0.5] [--json bench.json] [--commit sha]
+ *******************************/
+struct RunOptions {
+    const char *filter = nullptr;
+    double minTimeS = 0.5;
+    const char *jsonPath = nullptr;
+    const char *commit = nullptr;
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double realNS;
+    double cpuNS;
+    double itemsPerSecond;
+};
+
+const uint64_t MAX_ITERATIONS = 1000000000;
+
+Result run(const Benchmark &benchmark, const double minTimeS) {
+    uint64_t iterations = 1;
+    while (true) {
+        State state(iterations);
+        const std::clock_t cpuStart = std::clock();
+        const auto realStart = std::chrono::steady_clock::now();
+        benchmark.func(state);
+        const double realS = std::chrono::duration<double>(std::chrono::steady_clock::now() - realStart).count();
+        const double cpuS = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+        if (realS >= minTimeS || iterations >= MAX_ITERATIONS) {
+            return {.name = benchmark.name,
+                    .iterations = iterations,
+                    .realNS = realS * 1e9 / iterations,
+                    .cpuNS = cpuS * 1e9 / iterations,
+                    .itemsPerSecond = state.itemsProcessed() > 0 && cpuS > 0 ? state.itemsProcessed() / cpuS : 0};
+        }
+
+        // aim a bit past the min time, as Google Benchmark does, but don't grow too fast off a noisy short run
+        const double scale = realS > 0 ? minTimeS * 1.4 / realS : 10;
+        const uint64_t next = iterations * (scale < 10 ? scale : 10);
+        iterations = next > iterations ? (next < MAX_ITERATIONS ? next : MAX_ITERATIONS) : iterations + 1;
+    }
+}
+
+void printResult(FILE *out, const Result &result) {
+    fprintf(out, "%-48s %14.0f ns %14.0f ns %12llu", result.name.c_str(), result.realNS, result.cpuNS, (unsigned long long)result.iterations);
+    if (result.itemsPerSecond > 0) fprintf(out, "  items_per_second=%.4g/s", result.itemsPerSecond);
+    fprintf(out, "\n");
+}
+
+void writeJSONString(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s != 0; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+// Google Benchmark's --benchmark_format=json layout
+void writeJSON(FILE *out, const RunOptions &options, const std::vector<Result> &results) {
+    char date[32];
+    const time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+    char hostname[64] = {0};
+    gethostname(hostname, sizeof(hostname) - 1);
+
+    fprintf(out, "{\n  \"context\": {\n    \"date\": ");
+    writeJSONString(out, date);
+    fprintf(out, ",\n    \"host_name\": ");
+    writeJSONString(out, hostname);
+    fprintf(out, ",\n    \"executable\": \"buff_bench\",\n    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+    if (options.commit != nullptr) {
+        fprintf(out, "    \"commit\": ");
+        writeJSONString(out, options.commit);
+        fprintf(out, ",\n");
+    }
+    fprintf(out, "    \"library_build_type\": \"release\"\n  },\n  \"benchmarks\": [");
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &result = results[i];
+        fprintf(out, "%s\n    {\n      \"name\": ", i > 0 ? "," : "");
+        writeJSONString(out, result.name.c_str());
+        fprintf(out, ",\n      \"run_name\": ");
+        writeJSONString(out, result.name.c_str());
+        fprintf(out, ",\n      \"run_type\": \"iteration\",\n      \"iterations\": %llu,\n      \"real_time\": %.3f,\n      \"cpu_time\": %.3f,\n      \"time_unit\": \"ns\"",
+                (unsigned long long)result.iterations, result.realNS, result.cpuNS);
+        if (result.itemsPerSecond > 0) fprintf(out, ",\n      \"items_per_second\": %.3f", result.itemsPerSecond);
+        fprintf(out, "\n    }");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+bool parseArgs(const int argc, char **argv, RunOptions &options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *arg = argv[i];
+        const char *value = argv[i + 1];
+        if (strcmp(arg, "--filter") == 0) {
+            options.filter = value;
+        } else if (strcmp(arg, "--min-time") == 0) {
+            options.minTimeS = atof(value);
+        } else if (strcmp(arg, "--json") == 0) {
+            options.jsonPath = value;
+        } else if (strcmp(arg, "--commit") == 0) {
+            options.commit = value;
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options.minTimeS > 0;
+}
+
+}  // namespace bench
+}  // namespace buff
+
+int main(int argc, char **argv) {
+    using namespace buff::bench;
+    RunOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--filter substring] [--min-time 0.5] [--json file] [--commit sha]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-48s %17s %17s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    std::vector<Result> results;
+    for (const auto &benchmark : registry()) {
+        if (options.filter != nullptr && benchmark.name.find(options.filter) == std::string::npos) continue;
+        results.push_back(run(benchmark, options.minTimeS));
+        printResult(stdout, results.back());
+    }
+
+    if (options.jsonPath != nullptr) {
+        FILE *out = fopen(options.jsonPath, "w");
+        if (out == nullptr) {
+            perror(options.jsonPath);
+            return 1;
+        }
+        writeJSON(out, options, results);
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace buff {
+namespace bench {
+
+/*******************************
+ * Benchmarks
+ *
+ * A small Google Benchmark style harness for the hot paths, run on the host
+ * (env:desktop_bench). Each benchmark loops over the state:
+ *
+ *   void benchSomething(bench::State &state) {
+ *       for (auto _ : state) {
+ *           bench::doNotOptimize(something());
+ *       }
+ *   }
+ *   BENCHMARK(benchSomething);
+ *
+ * and is run for enough iterations to take --min-time. Results go to the
+ * console, and with --json <file> to Google Benchmark's JSON format, so its
+ * compare.py (or anything else) can track them per commit.
+ *******************************/
+class State {
+   private:
+    const uint64_t _iterations;
+    int64_t _itemsProcessed = 0;
+
+   public:
+    // what `for (auto _ : state)` gets, non trivial so it isn't warned about being unused
+    struct Value {
+        ~Value() {}
+    };
+
+    struct Iterator {
+        uint64_t remaining;
+
+        bool operator!=(const Iterator &other) const { return remaining != other.remaining; }
+        Iterator &operator++() {
+            remaining--;
+            return *this;
+        }
+        Value operator*() const { return Value(); }
+    };
+
+    explicit State(const uint64_t iterations) : _iterations(iterations) {}
+
+    Iterator begin() const { return {_iterations}; }
+    Iterator end() const { return {0}; }
+
+    uint64_t iterations() const { return _iterations; }
+
+    // eg readings sorted, reported as a rate
+    void setItemsProcessed(const int64_t items) { _itemsProcessed = items; }
+    int64_t itemsProcessed() const { return _itemsProcessed; }
+};
+
+using BenchmarkFunc = std::function<void(State &state)>;
+
+struct Benchmark {
+    std::string name;
+    BenchmarkFunc func;
+};
+
+inline std::vector<Benchmark> &registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+inline bool add(const std::string &name, const BenchmarkFunc &func) {
+    registry().push_back({name, func});
+    return true;
+}
+
+// Stops the compiler optimising away a result that's otherwise unused
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+#define BENCHMARK_NAMED(name, func) \
+    static const bool BENCH_CONCAT(benchRegistered, __LINE__) = buff::bench::add(name, func)
+#define BENCHMARK(func) BENCHMARK_NAMED(#func, func)
+
+}  // namespace bench
+}  // namespace buff
@@ -0,0 +1,85 @@
+#include <memory>
+
+#include "bench.h"
+#include "mqtt-common.h"
+#include "ph-controller.h"
+#include "readings/alk-measure.h"
+#include "sim/sim-doser.h"
+#include "sim/titration.h"
+#include "sim/virtual-clock.h"
+
+namespace bench_alk_measure {
+using namespace buff;
+
+void addAlkReading(bench::State &state) {
+    ph::controller::PHReadingStats<30> stats;
+    ph::PHReading reading = {.asOfMS = 0, .asOfAdjustedSec = 0, .rawPH = 8.1, .rawPH_mavg = 0, .calibratedPH = 8.2, .calibratedPH_mavg = 0};
+    for (auto _ : state) {
+        reading.rawPH += 0.0001;
+        bench::doNotOptimize(stats.addAlkReading(reading).calibratedPH_mavg);
+    }
+}
+BENCHMARK_NAMED("PHReadingStats::addAlkReading/30", addAlkReading);
+
+void calcAlkReading(bench::State &state) {
+    const alk_measure::AlkMeasurementConfig config;
+    alk_measure::AlkReading reading;
+    reading.tankWaterVolumeML = 200;
+    reading.reagentVolumeML = 5.6;
+    for (auto _ : state) {
+        reading.reagentVolumeML += 0.0001;
+        bench::doNotOptimize(alk_measure::calcAlkReading(reading, config));
+    }
+}
+BENCHMARK(calcAlkReading);
+
+/*******************************
+ * A whole measurement
+ *
+ * Against the simulated dosers, chemistry & probe, so this is the cost of
+ * the measurement logic (and the simulation), not of the dosing.
+ *******************************/
+class DiscardingPublisher : public mqtt::Publisher {
+   public:
+    void publishPH(const ph::PHReading &phReading) {}
+    void publishAlkReading(const alk_measure::AlkReading &alkReading) {}
+    void publishMeasureAlk(const std::string &title, const unsigned long asOfMS) {}
+};
+
+const DoserConfig doserConfig = {.mlPerFullRotation = 0.2, .motorRPM = 120, .microStepType = SIXTEENTH, .accelRPMPerSec = 240};
+const ph::PHCalibrator::CalibrationPoint highPoint = {.actualPH = 7.0, .readPH = 7.0};
+const ph::PHCalibrator::CalibrationPoint lowPoint = {.actualPH = 4.0, .readPH = 4.0};
+
+void measureAlk(bench::State &state) {
+    auto publisher = std::make_shared<DiscardingPublisher>();
+    auto timeClient = std::make_shared<buff_time::TimeWrapper>();
+    const alk_measure::AlkMeasurementConfig config = {.measurementTankWaterVolumeML = 200};
+
+    for (auto _ : state) {
+        sim::VirtualClock clock;
+        sim::TitrationSample sample({.alkalinityDKH = 8.0});
+        sim::SimulatedPHProbe probe(sample, clock);
+
+        auto buffDosers = std::make_shared<doser::BuffDosers>(0);
+        for (auto doserType : {FILL, REAGENT, DRAIN}) {
+            auto doser = std::make_shared<sim::SimulatedDoser>(doserConfig, clock);
+            doser->calibrator = std::make_shared<doser::Calibrator>(doserConfig.mlPerFullRotation);
+            sample.connect(*doser, doserType);
+            buffDosers->emplace(doserType, doser);
+        }
+        const ph::PHReadConfig phReadConfig = {.readIntervalMS = 1000, .phReadFunc = [&probe]() { return probe.read(); }};
+        auto phReader = std::make_shared<ph::controller::PHReader>(phReadConfig, ph::PHCalibrator(lowPoint, highPoint));
+        auto measurer = std::make_shared<alk_measure::AlkMeasurer>(buffDosers, config, phReader);
+
+        auto result = measurer->begin<15>(0, 0, "bench");
+        while (result.nextAction != alk_measure::MEASURE_DONE) {
+            result = measurer->measureAlk(publisher, timeClient, result);
+            // the measurement job's interval
+            clock.advanceMS(1000);
+        }
+        bench::doNotOptimize(result.alkReading.alkReadingDKH);
+    }
+}
+BENCHMARK_NAMED("measureAlk/simulated", measureAlk);
+
+}  // namespace bench_alk_measure
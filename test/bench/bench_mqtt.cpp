@@ -0,0 +1,124 @@
+#include <cstring>
+#include <memory>
+
+#include "bench.h"
+#include "commands.h"
+#include "mqtt-common.h"
+#include "mqtt-outbox.h"
+#include "mqtt-publish.h"
+
+namespace bench_mqtt {
+using namespace buff;
+using richiev::mqtt::Payload;
+
+/*******************************
+ * Decoding, a payload per handled topic
+ *******************************/
+struct TopicPayload {
+    const char *topic;
+    const char *payload;
+};
+
+// what the handlers in controller.h are sent
+const TopicPayload smallCommands[] = {
+    {"debug/profile", R"({"reset":true})"},
+    {"debug/triggerML", R"({"doser":"reagent","ml":1.5,"mlPerFullRotation":0.175})"},
+    {"debug/triggerSteps", R"({"doser":"fill","steps":3200})"},
+    {"debug/triggerRotations", R"({"doser":"drain","rotations":2.5})"},
+    {"debug/stirrer/enable", R"({"value":128})"},
+    {"config/mlPerFullRotation", R"({"doser":"fill","ml":0.269})"},
+    {"config/debugHandlers", R"({"enabled":false})"},
+};
+
+const char *const measureAlkPayload = R"({"title":"tank","asOf":1680000000,"measurementTankWaterVolumeML":200,"incrementalReagentDoseVolumeML":0.1})";
+
+void decodeSmallCommand(bench::State &state, const char *payload) {
+    const Payload message = {.data = payload, .length = strlen(payload)};
+    for (auto _ : state) {
+        commands::SmallCommandDoc doc;
+        const auto status = commands::parse(message, doc);
+        bench::doNotOptimize(status.ok());
+        bench::doNotOptimize(doc["ml"].as<float>());
+    }
+}
+
+void decodeMeasureAlk(bench::State &state) {
+    const Payload message = {.data = measureAlkPayload, .length = strlen(measureAlkPayload)};
+    const alk_measure::AlkMeasurementConfig defaults;
+    for (auto _ : state) {
+        commands::MeasureAlkCommand command;
+        const auto status = commands::decodeMeasureAlk(message, defaults, command);
+        bench::doNotOptimize(status.ok());
+        bench::doNotOptimize(command.config.measurementTankWaterVolumeML);
+    }
+}
+
+const bool registeredDecoders = []() {
+    for (const auto &command : smallCommands) {
+        const char *payload = command.payload;
+        bench::add(std::string("decode/") + command.topic, [payload](bench::State &state) { decodeSmallCommand(state, payload); });
+    }
+    bench::add("decode/" + mqtt::measureAlk, decodeMeasureAlk);
+    bench::add("decode/execute/measure_alk/manual/begin", decodeMeasureAlk);
+    return true;
+}();
+
+/*******************************
+ * Encoding, into the outbox
+ *******************************/
+const ph::PHReading phReading = {.asOfMS = 123456, .asOfAdjustedSec = 1680000000, .rawPH = 8.12, .rawPH_mavg = 8.11, .calibratedPH = 8.2, .calibratedPH_mavg = 8.19};
+
+alk_measure::AlkReading alkReading() {
+    alk_measure::AlkReading reading;
+    reading.asOfMS = 123456;
+    reading.asOfAdjustedSec = 1680000000;
+    reading.tankWaterVolumeML = 200;
+    reading.reagentVolumeML = 5.6;
+    reading.alkReadingDKH = 7.84;
+    reading.phReading = phReading;
+    reading.title = "tank";
+    return reading;
+}
+
+template <typename F>
+void encode(bench::State &state, const mqtt::TelemetryEncoding encoding, F &&publish) {
+    auto outbox = std::make_shared<richiev::mqtt::DefaultOutbox>();
+    mqtt::MQTTPublisher publisher(outbox, encoding);
+    const richiev::mqtt::PublishFunc discard = [](const char *topic, const char *payload, size_t length) { return true; };
+
+    unsigned long nowMS = 0;
+    for (auto _ : state) {
+        publish(publisher);
+        // the envelope's only sent once its interval's up
+        outbox->drain(nowMS++, discard);
+    }
+}
+
+void encodePH(bench::State &state) {
+    encode(state, mqtt::TelemetryEncoding::JSON, [](mqtt::MQTTPublisher &publisher) { publisher.publishPH(phReading); });
+}
+BENCHMARK_NAMED("encode/readings/ph", encodePH);
+
+void encodePHMsgPack(bench::State &state) {
+    encode(state, mqtt::TelemetryEncoding::MSGPACK, [](mqtt::MQTTPublisher &publisher) { publisher.publishPH(phReading); });
+}
+BENCHMARK_NAMED("encode/readings/ph/msgpack", encodePHMsgPack);
+
+void encodeAlk(bench::State &state) {
+    const auto reading = alkReading();
+    encode(state, mqtt::TelemetryEncoding::JSON, [&reading](mqtt::MQTTPublisher &publisher) { publisher.publishAlkReading(reading); });
+}
+BENCHMARK_NAMED("encode/readings/alk", encodeAlk);
+
+void encodeAlkMsgPack(bench::State &state) {
+    const auto reading = alkReading();
+    encode(state, mqtt::TelemetryEncoding::MSGPACK, [&reading](mqtt::MQTTPublisher &publisher) { publisher.publishAlkReading(reading); });
+}
+BENCHMARK_NAMED("encode/readings/alk/msgpack", encodeAlkMsgPack);
+
+void encodeMeasureAlk(bench::State &state) {
+    encode(state, mqtt::TelemetryEncoding::JSON, [](mqtt::MQTTPublisher &publisher) { publisher.publishMeasureAlk("tank", 123456); });
+}
+BENCHMARK_NAMED("encode/execute/measure_alk", encodeMeasureAlk);
+
+}  // namespace bench_mqtt
@@ -0,0 +1,61 @@
+#include <string>
+
+#include "bench.h"
+#include "readings/reading-store.h"
+#include "web-server-renderers.h"
+
+namespace bench_readings {
+using namespace buff;
+
+// a full store, with a handful of titles repeating like real use
+reading_store::ReadingStore &fullStore() {
+    static reading_store::ReadingStore store(reading_store::READINGS_TO_KEEP);
+    static bool filled = false;
+    if (!filled) {
+        const char *titles[] = {"", "tank", "sump", "after dose", "retest"};
+        for (size_t i = 0; i < reading_store::READINGS_TO_KEEP; i++) {
+            // out of order, so sorting has something to do
+            const unsigned long asOf = 1680000000 + ((i * 37) % reading_store::READINGS_TO_KEEP) * 3600;
+            store.addAlkReading({.asOfAdjustedSec = asOf, .alkReadingDKH = 7.0f + (i % 20) * 0.1f, .title = titles[i % 5]});
+        }
+        store.addPHReading({.asOfMS = 1000, .asOfAdjustedSec = 1680000000, .rawPH = 8.1, .rawPH_mavg = 8.1, .calibratedPH = 8.15, .calibratedPH_mavg = 8.15});
+        filled = true;
+    }
+    return store;
+}
+
+void renderRoot(bench::State &state) {
+    auto &store = fullStore();
+    const auto readings = store.getReadingsSortedByAsOf();
+    const auto titles = store.getRecentTitles(readings);
+    std::string page;
+    for (auto _ : state) {
+        page.clear();
+        web_server::renderRoot(page, 0, web_server::TriggerVal::NA, 1680300000, 123456, readings, titles, store.getMostRecentPHReading());
+        bench::doNotOptimize(page.data());
+    }
+}
+BENCHMARK_NAMED("renderRoot/80", renderRoot);
+
+void readingsSortedByAsOf(bench::State &state) {
+    auto &store = fullStore();
+    for (auto _ : state) {
+        const auto readings = store.getReadingsSortedByAsOf();
+        bench::doNotOptimize(readings.data());
+    }
+    state.setItemsProcessed(state.iterations() * reading_store::READINGS_TO_KEEP);
+}
+BENCHMARK_NAMED("getReadingsSortedByAsOf/80", readingsSortedByAsOf);
+
+void recentTitles(bench::State &state) {
+    auto &store = fullStore();
+    const auto readings = store.getReadingsSortedByAsOf();
+    for (auto _ : state) {
+        const auto titles = store.getRecentTitles(readings);
+        bench::doNotOptimize(titles.size());
+    }
+    state.setItemsProcessed(state.iterations() * reading_store::READINGS_TO_KEEP);
+}
+BENCHMARK_NAMED("getRecentTitles/80", recentTitles);
+
+}  // namespace bench_readings
@@ -5,6 +5,7 @@
 
 #include "ph-controller.h"
 #include "readings/ph.h"
+#include "sim/titration.h"
 
 namespace buff {
 const ph::PHCalibrator::CalibrationPoint NoOpHighPoint = {.actualPH = 7.0, .readPH = 7.0};
@@ -36,4 +37,13 @@ static std::unique_ptr<ph::controller::PHReader> buildPHReader(std::vector<float
     return std::make_unique<ph::controller::PHReader>(phReadConfig, calibrator);
 }
 
+// reads from a simulated probe rather than a canned sequence
+static std::unique_ptr<ph::controller::PHReader> buildPHReader(sim::SimulatedPHProbe &probe, const ph::PHCalibrator &calibrator = NoOpPHCalibrator) {
+    const ph::PHReadConfig phReadConfig = {
+        .readIntervalMS = 1000,
+        .phReadFunc = [&probe]() { return probe.read(); }};
+
+    return std::make_unique<ph::controller::PHReader>(phReadConfig, calibrator);
+}
+
 }  // namespace buff
@@ -2,6 +2,7 @@
 #include <unity.h>
 
 #include <iterator>
+#include <string>
 #include <vector>
 
 #include "readings/alk-measure.h"
@@ -28,6 +29,23 @@ class MockDoser : public doser::Doser {
     virtual void debugRotateSteps(const long steps)  {}
 };
 
+// logs its doses, to check what order they happen in
+class LoggingDoser : public doser::Doser {
+   private:
+    std::string _name;
+    std::vector<std::string> &_log;
+
+   public:
+    LoggingDoser(const std::string &name, std::vector<std::string> &log) : doser::Doser(NONE_CONFIG), _name(name), _log(log) {}
+
+    virtual void doseML(const float outputML, doser::Calibrator *aCalibrator = nullptr) { _log.push_back(_name + " " + std::to_string(outputML)); }
+
+    virtual void setup() {}
+
+    virtual void debugRotateDegrees(const int deg) {}
+    virtual void debugRotateSteps(const long steps) {}
+};
+
 #define mockptrize(mockPtr) &mockPtr->get(), [](...) {}
 
 std::unique_ptr<doser::BuffDosers> buildMockDosers() {
@@ -75,6 +93,7 @@ void stubs() {
     When(OverloadedMethod(ArduinoFake(Serial), println, size_t(void))).AlwaysReturn();
 
     When(Method(ArduinoFake(), millis)).AlwaysReturn(FAKED_MILLIS);
+    When(Method(ArduinoFake(), micros)).AlwaysReturn(FAKED_MILLIS * 1000);
 
     When(Method(ArduinoFake(), digitalWrite)).AlwaysReturn();
 }
@@ -166,9 +185,13 @@ void testSequenceWithSingleDose() {
 
     // Measurement2: 4.5
     // STEP_INITIALIZE
+    auto doseStepResult = measureStepResult;
     measureStepResult = measurer.measureAlk<2>(publisher, timeClient, measureStepResult);
     TEST_ASSERT_EQUAL(alk_measure::MEASURE, measureStepResult.nextAction);
     TEST_ASSERT_EQUAL(alk_measure::MEASURE_PH, measureStepResult.nextMeasurementStepAction);
+    // the stats start afresh, without touching the previous step's
+    TEST_ASSERT_EQUAL(0, measureStepResult.measuredPHStats->readingCount());
+    TEST_ASSERT_EQUAL(2, doseStepResult.measuredPHStats->readingCount());
 
     // MEASURE_PH 1
     measureStepResult = measurer.measureAlk<2>(publisher, timeClient, measureStepResult);
@@ -214,17 +237,19 @@ void testPublishResultIsReadable() {
     auto measurer = std::make_shared<buff::alk_measure::AlkMeasurer>(std::move(buffDosers), alkMeasureConf, phReader);
 
     auto begin = measurer->begin<1>(FAKED_MILLIS, FAKED_MILLIS, "foobar");
-    auto looper = alk_measure::beginAlkMeasureLoop<1>(std::shared_ptr<alk_measure::AlkMeasurer>(measurer),
-                                                      publisher,
-                                                      timeClient,
-                                                      alkMeasureConf,
-                                                      std::string("testTitle"));
+    std::optional<alk_measure::AlkMeasureLooper<1>> looperStorage;
+    auto &looper = alk_measure::beginAlkMeasureLoop<1>(looperStorage,
+                                                       std::shared_ptr<alk_measure::AlkMeasurer>(measurer),
+                                                       publisher,
+                                                       timeClient,
+                                                       alkMeasureConf,
+                                                       std::string("testTitle"));
     int i = 0;
     auto step = begin;
     while (step.nextAction != alk_measure::MeasurementAction::MEASURE_DONE) {
         TEST_ASSERT_LESS_THAN(50, i++);
 
-        step = looper->nextStep();
+        step = looper.nextStep();
         TEST_ASSERT_EQUAL(FAKED_MILLIS, step.asOfMS);
         TEST_ASSERT_EQUAL(FAKED_MILLIS, step.asOfAdjustedSec);
         TEST_ASSERT_EQUAL(FAKED_MILLIS, step.alkReading.asOfMS);
@@ -240,10 +265,35 @@ void testPublishResultIsReadable() {
     })).Exactly(Once);
 }
 
+void testPrimeDosesInOrder() {
+    std::vector<std::string> log;
+    auto buffDosers = std::make_shared<doser::BuffDosers>(1);
+    buffDosers->emplace(MeasurementDoserType::FILL, std::make_shared<LoggingDoser>("fill", log));
+    buffDosers->emplace(MeasurementDoserType::REAGENT, std::make_shared<LoggingDoser>("reagent", log));
+
+    alk_measure::AlkMeasurementConfig alkMeasureConf = {
+        .primeTankWaterFillVolumeML = 1.0,
+        .primeReagentReverseVolumeML = -2.5,
+        .primeReagentVolumeML = 3.0};
+    alk_measure::primeDosers(buffDosers, alkMeasureConf);
+
+    // tank water either side of the reagent
+    const std::vector<std::string> expected = {
+        "fill " + std::to_string(0.5f),
+        "reagent " + std::to_string(-2.5f),
+        "reagent " + std::to_string(3.0f),
+        "fill " + std::to_string(0.5f)};
+    TEST_ASSERT_EQUAL(expected.size(), log.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), log[i].c_str());
+    }
+}
+
 }  // namespace test_alk_measure
 
 void runAlkMeasureTests() {
     RUN_TEST(test_alk_measure::testBeginStartsEmpty);
     RUN_TEST(test_alk_measure::testSequenceWithSingleDose);
     RUN_TEST(test_alk_measure::testPublishResultIsReadable);
+    RUN_TEST(test_alk_measure::testPrimeDosesInOrder);
 }
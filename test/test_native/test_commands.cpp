@@ -0,0 +1,169 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <cstring>
+#include <string>
+
+#include "commands.h"
+#include "mqtt-outbox.h"
+
+namespace test_commands {
+using namespace buff;
+using namespace fakeit;
+
+void stubs() {
+    When(OverloadedMethod(ArduinoFake(Serial), print, size_t(const char[]))).AlwaysReturn();
+    When(OverloadedMethod(ArduinoFake(Serial), println, size_t(const char[]))).AlwaysReturn();
+}
+
+commands::Payload payloadOf(const char* body) {
+    return {.data = body, .length = strlen(body)};
+}
+
+void testDefaultsWhenEmpty() {
+    alk_measure::AlkMeasurementConfig defaults;
+    defaults.stirTimes = 3;
+
+    commands::MeasureAlkCommand command;
+    auto status = commands::decodeMeasureAlk(payloadOf(""), defaults, command);
+    TEST_ASSERT_TRUE(status.ok());
+    TEST_ASSERT_EQUAL(3, command.config.stirTimes);
+    TEST_ASSERT_FALSE(command.hasAsOf);
+    TEST_ASSERT_EQUAL_STRING("", command.title.c_str());
+}
+
+void testOverridesFields() {
+    alk_measure::AlkMeasurementConfig defaults;
+    commands::MeasureAlkCommand command;
+    auto status = commands::decodeMeasureAlk(payloadOf(R"({"title":"morning","asOf":1234,"stirTimes":4,"reagentStrengthMoles":0.05})"), defaults, command);
+    TEST_ASSERT_TRUE(status.ok());
+    TEST_ASSERT_EQUAL_STRING("morning", command.title.c_str());
+    TEST_ASSERT_TRUE(command.hasAsOf);
+    TEST_ASSERT_EQUAL(1234, command.asOf);
+    TEST_ASSERT_EQUAL(4, command.config.stirTimes);
+    TEST_ASSERT_EQUAL_FLOAT(0.05, command.config.reagentStrengthMoles);
+    TEST_ASSERT_EQUAL_FLOAT(defaults.extraPurgeVolumeML, command.config.extraPurgeVolumeML);
+}
+
+void testEveryFieldFits() {
+    // this used to overflow the 200 byte document and silently drop fields
+    const char* body = R"({
+        "title": "a long title, well past the stored length",
+        "asOf": 4000000000,
+        "primeTankWaterFillVolumeML": 1.5,
+        "primeReagentReverseVolumeML": -2.5,
+        "primeReagentVolumeML": 2.5,
+        "measurementTankWaterVolumeML": 150,
+        "extraPurgeVolumeML": 40,
+        "initialReagentDoseVolumeML": 3.5,
+        "maxReagentDoseML": 10,
+        "incrementalReagentDoseVolumeML": 0.2,
+        "stirAmountML": 2,
+        "stirTimes": 2,
+        "reagentStrengthMoles": 0.2,
+        "calibrationMultiplier": 1.1
+    })";
+    alk_measure::AlkMeasurementConfig defaults;
+    commands::MeasureAlkCommand command;
+    auto status = commands::decodeMeasureAlk(payloadOf(body), defaults, command);
+    TEST_ASSERT_TRUE(status.ok());
+    TEST_ASSERT_EQUAL(4000000000ul, command.asOf);
+    TEST_ASSERT_EQUAL_FLOAT(150, command.config.measurementTankWaterVolumeML);
+    TEST_ASSERT_EQUAL_FLOAT(1.1, command.config.calibrationMultiplier);
+    TEST_ASSERT_EQUAL(2, command.config.stirTimes);
+}
+
+void testFullCommandMakesItThroughTheInbox() {
+    const std::string title(commands::MAX_TITLE_PAYLOAD_LEN, 't');
+    const std::string body = R"({"title":")" + title + R"(","asOf":4000000000,)"
+                             R"("primeTankWaterFillVolumeML":1.5,"primeReagentReverseVolumeML":-2.5,"primeReagentVolumeML":2.5,)"
+                             R"("measurementTankWaterVolumeML":150,"extraPurgeVolumeML":40,"initialReagentDoseVolumeML":3.5,)"
+                             R"("maxReagentDoseML":10,"incrementalReagentDoseVolumeML":0.2,"stirAmountML":2,"stirTimes":2,)"
+                             R"("reagentStrengthMoles":0.2,"calibrationMultiplier":1.1})";
+    TEST_ASSERT_GREATER_THAN(richiev::mqtt::MAX_QUEUED_PAYLOAD_LEN, body.size());
+
+    richiev::mqtt::Inbox<1> inbox;
+    TEST_ASSERT_TRUE(inbox.push("execute/measure_alk", body.c_str(), body.size()));
+    richiev::mqtt::InboxMessage message;
+    TEST_ASSERT_TRUE(inbox.pop(message));
+
+    alk_measure::AlkMeasurementConfig defaults;
+    commands::MeasureAlkCommand command;
+    auto status = commands::decodeMeasureAlk({.data = message.payload, .length = message.length}, defaults, command);
+    TEST_ASSERT_TRUE(status.ok());
+    TEST_ASSERT_EQUAL_STRING(title.c_str(), command.title.c_str());
+    TEST_ASSERT_EQUAL(4000000000ul, command.asOf);
+    TEST_ASSERT_EQUAL_FLOAT(-2.5, command.config.primeReagentReverseVolumeML);
+    TEST_ASSERT_EQUAL_FLOAT(1.1, command.config.calibrationMultiplier);
+}
+
+void testReportsErrors() {
+    alk_measure::AlkMeasurementConfig defaults;
+    commands::MeasureAlkCommand command;
+
+    auto status = commands::decodeMeasureAlk(payloadOf(R"({"stirTimes":1.5})"), defaults, command);
+    TEST_ASSERT_FALSE(status.ok());
+    TEST_ASSERT_EQUAL_STRING("wrong type", status.error);
+    TEST_ASSERT_EQUAL_STRING("stirTimes", status.field);
+
+    status = commands::decodeMeasureAlk(payloadOf(R"({"reagentStrengthMoles":"0.1"})"), defaults, command);
+    TEST_ASSERT_FALSE(status.ok());
+    TEST_ASSERT_EQUAL_STRING("reagentStrengthMoles", status.field);
+
+    status = commands::decodeMeasureAlk(payloadOf(R"({"title":)"), defaults, command);
+    TEST_ASSERT_FALSE(status.ok());
+
+    status = commands::decodeMeasureAlk(payloadOf("[1]"), defaults, command);
+    TEST_ASSERT_FALSE(status.ok());
+}
+
+void testIgnoresUnknownFields() {
+    stubs();
+    alk_measure::AlkMeasurementConfig defaults;
+    defaults.stirTimes = 3;
+    commands::MeasureAlkCommand command;
+
+    auto status = commands::decodeMeasureAlk(payloadOf(R"({"stirTime":1,"title":"t","stirTimes":4})"), defaults, command);
+    TEST_ASSERT_TRUE(status.ok());
+    TEST_ASSERT_EQUAL(4, command.config.stirTimes);
+    TEST_ASSERT_EQUAL_STRING("t", command.title.c_str());
+
+    // more than there's room for, they're filtered out instead
+    status = commands::decodeMeasureAlk(payloadOf(R"({"a":"aaaaaaaa","b":[1,2,3],"c":{"d":1},"e":1,"f":2,"g":3,"h":4,"stirTimes":5})"), defaults, command);
+    TEST_ASSERT_TRUE(status.ok());
+    TEST_ASSERT_EQUAL(5, command.config.stirTimes);
+}
+
+void testRejectsLongTitles() {
+    stubs();
+    alk_measure::AlkMeasurementConfig defaults;
+    commands::MeasureAlkCommand command;
+
+    const std::string longest(commands::MAX_TITLE_PAYLOAD_LEN, 't');
+    auto status = commands::decodeMeasureAlk(payloadOf(("{\"title\":\"" + longest + "\"}").c_str()), defaults, command);
+    TEST_ASSERT_TRUE(status.ok());
+    TEST_ASSERT_EQUAL_STRING(longest.c_str(), command.title.c_str());
+
+    status = commands::decodeMeasureAlk(payloadOf(("{\"title\":\"" + longest + "t\"}").c_str()), defaults, command);
+    TEST_ASSERT_FALSE(status.ok());
+    TEST_ASSERT_EQUAL_STRING("title too long", status.error);
+    TEST_ASSERT_EQUAL_STRING("title", status.field);
+
+    // far too long for the document
+    const std::string longer(4 * commands::MAX_TITLE_PAYLOAD_LEN, 't');
+    status = commands::decodeMeasureAlk(payloadOf(("{\"title\":\"" + longer + "\"}").c_str()), defaults, command);
+    TEST_ASSERT_FALSE(status.ok());
+    TEST_ASSERT_EQUAL_STRING("title too long", status.error);
+}
+
+}  // namespace test_commands
+
+void runCommandsTests() {
+    RUN_TEST(test_commands::testDefaultsWhenEmpty);
+    RUN_TEST(test_commands::testOverridesFields);
+    RUN_TEST(test_commands::testEveryFieldFits);
+    RUN_TEST(test_commands::testFullCommandMakesItThroughTheInbox);
+    RUN_TEST(test_commands::testReportsErrors);
+    RUN_TEST(test_commands::testIgnoresUnknownFields);
+    RUN_TEST(test_commands::testRejectsLongTitles);
+}
@@ -0,0 +1,64 @@
+#include <unity.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "event-bus.h"
+#include "event-channel.h"
+
+namespace test_event_bus {
+using namespace buff;
+
+class RecordingPublisher : public mqtt::Publisher {
+   public:
+    std::vector<std::string> measureTitles;
+
+    void publishPH(const ph::PHReading& phReading) {}
+    void publishAlkReading(const alk_measure::AlkReading& alkReading) {}
+    void publishMeasureAlk(const std::string& title, const unsigned long asOfMS) { measureTitles.push_back(title); }
+};
+
+void testChannelDeliversInOrder() {
+    richiev::events::Channel<int, 2> channel;
+    std::vector<int> seen;
+    TEST_ASSERT_TRUE(channel.subscribe([&](const int& v) { seen.push_back(v); }));
+    TEST_ASSERT_TRUE(channel.subscribe([&](const int& v) { seen.push_back(v * 10); }));
+    // full
+    TEST_ASSERT_FALSE(channel.subscribe([&](const int& v) {}));
+    TEST_ASSERT_EQUAL(2, channel.subscriberCount());
+
+    channel.publish(3);
+    TEST_ASSERT_EQUAL(2, seen.size());
+    TEST_ASSERT_EQUAL(3, seen[0]);
+    TEST_ASSERT_EQUAL(30, seen[1]);
+}
+
+void testBusPublisherDeliversReadingsLocally() {
+    auto commandPublisher = std::make_shared<RecordingPublisher>();
+    // its own channels, so nothing's left subscribed to the global ones
+    events::PHChannel phReadings;
+    events::AlkChannel alkReadings;
+    events::BusPublisher publisher(commandPublisher, phReadings, alkReadings);
+
+    const ph::PHReading* lastPH = nullptr;
+    phReadings.subscribe([&](const ph::PHReading& reading) { lastPH = &reading; });
+
+    ph::PHReading reading = {};
+    reading.calibratedPH_mavg = 8.1;
+    publisher.publishPH(reading);
+    // delivered by reference, no copy or serialization
+    TEST_ASSERT_TRUE(lastPH == &reading);
+    TEST_ASSERT_EQUAL(0, events::phReadings.subscriberCount());
+
+    publisher.publishMeasureAlk("morning", 1);
+    TEST_ASSERT_EQUAL(1, commandPublisher->measureTitles.size());
+    TEST_ASSERT_EQUAL_STRING("morning", commandPublisher->measureTitles[0].c_str());
+}
+
+}  // namespace test_event_bus
+
+void runEventBusTests() {
+    RUN_TEST(test_event_bus::testChannelDeliversInOrder);
+    RUN_TEST(test_event_bus::testBusPublisherDeliversReadingsLocally);
+}
@@ -0,0 +1,230 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "ph-mock.h"
+#include "readings/alk-measure.h"
+#include "readings/measurement-trace.h"
+#include "sim/trace-replay.h"
+
+namespace test_measurement_trace {
+using namespace buff;
+using namespace buff::measurement_trace;
+using namespace fakeit;
+
+void stubs() {
+    When(OverloadedMethod(ArduinoFake(Serial), print, size_t(const char[]))).AlwaysReturn();
+    When(OverloadedMethod(ArduinoFake(Serial), println, size_t(const char[]))).AlwaysReturn();
+    When(Method(ArduinoFake(), millis)).AlwaysReturn(1000);
+    When(Method(ArduinoFake(), micros)).AlwaysReturn(1000000);
+    When(Method(ArduinoFake(), digitalWrite)).AlwaysReturn();
+}
+
+struct Recorded {
+    std::string title;
+    std::vector<uint8_t> data;
+};
+
+Recorded finish(TraceRecorder &recorder, const float alkReadingDKH) {
+    Recorded recorded;
+    recorder.onFinished = [&recorded](const std::string &title, const uint8_t *data, size_t length) {
+        recorded.title = title;
+        recorded.data.assign(data, data + length);
+    };
+    alk_measure::AlkReading reading;
+    reading.alkReadingDKH = alkReadingDKH;
+    reading.tankWaterVolumeML = 200;
+    reading.reagentVolumeML = 5.6;
+    recorder.finish(reading);
+    return recorded;
+}
+
+void testRoundTrip() {
+    alk_measure::AlkMeasurementConfig config;
+    config.measurementTankWaterVolumeML = 150;
+    config.stirTimes = 3;
+    const ph::PHCalibrator calibrator({.actualPH = 4.0, .readPH = 4.1}, {.actualPH = 7.0, .readPH = 6.9});
+
+    TraceRecorder recorder;
+    recorder.begin("tank", 15, config, calibrator, 5000, 1680000000);
+    recorder.dose(REAGENT, 4.0, 5000);
+    recorder.phSample(5.12, 6000);
+    recorder.step(2, 2, 300000);
+    const auto recorded = finish(recorder, 7.84);
+    TEST_ASSERT_FALSE(recorder.recording());
+
+    Trace trace;
+    TEST_ASSERT_TRUE(decode(recorded.title, recorded.data.data(), recorded.data.size(), trace));
+    TEST_ASSERT_EQUAL_STRING("tank", trace.title.c_str());
+    TEST_ASSERT_TRUE(trace.finished());
+    TEST_ASSERT_FALSE(trace.truncated());
+    TEST_ASSERT_EQUAL(15, trace.numSamples);
+    TEST_ASSERT_EQUAL(5000, trace.startedAtMS);
+    TEST_ASSERT_EQUAL(1680000000, trace.startedAtAdjustedSec);
+    TEST_ASSERT_EQUAL_FLOAT(4.1, trace.lowReadPH);
+    TEST_ASSERT_EQUAL_FLOAT(6.9, trace.highReadPH);
+    TEST_ASSERT_EQUAL_FLOAT(150, trace.config.measurementTankWaterVolumeML);
+    TEST_ASSERT_EQUAL(3, trace.config.stirTimes);
+    TEST_ASSERT_EQUAL_FLOAT(7.84, trace.alkReadingDKH);
+    TEST_ASSERT_EQUAL_FLOAT(5.6, trace.reagentVolumeML);
+
+    TEST_ASSERT_EQUAL(3, trace.events.size());
+    TEST_ASSERT_EQUAL(DOSE, trace.events[0].type);
+    TEST_ASSERT_EQUAL(REAGENT, trace.events[0].doserType);
+    TEST_ASSERT_EQUAL_FLOAT(4.0, trace.events[0].value);
+    TEST_ASSERT_EQUAL(0, trace.events[0].atMS);
+    TEST_ASSERT_EQUAL(PH_SAMPLE, trace.events[1].type);
+    TEST_ASSERT_EQUAL_FLOAT(5.12, trace.events[1].value);
+    TEST_ASSERT_EQUAL(1000, trace.events[1].atMS);
+    TEST_ASSERT_EQUAL(STEP, trace.events[2].type);
+    TEST_ASSERT_EQUAL(2, trace.events[2].action);
+    TEST_ASSERT_EQUAL(2, trace.events[2].stepAction);
+    TEST_ASSERT_EQUAL(295000, trace.events[2].atMS);
+
+    // and through the export format
+    std::string exported;
+    writeExportRecord(exported, "tank", 4, recorded.data.data(), recorded.data.size());
+    writeExportRecord(exported, "sump", 4, recorded.data.data(), recorded.data.size());
+    std::vector<Trace> traces;
+    TEST_ASSERT_TRUE(decodeExport((const uint8_t *)exported.data(), exported.size(), traces));
+    TEST_ASSERT_EQUAL(2, traces.size());
+    TEST_ASSERT_EQUAL_STRING("sump", traces[1].title.c_str());
+    TEST_ASSERT_EQUAL(3, traces[1].events.size());
+
+    traces.clear();
+    TEST_ASSERT_FALSE(decodeExport((const uint8_t *)exported.data(), exported.size() - 1, traces));
+    TEST_ASSERT_EQUAL(1, traces.size());
+}
+
+void testStopsRecordingWhenFull() {
+    TraceRecorder recorder;
+    // nothing's recorded outside a measurement
+    recorder.phSample(5.0, 0);
+    TEST_ASSERT_FALSE(recorder.recording());
+
+    recorder.begin("long", 15, {}, NoOpPHCalibrator, 0, 0);
+    for (unsigned long i = 0; i < MAX_TRACE_LENGTH; i++) recorder.phSample(5.0, i * 1000);
+    const auto recorded = finish(recorder, 8.0);
+    TEST_ASSERT_TRUE(recorded.data.size() <= MAX_TRACE_LENGTH);
+
+    Trace trace;
+    TEST_ASSERT_TRUE(decode(recorded.title, recorded.data.data(), recorded.data.size(), trace));
+    TEST_ASSERT_TRUE(trace.truncated());
+    TEST_ASSERT_TRUE(trace.finished());
+    TEST_ASSERT_EQUAL_FLOAT(8.0, trace.alkReadingDKH);
+}
+
+// a measurement through AlkMeasurer, as the device would record it
+Trace recordMeasurement(std::vector<float> &phValues) {
+    std::shared_ptr<ph::controller::PHReader> phReader = buildPHReader(phValues);
+    auto buffDosers = std::make_shared<doser::BuffDosers>(1);
+    for (auto doserType : {FILL, REAGENT, DRAIN}) buffDosers->emplace(doserType, std::make_shared<sim::ReplayDoser>());
+
+    const alk_measure::AlkMeasurementConfig config = {.measurementTankWaterVolumeML = 200, .initialReagentDoseVolumeML = 3.0};
+    alk_measure::AlkMeasurer measurer(buffDosers, config, phReader);
+    auto recorder = std::make_shared<TraceRecorder>();
+    Trace trace;
+    recorder->onFinished = [&trace](const std::string &title, const uint8_t *data, size_t length) { decode(title, data, length, trace); };
+    measurer.traceTo(recorder);
+
+    auto publisher = std::make_shared<sim::ReplayPublisher>();
+    auto timeClient = std::make_shared<buff_time::TimeWrapper>();
+    auto step = measurer.begin<2>(0, 0, "field");
+    while (step.nextAction != alk_measure::MEASURE_DONE) step = measurer.measureAlk(publisher, timeClient, step);
+    return trace;
+}
+
+void testReplayMatchesRecording() {
+    stubs();
+    std::vector<float> phValues({5.1, 5.1, 4.8, 4.7, 4.5, 4.5});
+    const auto recorded = recordMeasurement(phValues);
+    TEST_ASSERT_TRUE(recorded.finished());
+    TEST_ASSERT_EQUAL(2, recorded.numSamples);
+    TEST_ASSERT_EQUAL_FLOAT(4.48, recorded.alkReadingDKH);
+
+    const auto result = sim::replay<2>(recorded);
+    TEST_ASSERT_TRUE(result.matches);
+    TEST_ASSERT_EQUAL(-1, result.divergedAt);
+    TEST_ASSERT_EQUAL(recorded.events.size(), result.replayed.events.size());
+    TEST_ASSERT_EQUAL_FLOAT(4.48, result.replayed.alkReadingDKH);
+}
+
+void testReplaySpotsDivergence() {
+    stubs();
+    std::vector<float> phValues({5.1, 5.1, 4.8, 4.7, 4.5, 4.5});
+    auto recorded = recordMeasurement(phValues);
+
+    // as if the measurement logic had seen the endpoint a dose earlier
+    size_t sampleIndex = 0;
+    for (auto &event : recorded.events) {
+        if (event.type == PH_SAMPLE && sampleIndex++ >= 2) event.value = 4.5;
+    }
+    const auto result = sim::replay<2>(recorded);
+    TEST_ASSERT_FALSE(result.matches);
+    TEST_ASSERT_TRUE(result.divergedAt >= 0);
+    TEST_ASSERT_EQUAL_FLOAT(4.34, result.replayed.alkReadingDKH);
+
+    // and running out of samples
+    recorded.events.resize(recorded.events.size() / 2);
+    TEST_ASSERT_TRUE(sim::replay<2>(recorded).ranOutOfSamples);
+}
+
+void testOverlappingMeasurementsAreTracedApart() {
+    stubs();
+    // both measurements read from the same probe, down to the endpoint
+    std::vector<float> phValues;
+    for (int i = 0; i < 20; i++) phValues.push_back(5.1 - i * 0.02);
+    phValues.resize(100, 4.5);
+    std::shared_ptr<ph::controller::PHReader> phReader = buildPHReader(phValues);
+    auto buffDosers = std::make_shared<doser::BuffDosers>(1);
+    for (auto doserType : {FILL, REAGENT, DRAIN}) buffDosers->emplace(doserType, std::make_shared<sim::ReplayDoser>());
+
+    const alk_measure::AlkMeasurementConfig config = {.measurementTankWaterVolumeML = 200, .initialReagentDoseVolumeML = 3.0};
+    auto measurer = std::make_shared<alk_measure::AlkMeasurer>(buffDosers, config, phReader);
+    auto recorder = std::make_shared<TraceRecorder>();
+    std::vector<Trace> traces;
+    recorder->onFinished = [&traces](const std::string &title, const uint8_t *data, size_t length) {
+        traces.emplace_back();
+        decode(title, data, length, traces.back());
+    };
+    measurer->traceTo(recorder);
+
+    auto publisher = std::make_shared<sim::ReplayPublisher>();
+    auto timeClient = std::make_shared<buff_time::TimeWrapper>();
+    std::optional<alk_measure::AlkMeasureLooper<2>> autoLooper;
+    std::optional<alk_measure::AlkMeasureLooper<2>> manualLooper;
+    alk_measure::beginAlkMeasureLoop(autoLooper, measurer, publisher, timeClient, config, "auto");
+    autoLooper->nextStep();
+    // a manual measurement started, and restarted, mid way through the auto one
+    alk_measure::beginAlkMeasureLoop(manualLooper, measurer, publisher, timeClient, config, "manual");
+    manualLooper->nextStep();
+    alk_measure::beginAlkMeasureLoop(manualLooper, measurer, publisher, timeClient, config, "manual");
+    while (autoLooper->getLastStepResult().nextAction != alk_measure::MEASURE_DONE ||
+           manualLooper->getLastStepResult().nextAction != alk_measure::MEASURE_DONE) {
+        autoLooper->nextStep();
+        manualLooper->nextStep();
+    }
+
+    // only the auto one was recorded, and none of the manual one's doses & samples made it in
+    TEST_ASSERT_EQUAL(1, traces.size());
+    TEST_ASSERT_EQUAL_STRING("auto", traces[0].title.c_str());
+    const auto result = sim::replay<2>(traces[0]);
+    TEST_ASSERT_TRUE(result.matches);
+    TEST_ASSERT_EQUAL_FLOAT(autoLooper->getLastStepResult().alkReading.alkReadingDKH, traces[0].alkReadingDKH);
+
+    // and with it done, the next measurement's recorded
+    alk_measure::beginAlkMeasureLoop(manualLooper, measurer, publisher, timeClient, config, "next");
+    TEST_ASSERT_TRUE(recorder->recording());
+}
+
+}  // namespace test_measurement_trace
+
+void runMeasurementTraceTests() {
+    RUN_TEST(test_measurement_trace::testRoundTrip);
+    RUN_TEST(test_measurement_trace::testStopsRecordingWhenFull);
+    RUN_TEST(test_measurement_trace::testReplayMatchesRecording);
+    RUN_TEST(test_measurement_trace::testReplaySpotsDivergence);
+    RUN_TEST(test_measurement_trace::testOverlappingMeasurementsAreTracedApart);
+}
@@ -0,0 +1,70 @@
+#include <unity.h>
+
+#include <string>
+
+#include "metrics.h"
+
+namespace test_metrics {
+using namespace richiev::metrics;
+
+const uint32_t TEST_BUCKETS[] = {10, 100};
+
+void testCounter() {
+    Counter counter("test_counter_total", "a counter");
+    TEST_ASSERT_EQUAL(0, counter.value());
+    counter.increment();
+    counter.increment(4);
+    TEST_ASSERT_EQUAL(5, counter.value());
+
+    std::string out;
+    counter.render(out);
+    TEST_ASSERT_EQUAL_STRING("test_counter_total 5\n", out.c_str());
+}
+
+void testHistogramBuckets() {
+    Histogram histogram("test_duration_seconds", "a histogram", TEST_BUCKETS, "kind=\"a\"", 1);
+    histogram.observe(5);
+    histogram.observe(10);
+    histogram.observe(50);
+    histogram.observe(1000);
+
+    TEST_ASSERT_EQUAL(4, histogram.count());
+    TEST_ASSERT_EQUAL(1065, histogram.sum());
+
+    std::string out;
+    histogram.render(out);
+    TEST_ASSERT_EQUAL_STRING(
+        "test_duration_seconds_bucket{kind=\"a\",le=\"10\"} 2\n"
+        "test_duration_seconds_bucket{kind=\"a\",le=\"100\"} 3\n"
+        "test_duration_seconds_bucket{kind=\"a\",le=\"+Inf\"} 4\n"
+        "test_duration_seconds_sum{kind=\"a\"} 1065\n"
+        "test_duration_seconds_count{kind=\"a\"} 4\n",
+        out.c_str());
+}
+
+void testRegistryGroupsFamilies() {
+    const auto sizeBefore = registry().size();
+    {
+        Counter a("test_family_total", "a family", "x=\"1\"");
+        Counter b("test_family_total", "a family", "x=\"2\"");
+        TEST_ASSERT_EQUAL(sizeBefore + 2, registry().size());
+
+        std::string out;
+        registry().render(out);
+        const std::string expected =
+            "# HELP test_family_total a family\n"
+            "# TYPE test_family_total counter\n"
+            "test_family_total{x=\"1\"} 0\n"
+            "test_family_total{x=\"2\"} 0\n";
+        TEST_ASSERT_TRUE(out.find(expected) != std::string::npos);
+    }
+    TEST_ASSERT_EQUAL(sizeBefore, registry().size());
+}
+
+}  // namespace test_metrics
+
+void runMetricsTests() {
+    RUN_TEST(test_metrics::testCounter);
+    RUN_TEST(test_metrics::testHistogramBuckets);
+    RUN_TEST(test_metrics::testRegistryGroupsFamilies);
+}
@@ -0,0 +1,85 @@
+#include <unity.h>
+
+#include "doser/motion-profile.h"
+
+namespace test_motion_profile {
+using namespace buff::doser;
+
+void testTrapezoidWithoutJerkLimit() {
+    // 1s up to speed, 1s cruising, 1s back down
+    auto profile = MotionProfile::plan(6400, {.maxSpeed = 3200, .accel = 3200, .decel = 3200});
+    TEST_ASSERT_FALSE(profile.empty());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 3.0, profile.durationS());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 3200, profile.peakSpeed());
+
+    TEST_ASSERT_FLOAT_WITHIN(1, 1600, profile.positionAt(1.0));
+    TEST_ASSERT_FLOAT_WITHIN(1, 3200, profile.speedAt(1.5));
+    TEST_ASSERT_FLOAT_WITHIN(1, 6400, profile.positionAt(3.0));
+}
+
+void testSCurveEasesInAndOut() {
+    const MotionLimits trapezoid = {.maxSpeed = 3200, .accel = 3200, .decel = 3200};
+    MotionLimits sCurve = trapezoid;
+    sCurve.jerk = 6400;
+
+    auto fast = MotionProfile::plan(12800, trapezoid);
+    auto smooth = MotionProfile::plan(12800, sCurve);
+    TEST_ASSERT_GREATER_THAN_FLOAT(fast.durationS(), smooth.durationS());
+    TEST_ASSERT_FLOAT_WITHIN(1, 12800, smooth.positionAt(smooth.durationS()));
+
+    // acceleration builds up, rather than starting at the limit
+    TEST_ASSERT_LESS_THAN_FLOAT(fast.speedAt(0.1) / 2, smooth.speedAt(0.1));
+
+    // speed moves smoothly & never overshoots
+    float lastSpeed = 0;
+    for (float t = 0; t <= smooth.durationS(); t += 0.01) {
+        const float speed = smooth.speedAt(t);
+        TEST_ASSERT_TRUE(speed <= 3200 + 1);
+        TEST_ASSERT_FLOAT_WITHIN(3200 * 0.01 + 1, lastSpeed, speed);
+        lastSpeed = speed;
+    }
+}
+
+void testShortMovePeaksLower() {
+    auto profile = MotionProfile::plan(400, {.maxSpeed = 3200, .accel = 3200, .decel = 3200, .jerk = 16000});
+    TEST_ASSERT_LESS_THAN_FLOAT(3200, profile.peakSpeed());
+    TEST_ASSERT_GREATER_THAN_FLOAT(0, profile.peakSpeed());
+    TEST_ASSERT_FLOAT_WITHIN(1, 400, profile.positionAt(profile.durationS()));
+}
+
+void testSlowerDeceleration() {
+    auto profile = MotionProfile::plan(6400, {.maxSpeed = 3200, .accel = 3200, .decel = 1600});
+    // 1s up, 2s down and 0.5s cruising for the rest
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 3.5, profile.durationS());
+    TEST_ASSERT_FLOAT_WITHIN(1, 3200, profile.speedAt(1.25));
+    TEST_ASSERT_FLOAT_WITHIN(1, 1600, profile.speedAt(2.5));
+}
+
+void testTimeAtFollowsPosition() {
+    auto profile = MotionProfile::plan(1000, {.maxSpeed = 3200, .accel = 3200, .decel = 3200, .jerk = 16000});
+    float last = 0;
+    for (int step = 1; step <= 1000; step++) {
+        const float t = profile.timeAt(step, last);
+        TEST_ASSERT_TRUE(t >= last);
+        TEST_ASSERT_FLOAT_WITHIN(0.05, step, profile.positionAt(t));
+        last = t;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, profile.durationS(), last);
+}
+
+void testRejectsImpossibleLimits() {
+    TEST_ASSERT_TRUE(MotionProfile::plan(0, {.maxSpeed = 3200, .accel = 3200, .decel = 3200}).empty());
+    TEST_ASSERT_TRUE(MotionProfile::plan(100, {.maxSpeed = 3200, .accel = 0, .decel = 3200}).empty());
+    TEST_ASSERT_TRUE(MotionProfile::plan(100, {.maxSpeed = 3200, .accel = 3200, .decel = 0}).empty());
+}
+
+}  // namespace test_motion_profile
+
+void runMotionProfileTests() {
+    RUN_TEST(test_motion_profile::testTrapezoidWithoutJerkLimit);
+    RUN_TEST(test_motion_profile::testSCurveEasesInAndOut);
+    RUN_TEST(test_motion_profile::testShortMovePeaksLower);
+    RUN_TEST(test_motion_profile::testSlowerDeceleration);
+    RUN_TEST(test_motion_profile::testTimeAtFollowsPosition);
+    RUN_TEST(test_motion_profile::testRejectsImpossibleLimits);
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "mqtt-dispatch.h"
+
+namespace test_mqtt_dispatch {
+using namespace richiev::mqtt;
+
+const Payload EMPTY = {.data = "", .length = 0};
+
+struct Recorder {
+    std::vector<std::string> calls;
+
+    PayloadHandler handler(const std::string& name) {
+        return [this, name](const Payload& payload) { calls.push_back(name + ":" + payload.str()); };
+    }
+};
+
+void testExactTopics() {
+    TopicDispatcher<> dispatcher;
+    Recorder recorder;
+    dispatcher.on("readings/ph", recorder.handler("ph"));
+    dispatcher.on("readings/alk", recorder.handler("alk"));
+
+    const char* body = R"({"x":1})";
+    TEST_ASSERT_EQUAL(1, dispatcher.dispatch("readings/alk", {.data = body, .length = strlen(body)}));
+    TEST_ASSERT_EQUAL(1, recorder.calls.size());
+    TEST_ASSERT_EQUAL_STRING(R"(alk:{"x":1})", recorder.calls[0].c_str());
+
+    // prefixes and extensions don't match
+    TEST_ASSERT_EQUAL(0, dispatcher.dispatch("readings", EMPTY));
+    TEST_ASSERT_EQUAL(0, dispatcher.dispatch("readings/ph/extra", EMPTY));
+    TEST_ASSERT_EQUAL(0, dispatcher.dispatch("readings/p", EMPTY));
+    TEST_ASSERT_EQUAL(2, dispatcher.filters().size());
+}
+
+void testWildcards() {
+    TopicDispatcher<> dispatcher;
+    Recorder recorder;
+    dispatcher.on("dosers/+/dose", recorder.handler("plus"));
+    dispatcher.on("dosers/#", recorder.handler("hash"));
+    dispatcher.on("dosers/fill/dose", recorder.handler("exact"));
+
+    TEST_ASSERT_EQUAL(3, dispatcher.dispatch("dosers/fill/dose", EMPTY));
+    TEST_ASSERT_EQUAL(2, dispatcher.dispatch("dosers/drain/dose", EMPTY));
+    // # also matches the parent level
+    TEST_ASSERT_EQUAL(1, dispatcher.dispatch("dosers", EMPTY));
+    TEST_ASSERT_EQUAL(1, dispatcher.dispatch("dosers/drain/dose/more", EMPTY));
+    TEST_ASSERT_EQUAL(0, dispatcher.dispatch("other/drain/dose", EMPTY));
+
+    // # only as the last segment
+    TEST_ASSERT_FALSE(dispatcher.on("bad/#/topic", recorder.handler("bad")));
+}
+
+void testMultipleHandlersAndGroups() {
+    TopicDispatcher<> dispatcher;
+    Recorder recorder;
+    const uint8_t debugGroup = 1;
+    dispatcher.on("debug/restart", recorder.handler("first"), debugGroup);
+    dispatcher.on("debug/restart", recorder.handler("second"));
+
+    TEST_ASSERT_EQUAL(2, dispatcher.dispatch("debug/restart", EMPTY));
+    TEST_ASSERT_EQUAL_STRING("first:", recorder.calls[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("second:", recorder.calls[1].c_str());
+    TEST_ASSERT_EQUAL(1, dispatcher.filters().size());
+
+    dispatcher.setGroupEnabled(debugGroup, false);
+    TEST_ASSERT_FALSE(dispatcher.isGroupEnabled(debugGroup));
+    TEST_ASSERT_EQUAL(1, dispatcher.dispatch("debug/restart", EMPTY));
+    TEST_ASSERT_EQUAL_STRING("second:", recorder.calls[2].c_str());
+}
+
+void testCapacity() {
+    TopicDispatcher<3, 2> dispatcher;
+    Recorder recorder;
+    TEST_ASSERT_TRUE(dispatcher.on("a/b", recorder.handler("1")));
+    // needs a 4th node
+    TEST_ASSERT_FALSE(dispatcher.on("c/d", recorder.handler("2")));
+    TEST_ASSERT_TRUE(dispatcher.on("a", recorder.handler("3")));
+    // out of handlers
+    TEST_ASSERT_FALSE(dispatcher.on("a", recorder.handler("4")));
+}
+
+void testMatchesFilter() {
+    TEST_ASSERT_TRUE(matchesFilter("readings/ph", "readings/ph"));
+    TEST_ASSERT_FALSE(matchesFilter("readings/ph", "readings/ph/msgpack"));
+    TEST_ASSERT_FALSE(matchesFilter("readings/ph/msgpack", "readings/ph"));
+    TEST_ASSERT_FALSE(matchesFilter("readings/ph", "readings/pH"));
+
+    TEST_ASSERT_TRUE(matchesFilter("readings/+", "readings/alk"));
+    TEST_ASSERT_FALSE(matchesFilter("readings/+", "readings/alk/msgpack"));
+    TEST_ASSERT_TRUE(matchesFilter("+/alk", "readings/alk"));
+
+    TEST_ASSERT_TRUE(matchesFilter("readings/#", "readings/ph/history"));
+    TEST_ASSERT_TRUE(matchesFilter("readings/#", "readings"));
+    TEST_ASSERT_FALSE(matchesFilter("readings/#", "execute/measure_alk"));
+    TEST_ASSERT_TRUE(matchesFilter("#", "anything/at/all"));
+}
+
+}  // namespace test_mqtt_dispatch
+
+void runMqttDispatchTests() {
+    RUN_TEST(test_mqtt_dispatch::testExactTopics);
+    RUN_TEST(test_mqtt_dispatch::testWildcards);
+    RUN_TEST(test_mqtt_dispatch::testMultipleHandlersAndGroups);
+    RUN_TEST(test_mqtt_dispatch::testCapacity);
+    RUN_TEST(test_mqtt_dispatch::testMatchesFilter);
+}
@@ -0,0 +1,121 @@
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "mqtt-outbox.h"
+
+namespace test_mqtt_outbox {
+using namespace richiev::mqtt;
+
+struct Published {
+    std::vector<std::string> topics;
+    std::vector<std::string> payloads;
+
+    PublishFunc func() {
+        return [this](const char* topic, const char* payload, size_t length) {
+            topics.push_back(topic);
+            payloads.push_back(std::string(payload, length));
+            return true;
+        };
+    }
+};
+
+void send(Outbox<2, 1, 64>& outbox, const char* topic, const std::string& payload) {
+    outbox.send(topic, payload.c_str(), payload.size());
+}
+
+void testSendIsFIFOAndDropsWhenFull() {
+    Outbox<2, 1, 64> outbox;
+    send(outbox, "a", "1");
+    send(outbox, "b", "2");
+    // full
+    send(outbox, "c", "3");
+    TEST_ASSERT_EQUAL(2, outbox.depth());
+    TEST_ASSERT_EQUAL(1, outbox.stats().dropped.load());
+    TEST_ASSERT_EQUAL(2, outbox.stats().highWater.load());
+
+    Published published;
+    TEST_ASSERT_EQUAL(2, outbox.drain(0, published.func()));
+    TEST_ASSERT_EQUAL_STRING("a", published.topics[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("2", published.payloads[1].c_str());
+    TEST_ASSERT_EQUAL(0, outbox.depth());
+    TEST_ASSERT_EQUAL(2, outbox.stats().published.load());
+
+    // too big to queue
+    std::string tooBig(MAX_QUEUED_PAYLOAD_LEN, 'x');
+    send(outbox, "a", tooBig);
+    TEST_ASSERT_EQUAL(2, outbox.stats().dropped.load());
+}
+
+void testCoalesceLatestWins() {
+    Outbox<2, 1, 64> outbox;
+    outbox.coalesce("ph", "8.1", 3);
+    outbox.coalesce("ph", "8.2", 3);
+    // no free slot for another topic
+    TEST_ASSERT_FALSE(outbox.coalesce("other", "1", 1));
+    TEST_ASSERT_EQUAL(1, outbox.stats().coalesced.load());
+
+    Published published;
+    TEST_ASSERT_EQUAL(1, outbox.drain(0, published.func()));
+    TEST_ASSERT_EQUAL_STRING("8.2", published.payloads[0].c_str());
+
+    // nothing pending anymore
+    TEST_ASSERT_EQUAL(0, outbox.drain(0, published.func()));
+}
+
+void testBatchedEnvelope() {
+    Outbox<2, 1, 64> outbox;
+    // not configured
+    TEST_ASSERT_FALSE(outbox.batch("1", 1));
+
+    outbox.setEnvelope("history", 1000);
+    outbox.batch("[1,2]", 5);
+    outbox.batch("[3,4]", 5);
+
+    Published published;
+    TEST_ASSERT_EQUAL(0, outbox.drain(999, published.func()));
+    TEST_ASSERT_EQUAL(1, outbox.drain(1000, published.func()));
+    TEST_ASSERT_EQUAL_STRING("history", published.topics[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("[[1,2],[3,4]]", published.payloads[0].c_str());
+
+    // empty envelopes aren't sent
+    TEST_ASSERT_EQUAL(0, outbox.drain(2000, published.func()));
+}
+
+void testPublishingDoesNotHoldTheLock() {
+    Outbox<2, 1, 64> outbox;
+    send(outbox, "a", "1");
+
+    // a producer enqueuing while the network is publishing mustn't wait on it
+    size_t calls = 0;
+    outbox.drain(0, [&](const char* topic, const char* payload, size_t length) {
+        calls++;
+        if (calls == 1) send(outbox, "b", "2");
+        return true;
+    });
+    TEST_ASSERT_EQUAL(2, calls);
+}
+
+void testInbox() {
+    Inbox<1> inbox;
+    TEST_ASSERT_TRUE(inbox.push("t", "{}", 2));
+    TEST_ASSERT_FALSE(inbox.push("t", "{}", 2));
+    TEST_ASSERT_EQUAL(1, inbox.dropped());
+
+    InboxMessage message;
+    TEST_ASSERT_TRUE(inbox.pop(message));
+    TEST_ASSERT_EQUAL_STRING("t", message.topic);
+    TEST_ASSERT_EQUAL_STRING("{}", message.payload);
+    TEST_ASSERT_FALSE(inbox.pop(message));
+}
+
+}  // namespace test_mqtt_outbox
+
+void runMqttOutboxTests() {
+    RUN_TEST(test_mqtt_outbox::testSendIsFIFOAndDropsWhenFull);
+    RUN_TEST(test_mqtt_outbox::testCoalesceLatestWins);
+    RUN_TEST(test_mqtt_outbox::testBatchedEnvelope);
+    RUN_TEST(test_mqtt_outbox::testPublishingDoesNotHoldTheLock);
+    RUN_TEST(test_mqtt_outbox::testInbox);
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+
+#include <ArduinoJson.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mqtt-publish.h"
+
+namespace test_mqtt_publish {
+using namespace buff;
+
+struct Published {
+    std::vector<std::string> topics;
+    std::vector<std::string> payloads;
+
+    richiev::mqtt::PublishFunc func() {
+        return [this](const char* topic, const char* payload, size_t length) {
+            topics.push_back(topic);
+            payloads.push_back(std::string(payload, length));
+            return true;
+        };
+    }
+
+    const std::string* payloadFor(const std::string& topic) const {
+        for (size_t i = 0; i < topics.size(); i++) {
+            if (topics[i] == topic) return &payloads[i];
+        }
+        return nullptr;
+    }
+};
+
+ph::PHReading buildPHReading() {
+    ph::PHReading reading;
+    reading.asOfMS = 123456;
+    reading.asOfAdjustedSec = 1700000000;
+    reading.rawPH = 8.13;
+    reading.rawPH_mavg = 8.11;
+    reading.calibratedPH = 8.21;
+    reading.calibratedPH_mavg = 8.19;
+    return reading;
+}
+
+Published publishPH(const mqtt::TelemetryEncoding encoding) {
+    auto outbox = std::make_shared<richiev::mqtt::DefaultOutbox>();
+    mqtt::MQTTPublisher publisher(outbox, encoding);
+    publisher.publishPH(buildPHReading());
+
+    Published published;
+    outbox->drain(0, published.func());
+    return published;
+}
+
+void testJSONByDefault() {
+    auto published = publishPH(mqtt::TelemetryEncoding::JSON);
+    TEST_ASSERT_NOT_NULL(published.payloadFor(mqtt::phRead));
+    TEST_ASSERT_NULL(published.payloadFor(mqtt::phReadMsgPack));
+}
+
+void testMsgPackMatchesJSON() {
+    auto published = publishPH(mqtt::TelemetryEncoding::JSON_AND_MSGPACK);
+    auto json = published.payloadFor(mqtt::phRead);
+    auto msgPack = published.payloadFor(mqtt::phReadMsgPack);
+    TEST_ASSERT_NOT_NULL(json);
+    TEST_ASSERT_NOT_NULL(msgPack);
+    TEST_ASSERT_LESS_THAN(json->size(), msgPack->size());
+
+    StaticJsonDocument<512> fromJSON;
+    StaticJsonDocument<512> fromMsgPack;
+    TEST_ASSERT_FALSE(deserializeJson(fromJSON, json->data(), json->size()));
+    TEST_ASSERT_FALSE(deserializeMsgPack(fromMsgPack, msgPack->data(), msgPack->size()));
+
+    TEST_ASSERT_EQUAL(fromJSON.size(), fromMsgPack.size());
+    TEST_ASSERT_EQUAL(123456, fromMsgPack["asOf"].as<unsigned long>());
+    TEST_ASSERT_EQUAL(1700000000, fromMsgPack["asOfAdjustedSec"].as<unsigned long>());
+    TEST_ASSERT_EQUAL_FLOAT(8.19, fromMsgPack["calibratedPH_mavg"].as<float>());
+    TEST_ASSERT_EQUAL_FLOAT(fromJSON["rawPH"].as<float>(), fromMsgPack["rawPH"].as<float>());
+}
+
+void testMsgPackOnly() {
+    auto published = publishPH(mqtt::TelemetryEncoding::MSGPACK);
+    TEST_ASSERT_NULL(published.payloadFor(mqtt::phRead));
+    TEST_ASSERT_NOT_NULL(published.payloadFor(mqtt::phReadMsgPack));
+}
+
+void testOversizedIsDroppedNotCutShort() {
+    auto outbox = std::make_shared<richiev::mqtt::DefaultOutbox>();
+    mqtt::MQTTPublisher publisher(outbox, mqtt::TelemetryEncoding::JSON_AND_MSGPACK);
+    const auto droppedBefore = metrics::oversizedMessagesDropped.value();
+
+    alk_measure::AlkReading reading;
+    reading.title = std::string(richiev::mqtt::MAX_QUEUED_PAYLOAD_LEN, 't');
+    publisher.publishAlkReading(reading);
+
+    Published published;
+    outbox->drain(0, published.func());
+    TEST_ASSERT_NULL(published.payloadFor(mqtt::alkRead));
+    TEST_ASSERT_NULL(published.payloadFor(mqtt::alkReadMsgPack));
+    TEST_ASSERT_EQUAL(droppedBefore + 2, metrics::oversizedMessagesDropped.value());
+}
+
+}  // namespace test_mqtt_publish
+
+void runMqttPublishTests() {
+    RUN_TEST(test_mqtt_publish::testJSONByDefault);
+    RUN_TEST(test_mqtt_publish::testMsgPackMatchesJSON);
+    RUN_TEST(test_mqtt_publish::testMsgPackOnly);
+    RUN_TEST(test_mqtt_publish::testOversizedIsDroppedNotCutShort);
+}
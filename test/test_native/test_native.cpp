@@ -2,6 +2,24 @@ extern void runPHTests();
 extern void runAlkMeasureTests();
 extern void runNumericTests();
 extern void runWebServerTests();
+extern void runMetricsTests();
+extern void runReadingExportTests();
+extern void runEventBusTests();
+extern void runMqttDispatchTests();
+extern void runCommandsTests();
+extern void runMqttOutboxTests();
+extern void runMqttPublishTests();
+extern void runRecordRingTests();
+extern void runSPSCQueueTests();
+extern void runSchedulerTests();
+extern void runProfilerTests();
+extern void runTimeTests();
+extern void runStepPulserTests();
+extern void runMotionProfileTests();
+extern void runStepRampTests();
+extern void runSimDoserTests();
+extern void runTitrationTests();
+extern void runMeasurementTraceTests();
 
 #include <unity.h>
 
@@ -20,5 +38,23 @@ int main(int argc, char **argv) {
     runNumericTests();
     runAlkMeasureTests();
     runWebServerTests();
+    runMetricsTests();
+    runReadingExportTests();
+    runEventBusTests();
+    runMqttDispatchTests();
+    runCommandsTests();
+    runMqttOutboxTests();
+    runMqttPublishTests();
+    runRecordRingTests();
+    runSPSCQueueTests();
+    runSchedulerTests();
+    runProfilerTests();
+    runTimeTests();
+    runStepPulserTests();
+    runMotionProfileTests();
+    runStepRampTests();
+    runSimDoserTests();
+    runTitrationTests();
+    runMeasurementTraceTests();
     return UNITY_END();
 }
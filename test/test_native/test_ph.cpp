@@ -1,3 +1,4 @@
+#include <Arduino.h>
 #include <unity.h>
 
 #include <vector>
@@ -8,8 +9,15 @@
 
 namespace test_ph {
 using namespace buff;
+using namespace fakeit;
+
+void stubs() {
+    // the reads are timed
+    When(Method(ArduinoFake(), micros)).AlwaysReturn(1000000);
+}
 
 void testPHReaderHelper() {
+    stubs();
     auto x = std::vector<float>({5.1, 4.9, 4.5});
     auto reader = *buildPHReader(x);
 
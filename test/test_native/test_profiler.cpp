@@ -0,0 +1,87 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <cstring>
+#include <string>
+
+#include "profiler.h"
+
+namespace test_profiler {
+using namespace fakeit;
+using namespace richiev::metrics;
+
+const uint32_t BUCKETS_US[] = {100, 1000, 10000};
+
+ProfiledSection fastSection("test_profiled_seconds", "test", "fast", BUCKETS_US, "section=\"fast\"");
+ProfiledSection slowSection("test_profiled_seconds", "test", "slow", BUCKETS_US, "section=\"slow\"");
+
+const char* currentContext = "idle";
+void describeContext(char* out, size_t size) {
+    strncpy(out, currentContext, size - 1);
+    out[size - 1] = 0;
+}
+
+void setup() {
+    When(Method(ArduinoFake(), millis)).AlwaysReturn(5000);
+    profileContext() = describeContext;
+    resetProfileWorstCases();
+}
+
+void testCapturesWorstCase() {
+    setup();
+    const uint32_t countBefore = fastSection.count();
+
+    currentContext = "MEASURE/DOSE";
+    fastSection.record(500);
+    currentContext = "idle";
+    // not a new worst, the context stays
+    fastSection.record(200);
+
+    TEST_ASSERT_EQUAL(countBefore + 2, fastSection.count());
+    const WorstCase worst = fastSection.worst();
+    TEST_ASSERT_EQUAL(500, worst.durationUS);
+    TEST_ASSERT_EQUAL(5000, worst.atMS);
+    TEST_ASSERT_EQUAL_STRING("MEASURE/DOSE", worst.context);
+
+    fastSection.resetWorst();
+    TEST_ASSERT_EQUAL(0, fastSection.worst().durationUS);
+    fastSection.record(200);
+    TEST_ASSERT_EQUAL_STRING("idle", fastSection.worst().context);
+}
+
+void testReport() {
+    setup();
+    currentContext = "CLEANUP/DOSE";
+    slowSection.record(20000);
+
+    std::string report;
+    renderProfileReport(report);
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, report.find("slow count="));
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, report.find("worst_us=20000 worst_at_ms=5000 context=CLEANUP/DOSE"));
+}
+
+void testNewStalls() {
+    setup();
+    // catch up on whatever's been recorded so far
+    forEachNewStall(0, [](const ProfiledSection&, const WorstCase&) {});
+
+    slowSection.record(50000);
+    fastSection.record(10);
+
+    std::string stalled;
+    forEachNewStall(1000, [&](const ProfiledSection& section, const WorstCase& worst) { stalled += section.section; });
+    TEST_ASSERT_EQUAL_STRING("slow", stalled.c_str());
+
+    // only reported once
+    stalled.clear();
+    forEachNewStall(1000, [&](const ProfiledSection& section, const WorstCase& worst) { stalled += section.section; });
+    TEST_ASSERT_EQUAL_STRING("", stalled.c_str());
+}
+
+}  // namespace test_profiler
+
+void runProfilerTests() {
+    RUN_TEST(test_profiler::testCapturesWorstCase);
+    RUN_TEST(test_profiler::testReport);
+    RUN_TEST(test_profiler::testNewStalls);
+}
@@ -0,0 +1,67 @@
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "readings/reading-export.h"
+#include "readings/reading-store.h"
+
+namespace test_reading_export {
+using namespace buff;
+
+std::vector<unsigned long> asOfsSince(const reading_store::ReadingStore &store, const unsigned long since) {
+    std::vector<unsigned long> asOfs;
+    store.forEachReadingSince(since, [&](const alk_measure::PersistedAlkReading &r) { asOfs.push_back(r.asOfAdjustedSec); });
+    return asOfs;
+}
+
+void testForEachReadingSinceIsOldestFirst() {
+    reading_store::ReadingStore store(3);
+    TEST_ASSERT_EQUAL(0, asOfsSince(store, 0).size());
+
+    store.addAlkReading({.asOfAdjustedSec = 100, .alkReadingDKH = 8.0, .title = "a"});
+    store.addAlkReading({.asOfAdjustedSec = 200, .alkReadingDKH = 8.1, .title = "b"});
+    auto asOfs = asOfsSince(store, 0);
+    TEST_ASSERT_EQUAL(2, asOfs.size());
+    TEST_ASSERT_EQUAL(100, asOfs[0]);
+    TEST_ASSERT_EQUAL(200, asOfs[1]);
+
+    // wraps the ring, dropping the oldest
+    store.addAlkReading({.asOfAdjustedSec = 300, .alkReadingDKH = 8.2, .title = "c"});
+    store.addAlkReading({.asOfAdjustedSec = 400, .alkReadingDKH = 8.3, .title = "d"});
+    asOfs = asOfsSince(store, 0);
+    TEST_ASSERT_EQUAL(3, asOfs.size());
+    TEST_ASSERT_EQUAL(200, asOfs[0]);
+    TEST_ASSERT_EQUAL(300, asOfs[1]);
+    TEST_ASSERT_EQUAL(400, asOfs[2]);
+
+    // since is exclusive
+    asOfs = asOfsSince(store, 300);
+    TEST_ASSERT_EQUAL(1, asOfs.size());
+    TEST_ASSERT_EQUAL(400, asOfs[0]);
+}
+
+void testCSVRow() {
+    std::string out;
+    reading_export::writeCSVHeader(out);
+    reading_export::writeCSVRow(out, {.asOfAdjustedSec = 1672531200, .alkReadingDKH = 7.9, .title = R"(say "hi", ok)"});
+    TEST_ASSERT_EQUAL_STRING("asOfAdjustedSec,alkReadingDKH,title\n1672531200,7.9,\"say \"\"hi\"\", ok\"\n", out.c_str());
+}
+
+void testNDJSONRow() {
+    std::string out;
+    reading_export::writeNDJSONRow(out, {.asOfAdjustedSec = 1672531200, .alkReadingDKH = 7.9, .title = "a\"b\\c\n"});
+    reading_export::writeNDJSONRow(out, {.asOfAdjustedSec = 1672531201, .alkReadingDKH = 8, .title = ""});
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"asOfAdjustedSec\":1672531200,\"alkReadingDKH\":7.9,\"title\":\"a\\\"b\\\\c\\n\"}\n"
+        "{\"asOfAdjustedSec\":1672531201,\"alkReadingDKH\":8.0,\"title\":\"\"}\n",
+        out.c_str());
+}
+
+}  // namespace test_reading_export
+
+void runReadingExportTests() {
+    RUN_TEST(test_reading_export::testForEachReadingSinceIsOldestFirst);
+    RUN_TEST(test_reading_export::testCSVRow);
+    RUN_TEST(test_reading_export::testNDJSONRow);
+}
@@ -0,0 +1,170 @@
+#include <unity.h>
+
+#include <cstring>
+#include <string>
+
+#include "record-ring.h"
+
+namespace test_record_ring {
+using namespace richiev::storage;
+
+const size_t SLOT_SIZE = 64;
+// room for 4 slots
+using Storage = MemoryStorage<sizeof(RingMeta) + 4 * SLOT_SIZE>;
+using Ring = RecordRing<Storage, SLOT_SIZE>;
+
+void push(Ring& ring, const char* topic, const char* payload) {
+    TEST_ASSERT_TRUE(ring.push(topic, payload, strlen(payload)));
+}
+
+std::string popPayload(Ring& ring, std::string* topicOut = nullptr) {
+    char topic[32];
+    char payload[64];
+    size_t length = 0;
+    TEST_ASSERT_TRUE(ring.peek(topic, sizeof(topic), payload, sizeof(payload), length));
+    TEST_ASSERT_TRUE(ring.pop());
+    if (topicOut != nullptr) *topicOut = topic;
+    return std::string(payload, length);
+}
+
+void testFIFO() {
+    Storage storage;
+    Ring ring(storage);
+    TEST_ASSERT_TRUE(ring.open());
+    TEST_ASSERT_EQUAL(4, ring.capacity());
+    TEST_ASSERT_TRUE(ring.empty());
+
+    push(ring, "readings/ph", "1");
+    push(ring, "readings/alk", "2");
+    TEST_ASSERT_EQUAL(2, ring.size());
+
+    std::string topic;
+    TEST_ASSERT_EQUAL_STRING("1", popPayload(ring, &topic).c_str());
+    TEST_ASSERT_EQUAL_STRING("readings/ph", topic.c_str());
+    TEST_ASSERT_EQUAL_STRING("2", popPayload(ring, &topic).c_str());
+    TEST_ASSERT_EQUAL_STRING("readings/alk", topic.c_str());
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_FALSE(ring.pop());
+}
+
+void testOverwritesOldestWhenFull() {
+    Storage storage;
+    Ring ring(storage);
+    ring.open();
+
+    const char* payloads[] = {"1", "2", "3", "4", "5", "6"};
+    for (auto payload : payloads) push(ring, "t", payload);
+    TEST_ASSERT_EQUAL(4, ring.size());
+    TEST_ASSERT_EQUAL(2, ring.overwritten());
+
+    TEST_ASSERT_EQUAL_STRING("3", popPayload(ring).c_str());
+    TEST_ASSERT_EQUAL_STRING("4", popPayload(ring).c_str());
+    TEST_ASSERT_EQUAL_STRING("5", popPayload(ring).c_str());
+    TEST_ASSERT_EQUAL_STRING("6", popPayload(ring).c_str());
+    TEST_ASSERT_TRUE(ring.empty());
+
+    // too big for a slot
+    std::string big(SLOT_SIZE, 'x');
+    TEST_ASSERT_FALSE(ring.push("t", big.c_str(), big.size()));
+}
+
+void testSurvivesReopening() {
+    Storage storage;
+    {
+        Ring ring(storage);
+        ring.open();
+        const char* payloads[] = {"1", "2", "3", "4", "5"};
+        for (auto payload : payloads) push(ring, "t", payload);
+        popPayload(ring);
+    }
+
+    // eg after a reboot
+    Ring ring(storage);
+    TEST_ASSERT_TRUE(ring.open());
+    TEST_ASSERT_EQUAL(3, ring.size());
+    TEST_ASSERT_EQUAL_STRING("3", popPayload(ring).c_str());
+
+    push(ring, "t", "6");
+    TEST_ASSERT_EQUAL_STRING("4", popPayload(ring).c_str());
+    TEST_ASSERT_EQUAL_STRING("5", popPayload(ring).c_str());
+    TEST_ASSERT_EQUAL_STRING("6", popPayload(ring).c_str());
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void testSkipsCorruptRecords() {
+    Storage storage;
+    Ring ring(storage);
+    ring.open();
+    push(ring, "t", "1");
+    push(ring, "t", "2");
+
+    // flip a payload byte of the first record (sequence 1, slot 1)
+    storage.data()[sizeof(RingMeta) + SLOT_SIZE + sizeof(RecordHeader) + 1] ^= 0xFF;
+
+    TEST_ASSERT_EQUAL_STRING("2", popPayload(ring).c_str());
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void testFormatsUnknownStorage() {
+    Storage storage;
+    memset(storage.data(), 0xAB, storage.size());
+    Ring ring(storage);
+    TEST_ASSERT_TRUE(ring.open());
+    TEST_ASSERT_TRUE(ring.empty());
+
+    MemoryStorage<8> tooSmall;
+    RecordRing<MemoryStorage<8>, SLOT_SIZE> tooSmallRing(tooSmall);
+    TEST_ASSERT_FALSE(tooSmallRing.open());
+}
+
+void testForEachLeavesRecords() {
+    Storage storage;
+    Ring ring(storage);
+    ring.open();
+    const char* payloads[] = {"1", "2", "3", "4", "5"};
+    for (auto payload : payloads) push(ring, "t", payload);
+    popPayload(ring);
+
+    std::string seen;
+    ring.forEach([&seen](const char* topic, size_t topicLength, const char* payload, size_t payloadLength) {
+        seen += std::string(topic, topicLength) + "=" + std::string(payload, payloadLength) + ",";
+    });
+    TEST_ASSERT_EQUAL_STRING("t=3,t=4,t=5,", seen.c_str());
+    TEST_ASSERT_EQUAL(3, ring.size());
+}
+
+void testReadRecordBySequence() {
+    Storage storage;
+    Ring ring(storage);
+    ring.open();
+    const char* payloads[] = {"1", "2", "3", "4"};
+    for (auto payload : payloads) push(ring, "t", payload);
+    TEST_ASSERT_EQUAL(1, ring.firstSequence());
+    TEST_ASSERT_EQUAL(5, ring.nextSequence());
+
+    std::string seen;
+    auto read = [&seen](const char* topic, size_t topicLength, const char* payload, size_t payloadLength) {
+        seen = std::string(payload, payloadLength);
+    };
+    TEST_ASSERT_TRUE(ring.readRecord(2, read));
+    TEST_ASSERT_EQUAL_STRING("2", seen.c_str());
+
+    // overwritten by 5, which is in the same slot
+    push(ring, "t", "5");
+    TEST_ASSERT_FALSE(ring.readRecord(1, read));
+    TEST_ASSERT_TRUE(ring.readRecord(5, read));
+    TEST_ASSERT_EQUAL_STRING("5", seen.c_str());
+    TEST_ASSERT_FALSE(ring.readRecord(6, read));
+}
+
+}  // namespace test_record_ring
+
+void runRecordRingTests() {
+    RUN_TEST(test_record_ring::testFIFO);
+    RUN_TEST(test_record_ring::testOverwritesOldestWhenFull);
+    RUN_TEST(test_record_ring::testSurvivesReopening);
+    RUN_TEST(test_record_ring::testSkipsCorruptRecords);
+    RUN_TEST(test_record_ring::testFormatsUnknownStorage);
+    RUN_TEST(test_record_ring::testForEachLeavesRecords);
+    RUN_TEST(test_record_ring::testReadRecordBySequence);
+}
@@ -0,0 +1,131 @@
+#include <unity.h>
+
+#include <string>
+
+#include "scheduler.h"
+
+namespace test_scheduler {
+using namespace richiev::scheduling;
+
+// virtual time, jobs "take" however long they advance it by
+unsigned long nowUS = 0;
+unsigned long virtualMicros() { return nowUS; }
+uint32_t nowMS() { return nowUS / 1000; }
+
+std::string ran;
+void jobA() { ran += "a"; }
+void jobB() { ran += "b"; }
+void slowJob() {
+    ran += "s";
+    nowUS += 30 * 1000;
+}
+
+void reset() {
+    nowUS = 0;
+    ran.clear();
+}
+
+// runs passes the way a task would, sleeping until the next deadline
+void runUntil(Scheduler<8, 16> &scheduler, const uint32_t untilMS) {
+    while (nowMS() <= untilMS) {
+        scheduler.runDue(nowMS());
+        const uint32_t sleepMS = scheduler.msUntilNextDeadline(nowMS());
+        nowUS += (sleepMS > 0 ? sleepMS : 1) * 1000;
+    }
+}
+
+const Job *findJob(const Scheduler<8, 16> &scheduler, const char *name) {
+    const Job *found = nullptr;
+    scheduler.forEachJob([&](const Job &job) {
+        if (std::string(job.name) == name) found = &job;
+    });
+    return found;
+}
+
+void testRunsInDeadlineOrder() {
+    reset();
+    Scheduler<8, 16> scheduler(virtualMicros);
+    scheduler.every("b", 10, jobB, 0, Pacing::FIXED_RATE, 5);
+    scheduler.every("a", 10, jobA);
+
+    runUntil(scheduler, 29);
+    TEST_ASSERT_EQUAL_STRING("ababab", ran.c_str());
+    TEST_ASSERT_EQUAL(3, findJob(scheduler, "a")->stats.runs);
+    // never ran late
+    TEST_ASSERT_EQUAL(0, findJob(scheduler, "b")->stats.maxLatenessMS);
+}
+
+void testSleepsUntilNextDeadline() {
+    reset();
+    Scheduler<8, 16> scheduler(virtualMicros);
+    scheduler.every("a", 100, jobA);
+    scheduler.every("b", 40, jobB);
+
+    scheduler.runDue(0);
+    TEST_ASSERT_EQUAL(40, scheduler.msUntilNextDeadline(0));
+    TEST_ASSERT_EQUAL(15, scheduler.msUntilNextDeadline(25));
+    TEST_ASSERT_EQUAL(0, scheduler.msUntilNextDeadline(41));
+    // capped
+    TEST_ASSERT_EQUAL(10, scheduler.msUntilNextDeadline(0, 10));
+}
+
+void testLongPeriodsWrapTheWheel() {
+    reset();
+    // period spans the 16 slot wheel several times
+    Scheduler<8, 16> scheduler(virtualMicros);
+    scheduler.every("a", 50, jobA);
+
+    runUntil(scheduler, 160);
+    TEST_ASSERT_EQUAL_STRING("aaaa", ran.c_str());
+    TEST_ASSERT_EQUAL(200, findJob(scheduler, "a")->deadlineMS);
+}
+
+void testBudgetsAndSkipping() {
+    reset();
+    Scheduler<8, 16> scheduler(virtualMicros);
+    // takes 30ms with a 10ms budget, every 10ms
+    scheduler.every("s", 10, slowJob, 10 * 1000);
+
+    runUntil(scheduler, 100);
+    const Job *job = findJob(scheduler, "s");
+    TEST_ASSERT_EQUAL(job->stats.runs, job->stats.overruns);
+    TEST_ASSERT_EQUAL(30 * 1000, job->stats.maxDurationUS);
+    // every run misses the following deadlines rather than running back to back
+    TEST_ASSERT_TRUE(job->stats.skipped >= 2 * (job->stats.runs - 1));
+    TEST_ASSERT_TRUE(job->stats.runs <= 4);
+}
+
+void testFixedDelay() {
+    reset();
+    Scheduler<8, 16> scheduler(virtualMicros);
+    scheduler.every("s", 10, slowJob, 0, Pacing::FIXED_DELAY);
+
+    scheduler.runDue(nowMS());
+    // finished at 30, so next is 40
+    TEST_ASSERT_EQUAL(40, findJob(scheduler, "s")->deadlineMS);
+    TEST_ASSERT_EQUAL(0, findJob(scheduler, "s")->stats.skipped);
+}
+
+void testCatchesUpAfterLongGaps() {
+    reset();
+    Scheduler<8, 16> scheduler(virtualMicros);
+    scheduler.every("a", 5, jobA);
+    scheduler.runDue(0);
+
+    // way past a whole revolution of the wheel
+    nowUS = 1000 * 1000;
+    TEST_ASSERT_EQUAL(1, scheduler.runDue(nowMS()));
+    TEST_ASSERT_EQUAL(1005, findJob(scheduler, "a")->deadlineMS);
+    TEST_ASSERT_EQUAL(995, findJob(scheduler, "a")->stats.maxLatenessMS);
+}
+
+}  // namespace test_scheduler
+
+void runSchedulerTests() {
+    RUN_TEST(test_scheduler::testRunsInDeadlineOrder);
+    RUN_TEST(test_scheduler::testSleepsUntilNextDeadline);
+    RUN_TEST(test_scheduler::testLongPeriodsWrapTheWheel);
+    RUN_TEST(test_scheduler::testBudgetsAndSkipping);
+    RUN_TEST(test_scheduler::testFixedDelay);
+    RUN_TEST(test_scheduler::testCatchesUpAfterLongGaps);
+}
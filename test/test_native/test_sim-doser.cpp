@@ -0,0 +1,106 @@
+#include <unity.h>
+
+#include <memory>
+
+#include "sim/sim-doser.h"
+#include "sim/virtual-clock.h"
+
+namespace test_sim_doser {
+using namespace buff;
+using namespace buff::sim;
+
+// 3200 steps a second, up to speed in a second
+const DoserConfig config = {.mlPerFullRotation = 0.2, .motorRPM = 60,
+                            //
+                            .microStepType = SIXTEENTH,
+                            .fullStepsPerRotation = 200};
+
+std::shared_ptr<SimulatedDoser> buildDoser(VirtualClock &clock) {
+    auto doser = std::make_shared<SimulatedDoser>(config, clock);
+    doser->calibrator = std::make_shared<doser::Calibrator>(config.mlPerFullRotation);
+    return doser;
+}
+
+void testVirtualClockOnlyMovesForward() {
+    VirtualClock clock;
+    clock.advanceMS(5);
+    TEST_ASSERT_EQUAL(5000, clock.nowUS());
+    clock.advanceToUS(1000);
+    TEST_ASSERT_EQUAL(5000, clock.nowUS());
+    clock.advanceToUS(7000);
+    TEST_ASSERT_EQUAL(7, clock.nowMS());
+}
+
+void testDoseTakesAsLongAsItsProfile() {
+    VirtualClock clock;
+    auto doser = buildDoser(clock);
+
+    // 5 rotations, 1s up to speed, 4s cruising & 1s to stop
+    doser->doseML(1.0);
+    TEST_ASSERT_EQUAL(1, doser->doses().size());
+    TEST_ASSERT_EQUAL(16000, doser->doses()[0].steps);
+    TEST_ASSERT_UINT32_WITHIN(1000, 6000000, doser->doses()[0].durationUS);
+    TEST_ASSERT_EQUAL(doser->doses()[0].durationUS, clock.nowUS());
+    TEST_ASSERT_EQUAL(16000, doser->totalSteps());
+}
+
+void testUsesTheGivenCalibration() {
+    VirtualClock clock;
+    auto doser = buildDoser(clock);
+
+    doser::Calibrator halfAsMuch(0.1);
+    doser->doseML(-1.0, &halfAsMuch);
+    TEST_ASSERT_EQUAL(-32000, doser->doses()[0].steps);
+    TEST_ASSERT_EQUAL(32000, doser->totalSteps());
+}
+
+void testQueuedDosesRunBackToBack() {
+    VirtualClock clock;
+    auto doser = buildDoser(clock);
+
+    doser->queueML(1.0);
+    doser->queueML(1.0);
+    TEST_ASSERT_EQUAL(0, clock.nowUS());
+    TEST_ASSERT_TRUE(doser->busy());
+
+    doser->waitUntilIdle();
+    TEST_ASSERT_FALSE(doser->busy());
+    TEST_ASSERT_EQUAL(doser->doses()[0].durationUS, doser->doses()[1].startedAtUS);
+    TEST_ASSERT_EQUAL(doser->totalDurationUS(), clock.nowUS());
+}
+
+void testDosersRunAlongsideEachOther() {
+    VirtualClock clock;
+    auto fill = buildDoser(clock);
+    auto reagent = buildDoser(clock);
+
+    fill->queueML(2.0);
+    reagent->queueML(0.5);
+    fill->waitUntilIdle();
+    reagent->waitUntilIdle();
+
+    // only as long as the longer of the two
+    TEST_ASSERT_EQUAL(fill->totalDurationUS(), clock.nowUS());
+    TEST_ASSERT_EQUAL(0, reagent->doses()[0].startedAtUS);
+}
+
+void testShortDosesAreSlowerPerStep() {
+    VirtualClock clock;
+    auto doser = buildDoser(clock);
+
+    const uint64_t shortUS = doser->durationUSFor(100);
+    const uint64_t longUS = doser->durationUSFor(10000);
+    TEST_ASSERT_GREATER_THAN(longUS / 100, shortUS);
+    TEST_ASSERT_EQUAL(0, doser->durationUSFor(0));
+}
+
+}  // namespace test_sim_doser
+
+void runSimDoserTests() {
+    RUN_TEST(test_sim_doser::testVirtualClockOnlyMovesForward);
+    RUN_TEST(test_sim_doser::testDoseTakesAsLongAsItsProfile);
+    RUN_TEST(test_sim_doser::testUsesTheGivenCalibration);
+    RUN_TEST(test_sim_doser::testQueuedDosesRunBackToBack);
+    RUN_TEST(test_sim_doser::testDosersRunAlongsideEachOther);
+    RUN_TEST(test_sim_doser::testShortDosesAreSlowerPerStep);
+}
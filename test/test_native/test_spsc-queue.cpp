@@ -0,0 +1,79 @@
+#include <unity.h>
+
+#include <string>
+#include <thread>
+
+#include "spsc-queue.h"
+
+namespace test_spsc_queue {
+using richiev::SPSCQueue;
+
+void testPushPop() {
+    SPSCQueue<int, 4> queue;
+    TEST_ASSERT_TRUE(queue.empty());
+    TEST_ASSERT_EQUAL(3, queue.capacity());
+
+    TEST_ASSERT_TRUE(queue.push(1));
+    TEST_ASSERT_TRUE(queue.push(2));
+    TEST_ASSERT_TRUE(queue.push(3));
+    // one slot is kept free
+    TEST_ASSERT_FALSE(queue.push(4));
+    TEST_ASSERT_EQUAL(3, queue.size());
+
+    int value = 0;
+    TEST_ASSERT_TRUE(queue.pop(value));
+    TEST_ASSERT_EQUAL(1, value);
+    TEST_ASSERT_TRUE(queue.push(4));
+
+    TEST_ASSERT_TRUE(queue.pop(value));
+    TEST_ASSERT_EQUAL(2, value);
+    TEST_ASSERT_TRUE(queue.pop(value));
+    TEST_ASSERT_EQUAL(3, value);
+    TEST_ASSERT_TRUE(queue.pop(value));
+    TEST_ASSERT_EQUAL(4, value);
+    TEST_ASSERT_FALSE(queue.pop(value));
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void testMovesValues() {
+    SPSCQueue<std::string, 2> queue;
+    TEST_ASSERT_TRUE(queue.push(std::string("a measurement title")));
+
+    std::string title;
+    TEST_ASSERT_TRUE(queue.pop(title));
+    TEST_ASSERT_EQUAL_STRING("a measurement title", title.c_str());
+}
+
+void testAcrossThreads() {
+    SPSCQueue<unsigned int, 16> queue;
+    const unsigned int COUNT = 100000;
+
+    std::thread producer([&]() {
+        for (unsigned int i = 0; i < COUNT;) {
+            if (queue.push(i)) i++;
+        }
+    });
+
+    // every value arrives, in order
+    unsigned int expected = 0;
+    bool inOrder = true;
+    while (expected < COUNT) {
+        unsigned int value;
+        if (queue.pop(value)) {
+            inOrder = inOrder && value == expected;
+            expected++;
+        }
+    }
+    producer.join();
+
+    TEST_ASSERT_TRUE(inOrder);
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+}  // namespace test_spsc_queue
+
+void runSPSCQueueTests() {
+    RUN_TEST(test_spsc_queue::testPushPop);
+    RUN_TEST(test_spsc_queue::testMovesValues);
+    RUN_TEST(test_spsc_queue::testAcrossThreads);
+}
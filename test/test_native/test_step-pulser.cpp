@@ -0,0 +1,140 @@
+#include <unity.h>
+
+#include <vector>
+
+#include "doser/step-pulser.h"
+
+namespace test_step_pulser {
+using namespace buff::doser;
+
+constexpr MotionLimits fast = {.maxSpeed = 3200, .accel = 3200, .decel = 3200};
+constexpr MotionLimits slow = {.maxSpeed = 1600, .accel = 1600, .decel = 1600};
+constexpr MotionLimits sCurve = {.maxSpeed = 3200, .accel = 3200, .decel = 1600, .jerk = 16000};
+
+constexpr auto fastRamp = STEP_RAMP_TABLE(fast);
+constexpr auto slowRamp = STEP_RAMP_TABLE(slow);
+constexpr auto sCurveRamp = STEP_RAMP_TABLE(sCurve);
+
+struct Pulse {
+    uint32_t atUS;
+    uint8_t channel;
+};
+
+// plays the pulser out the way the I2S callback would, until everything's stopped
+std::vector<Pulse> playOut(StepPulser &pulser, const uint32_t maxUS = 60 * 1000 * 1000) {
+    std::vector<Pulse> pulses;
+    uint32_t nowUS = 0;
+    while (pulser.anyRunning() && nowUS < maxUS) {
+        uint32_t gapUS = 0;
+        const uint8_t mask = pulser.next(gapUS);
+        for (uint8_t ch = 0; ch < MAX_STEP_CHANNELS; ch++) {
+            if (mask & (1 << ch)) pulses.push_back({nowUS, ch});
+        }
+        nowUS += gapUS;
+    }
+    return pulses;
+}
+
+std::vector<uint32_t> intervalsFor(const std::vector<Pulse> &pulses, const uint8_t channel) {
+    std::vector<uint32_t> intervals;
+    uint32_t lastUS = 0;
+    bool first = true;
+    for (const auto &pulse : pulses) {
+        if (pulse.channel != channel) continue;
+        if (!first) intervals.push_back(pulse.atUS - lastUS);
+        lastUS = pulse.atUS;
+        first = false;
+    }
+    return intervals;
+}
+
+void testIssuesExactlyTheRequestedSteps() {
+    StepPulser pulser;
+    TEST_ASSERT_TRUE(pulser.start(0, 1000, fastRamp.ramp()));
+    TEST_ASSERT_TRUE(pulser.running(0));
+
+    auto pulses = playOut(pulser);
+    TEST_ASSERT_EQUAL(1000, pulses.size());
+    TEST_ASSERT_FALSE(pulser.running(0));
+}
+
+void testRampsUpCruisesAndRampsDown() {
+    StepPulser pulser;
+    // long enough to reach full speed (3200 steps/s, 1600 steps to get there)
+    pulser.start(1, 8000, fastRamp.ramp());
+    auto intervals = intervalsFor(playOut(pulser), 1);
+    TEST_ASSERT_EQUAL(7999, intervals.size());
+
+    const uint32_t cruiseUS = 1000000 / 3200;
+    // starts slow
+    TEST_ASSERT_GREATER_THAN(10 * cruiseUS, intervals.front());
+    // never faster than max speed (give or take a microsecond of rounding)
+    for (auto interval : intervals) {
+        TEST_ASSERT_GREATER_OR_EQUAL(cruiseUS - 1, interval);
+    }
+    // cruises in the middle
+    TEST_ASSERT_UINT32_WITHIN(1, cruiseUS, intervals[intervals.size() / 2]);
+    // and slows back down to stop
+    TEST_ASSERT_GREATER_THAN(10 * cruiseUS, intervals.back());
+}
+
+void testShortMoveNeverReachesFullSpeed() {
+    StepPulser pulser;
+    pulser.start(0, 100, fastRamp.ramp());
+    auto intervals = intervalsFor(playOut(pulser), 0);
+    TEST_ASSERT_EQUAL(99, intervals.size());
+    for (auto interval : intervals) {
+        TEST_ASSERT_GREATER_THAN(1000000 / 3200, interval);
+    }
+}
+
+void testRunsChannelsConcurrently() {
+    StepPulser pulser;
+    pulser.start(0, 500, fastRamp.ramp());
+    pulser.start(2, 300, slowRamp.ramp());
+    // can't restart a running channel
+    TEST_ASSERT_FALSE(pulser.start(0, 10, fastRamp.ramp()));
+
+    auto pulses = playOut(pulser);
+    TEST_ASSERT_EQUAL(500, intervalsFor(pulses, 0).size() + 1);
+    TEST_ASSERT_EQUAL(300, intervalsFor(pulses, 2).size() + 1);
+    TEST_ASSERT_EQUAL(0, intervalsFor(pulses, 1).size());
+}
+
+void testJerkLimitedMoveStillIssuesEveryStep() {
+    StepPulser pulser;
+    pulser.start(0, 4000, sCurveRamp.ramp());
+    auto intervals = intervalsFor(playOut(pulser), 0);
+    TEST_ASSERT_EQUAL(3999, intervals.size());
+
+    const uint32_t cruiseUS = 1000000 / 3200;
+    for (auto interval : intervals) {
+        TEST_ASSERT_GREATER_OR_EQUAL(cruiseUS - 1, interval);
+    }
+    // eases in rather than starting at the accel limit
+    TEST_ASSERT_GREATER_THAN(intervals[1], intervals.front());
+}
+
+void testRejectsBadMoves() {
+    StepPulser pulser;
+    TEST_ASSERT_FALSE(pulser.start(MAX_STEP_CHANNELS, 10, fastRamp.ramp()));
+    TEST_ASSERT_FALSE(pulser.start(0, 0, fastRamp.ramp()));
+    TEST_ASSERT_FALSE(pulser.start(0, 10, StepRamp{}));
+    TEST_ASSERT_FALSE(pulser.anyRunning());
+
+    // idles along at the idle gap
+    uint32_t gapUS = 0;
+    TEST_ASSERT_EQUAL(0, pulser.next(gapUS));
+    TEST_ASSERT_EQUAL(PULSER_IDLE_GAP_US, gapUS);
+}
+
+}  // namespace test_step_pulser
+
+void runStepPulserTests() {
+    RUN_TEST(test_step_pulser::testIssuesExactlyTheRequestedSteps);
+    RUN_TEST(test_step_pulser::testRampsUpCruisesAndRampsDown);
+    RUN_TEST(test_step_pulser::testShortMoveNeverReachesFullSpeed);
+    RUN_TEST(test_step_pulser::testRunsChannelsConcurrently);
+    RUN_TEST(test_step_pulser::testJerkLimitedMoveStillIssuesEveryStep);
+    RUN_TEST(test_step_pulser::testRejectsBadMoves);
+}
@@ -0,0 +1,72 @@
+#include <unity.h>
+
+#include "doser/step-ramp.h"
+
+namespace test_step_ramp {
+using namespace buff;
+using namespace buff::doser;
+
+constexpr DoserConfig config = {.mlPerFullRotation = 0.2, .motorRPM = 60,
+                                //
+                                .microStepType = SIXTEENTH,
+                                .fullStepsPerRotation = 200,
+                                .accelRPMPerSec = 60,
+                                .decelRPMPerSec = 30};
+constexpr auto limits = motionLimitsFor(config);
+constexpr auto table = STEP_RAMP_TABLE(limits);
+
+// all worked out by the compiler
+static_assert(limits.maxSpeed == 3200);
+static_assert(accelRampSteps(limits) == 1600);
+static_assert(decelRampSteps(limits) == 3200);
+
+void testRampTakesAsLongAsTheProfile() {
+    const auto ramp = table.ramp();
+    uint32_t totalTicks = 0;
+    for (size_t i = 0; i < ramp.accelSteps; i++) {
+        totalTicks += ramp.accelTicks[i];
+    }
+    // 1s to get up to speed, give or take the rounding
+    TEST_ASSERT_UINT32_WITHIN(2000 / STEP_RAMP_TICK_US, 1000000 / STEP_RAMP_TICK_US, totalTicks);
+    TEST_ASSERT_EQUAL(1000000 / 3200 / STEP_RAMP_TICK_US, ramp.cruiseTicks);
+}
+
+void testRampsOnlyEverSpeedUp() {
+    const auto ramp = table.ramp();
+    for (size_t i = 1; i < ramp.decelSteps; i++) {
+        TEST_ASSERT_TRUE(ramp.decelTicks[i] <= ramp.decelTicks[i - 1]);
+        TEST_ASSERT_TRUE(ramp.decelTicks[i] >= ramp.cruiseTicks);
+    }
+}
+
+void testLongMoveRampsCruisesAndStops() {
+    const auto ramp = table.ramp();
+    const uint32_t steps = 10000;
+    TEST_ASSERT_EQUAL(ramp.accelTicks[0], ramp.ticksBefore(0, steps));
+    TEST_ASSERT_EQUAL(ramp.cruiseTicks, ramp.ticksBefore(5000, steps - 5000));
+    // the slower stop takes over at the end
+    TEST_ASSERT_EQUAL(ramp.decelTicks[0], ramp.ticksBefore(steps - 1, 1));
+}
+
+void testShortMoveTurnsAroundEarly() {
+    const auto ramp = table.ramp();
+    const uint32_t steps = 400;
+    uint32_t fastest = UINT32_MAX;
+    uint32_t last = 0;
+    for (uint32_t stepped = 0; stepped < steps; stepped++) {
+        const uint32_t ticks = ramp.ticksBefore(stepped, steps - stepped);
+        if (ticks < fastest) fastest = ticks;
+        last = ticks;
+    }
+    TEST_ASSERT_GREATER_THAN(ramp.cruiseTicks, fastest);
+    TEST_ASSERT_EQUAL(ramp.decelTicks[0], last);
+}
+
+}  // namespace test_step_ramp
+
+void runStepRampTests() {
+    RUN_TEST(test_step_ramp::testRampTakesAsLongAsTheProfile);
+    RUN_TEST(test_step_ramp::testRampsOnlyEverSpeedUp);
+    RUN_TEST(test_step_ramp::testLongMoveRampsCruisesAndStops);
+    RUN_TEST(test_step_ramp::testShortMoveTurnsAroundEarly);
+}
@@ -0,0 +1,84 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "time-common.h"
+
+namespace test_time {
+using namespace fakeit;
+using namespace buff::buff_time;
+
+void testExtendsAcrossMillisWrap() {
+    WrapExtender extender;
+    TEST_ASSERT_EQUAL_UINT64(1000, extender.extend(1000));
+    // read at least every ~24 days, as anything on a scheduled job is
+    TEST_ASSERT_EQUAL_UINT64(0x7FFFFFFFull, extender.extend(0x7FFFFFFF));
+    TEST_ASSERT_EQUAL_UINT64(0xFFFFFF00ull, extender.extend(0xFFFFFF00));
+
+    // millis wrapped, the extended clock keeps counting
+    TEST_ASSERT_EQUAL_UINT64(0x100000010ull, extender.extend(0x10));
+    TEST_ASSERT_EQUAL_UINT64(0x100001000ull, extender.extend(0x1000));
+}
+
+void testNeverGoesBackwards() {
+    WrapExtender extender;
+    extender.extend(5000);
+    // a stale reading from another task isn't mistaken for a wrap
+    TEST_ASSERT_EQUAL_UINT64(5000, extender.extend(4990));
+    TEST_ASSERT_EQUAL_UINT64(5010, extender.extend(5010));
+}
+
+void testEpochBeforeAndAfterSync() {
+    TimeService service;
+    // unsynced, it's just time since boot
+    TEST_ASSERT_FALSE(service.synced());
+    TEST_ASSERT_EQUAL_UINT64(2000, service.epochMSAt(2000));
+    TEST_ASSERT_EQUAL_UINT64(0, service.msSinceSync(2000));
+
+    service.setEpoch(1700000000000ull, 3000);
+    TEST_ASSERT_TRUE(service.synced());
+    TEST_ASSERT_EQUAL_UINT32(1, service.syncs());
+    TEST_ASSERT_EQUAL_UINT64(1700000002000ull, service.epochMSAt(5000));
+    TEST_ASSERT_EQUAL_UINT64(2000, service.msSinceSync(5000));
+
+    // still maps correctly well past where millis() would have wrapped
+    const uint64_t fiftyDaysMS = 50ull * 24 * 60 * 60 * 1000;
+    TEST_ASSERT_EQUAL_UINT64(1700000000000ull - 3000 + fiftyDaysMS, service.epochMSAt(fiftyDaysMS));
+}
+
+void testResyncMovesTheMapping() {
+    TimeService service;
+    service.setEpoch(1700000000000ull, 1000);
+    // the clock drifted 250ms fast
+    service.setEpoch(1700000060000ull, 61250);
+    TEST_ASSERT_EQUAL_UINT32(2, service.syncs());
+    TEST_ASSERT_EQUAL_UINT64(1700000060000ull, service.epochMSAt(61250));
+}
+
+void testWrapperWithoutServiceUsesMillis() {
+    When(Method(ArduinoFake(), millis)).AlwaysReturn(1234);
+    TimeWrapper wrapper;
+    TEST_ASSERT_EQUAL(1234, wrapper.getAdjustedTimeSeconds());
+}
+
+void testWrapperReportsEpochSeconds() {
+    When(Method(ArduinoFake(), millis)).AlwaysReturn(5000);
+    TimeService service;
+    TimeWrapper wrapper(service);
+    // the monotonic clock never goes backwards, so it may be past 5000 if
+    // an earlier test faked a later millis
+    const uint64_t nowMS = service.monotonicMS();
+    service.setEpoch(1700000000000ull, nowMS);
+    TEST_ASSERT_EQUAL_UINT64(1700000000000ull, service.epochMSAt(nowMS));
+    TEST_ASSERT_EQUAL_UINT32(1700000000, wrapper.getAdjustedTimeSeconds());
+}
+
+}  // namespace test_time
+
+void runTimeTests() {
+    RUN_TEST(test_time::testExtendsAcrossMillisWrap);
+    RUN_TEST(test_time::testNeverGoesBackwards);
+    RUN_TEST(test_time::testEpochBeforeAndAfterSync);
+    RUN_TEST(test_time::testResyncMovesTheMapping);
+    RUN_TEST(test_time::testWrapperWithoutServiceUsesMillis);
+    RUN_TEST(test_time::testWrapperReportsEpochSeconds);
+}
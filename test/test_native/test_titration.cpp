@@ -0,0 +1,148 @@
+#include <unity.h>
+
+#include "sim/sim-doser.h"
+#include "sim/titration.h"
+#include "sim/virtual-clock.h"
+
+namespace test_titration {
+using namespace buff;
+using namespace buff::sim;
+
+// what alk-measure works the result out with
+float dkhFor(const float reagentML, const float sampleML, const float strengthMoles) {
+    return reagentML / sampleML * 280.0 * (strengthMoles / 0.1);
+}
+
+// the reagent needed to take a sample down to the endpoint, a step at a time
+float titrate(TitrationSample &sample, const float stepML = 0.05, const float endpointPH = 4.5) {
+    float reagentML = 0;
+    while (sample.pH() > endpointPH && reagentML < 50) {
+        sample.addReagent(stepML);
+        reagentML += stepML;
+    }
+    return reagentML;
+}
+
+void testStartsAtTheConfiguredPH() {
+    TitrationSample sample({.alkalinityDKH = 8.0, .initialPH = 8.2});
+    sample.addTankWater(200);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 8.2, sample.pH());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 200, sample.volumeML());
+}
+
+void testEndpointGivesBackTheAlkalinity() {
+    for (float dkh : {6.0f, 8.0f, 11.0f}) {
+        TitrationSample sample({.alkalinityDKH = dkh});
+        sample.addTankWater(200);
+        const float reagentML = titrate(sample);
+        // a touch low, some bicarbonate is left at 4.5
+        TEST_ASSERT_FLOAT_WITHIN(0.4, dkh, dkhFor(reagentML, 200, 0.1));
+    }
+}
+
+void testDropsSharplyAroundTheEndpoint() {
+    TitrationSample sample({.alkalinityDKH = 8.0});
+    sample.addTankWater(200);
+
+    // buffered most of the way, where the same dose moves it a little
+    sample.addReagent(3.0);
+    TEST_ASSERT_GREATER_THAN_FLOAT(5.5, sample.pH());
+    float before = sample.pH();
+    sample.addReagent(0.5);
+    const float buffered = before - sample.pH();
+
+    // and a lot around the endpoint
+    sample.addReagent(2.0);
+    before = sample.pH();
+    sample.addReagent(0.5);
+    const float endpoint = before - sample.pH();
+    TEST_ASSERT_GREATER_THAN_FLOAT(2 * buffered, endpoint);
+}
+
+void testRemovingKeepsTheChemistry() {
+    TitrationSample sample({.alkalinityDKH = 8.0});
+    sample.addTankWater(200);
+    sample.addReagent(2.0);
+    const float pH = sample.pH();
+
+    sample.remove(100);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 102, sample.volumeML());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, pH, sample.pH());
+
+    sample.remove(500);
+    TEST_ASSERT_EQUAL_FLOAT(0, sample.volumeML());
+}
+
+void testFollowsTheSimulatedDosers() {
+    VirtualClock clock;
+    const DoserConfig config = {.mlPerFullRotation = 0.2, .motorRPM = 60, .microStepType = SIXTEENTH};
+    SimulatedDoser fill(config, clock);
+    SimulatedDoser reagent(config, clock);
+    SimulatedDoser drain(config, clock);
+    for (auto doser : {&fill, &reagent, &drain}) {
+        doser->calibrator = std::make_shared<doser::Calibrator>(config.mlPerFullRotation);
+    }
+
+    TitrationSample sample({.alkalinityDKH = 8.0});
+    sample.connect(fill, MeasurementDoserType::FILL);
+    sample.connect(reagent, MeasurementDoserType::REAGENT);
+    sample.connect(drain, MeasurementDoserType::DRAIN);
+
+    fill.doseML(200);
+    reagent.doseML(1);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 201, sample.volumeML());
+    // stirring doesn't take anything out
+    drain.doseML(-1);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 201, sample.volumeML());
+    drain.doseML(250);
+    TEST_ASSERT_EQUAL_FLOAT(0, sample.volumeML());
+}
+
+void testProbeLagsBehindChanges() {
+    VirtualClock clock;
+    TitrationSample sample({.alkalinityDKH = 8.0});
+    sample.addTankWater(200);
+    SimulatedPHProbe probe(sample, clock, {.lagS = 5.0, .noisePH = 0});
+
+    const float start = probe.read();
+    TEST_ASSERT_FLOAT_WITHIN(0.001, sample.pH(), start);
+
+    sample.addReagent(5.6);
+    const float target = sample.pH();
+    // one time constant in, ~63% of the way there
+    clock.advanceMS(5000);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, start + (target - start) * 0.632, probe.read());
+    // and settled after a good while
+    clock.advanceMS(60000);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, target, probe.read());
+}
+
+void testProbeNoiseIsRepeatable() {
+    VirtualClock clock;
+    TitrationSample sample({.alkalinityDKH = 8.0});
+    sample.addTankWater(200);
+    SimulatedPHProbe a(sample, clock, {.lagS = 0, .noisePH = 0.01, .seed = 42});
+    SimulatedPHProbe b(sample, clock, {.lagS = 0, .noisePH = 0.01, .seed = 42});
+
+    bool anyNoise = false;
+    for (int i = 0; i < 20; i++) {
+        const float reading = a.read();
+        const float same = b.read();
+        TEST_ASSERT_EQUAL_FLOAT(reading, same);
+        TEST_ASSERT_FLOAT_WITHIN(0.06, sample.pH(), reading);
+        if (fabsf(reading - sample.pH()) > 1e-4) anyNoise = true;
+    }
+    TEST_ASSERT_TRUE(anyNoise);
+}
+
+}  // namespace test_titration
+
+void runTitrationTests() {
+    RUN_TEST(test_titration::testStartsAtTheConfiguredPH);
+    RUN_TEST(test_titration::testEndpointGivesBackTheAlkalinity);
+    RUN_TEST(test_titration::testDropsSharplyAroundTheEndpoint);
+    RUN_TEST(test_titration::testRemovingKeepsTheChemistry);
+    RUN_TEST(test_titration::testFollowsTheSimulatedDosers);
+    RUN_TEST(test_titration::testProbeLagsBehindChanges);
+    RUN_TEST(test_titration::testProbeNoiseIsRepeatable);
+}
@@ -1,5 +1,6 @@
 #include <unity.h>
 
+#include <chrono>
 #include <functional>
 #include <string>
 #include <vector>
@@ -8,6 +9,177 @@
 
 namespace web_server {
 using namespace buff;
+using buff::web_server::TriggerVal;
+
+// The snprintf based renderers this replaced, kept as a correctness and
+// performance baseline.
+namespace legacy {
+static std::string renderTime(char *temp, size_t bufferSize, const unsigned long timeInSec) {
+    // millis to time
+    const time_t rawtime = (time_t)timeInSec;
+    struct tm *dt = gmtime(&rawtime);
+
+    // format
+    strftime(temp, bufferSize, "%Y-%m-%d %H:%M:%S", dt);
+    return temp;
+}
+
+static std::string renderTriggerForm(char *temp, size_t bufferSize, const unsigned long renderTimeSec, const std::string &mostRecentTitle, const std::set<std::string> &recentTitles) {
+    std::string titleText;
+    if (recentTitles.size() > 0) {
+        titleText += R"(<span class="intro">Recent:</span>)";
+    }
+    int i = 0;
+    for (auto title : recentTitles) {
+        const char *title_template = R"(<li class="list-inline-item"><a href="#" data-title="%s" class="populate-title">%s</a></li>)";
+        snprintf(temp, bufferSize, title_template, title.c_str(), title.c_str());
+        titleText += temp;
+        i++;
+        if (i > 3) break;
+    }
+
+    std::string formTemplate = R"(
+      <section class="row">
+        <ul class="list-inline">
+          %s
+        </ul>
+
+        <form class="measurement-form form-inline row row-cols-lg-auto align-items-center" action="/execute/measure_alk" method="post">
+          <input type="hidden" name="asOf" id="asOf" value="%lu"/>
+
+          <div class="col-12 form-floating">
+            <input class="form-control" type="text" name="title" id="title" value="%s" />
+            <label for="title">Title</label>
+          </div>
+
+          <div class="col-12">
+            <button class="btn btn-primary" type="submit">Start a Measurement</button>
+          </div>
+        </form>
+      </section>
+    )";
+
+    snprintf(temp, bufferSize, formTemplate.c_str(), titleText.c_str(), renderTimeSec, mostRecentTitle.c_str());
+    return temp;
+}
+
+static std::string renderMeasurementList(char *temp, size_t bufferSize, const std::vector<std::reference_wrapper<alk_measure::PersistedAlkReading>> &mostRecentReadings) {
+    std::string measurementString = R"(<section class="row mt-3"><div class="col"><table class="table table-striped">)";
+    const auto alkMeasureTemplate = R"(
+      <tr class="measurement">
+        <td class="asOf converted-time" data-epoch-sec="%lu">%s</td>
+        <td class="title">%s</td>
+        <td class="alkReadingDKH">%.1f</td>
+      </tr>
+    )";
+    // <td class="actions">
+    //   <ul class="list-inline">
+    //     <li class="list-inline-item">
+    //       <button class="btn btn-danger btn-sm rounded-0" type="button" data-toggle="tooltip" data-placement="top" title="Delete"><i class="fa fa-trash"></i></button>
+    //     </li>
+    //   </ul>
+    // </td>
+
+    for (auto &measurementRef : mostRecentReadings) {
+        auto &measurement = measurementRef.get();
+        if (measurement.alkReadingDKH != 0) {
+            snprintf(temp, bufferSize, alkMeasureTemplate,
+                     measurement.asOfAdjustedSec,
+                     renderTime(temp, bufferSize, measurement.asOfAdjustedSec).c_str(),
+                     measurement.title.c_str(), measurement.alkReadingDKH);
+            measurementString += temp;
+        }
+    }
+    measurementString += "</table></div></section>";
+    return measurementString;
+}
+
+static std::string renderHeader(char *temp, size_t bufferSize, const ph::PHReading &reading) {
+    const auto headerTemplate = R"(<header class="navbar">
+    <div><a href="/" class="navbar-brand">Buff</a></div>
+    <div class="navbar-text">pH: %.1f</div>
+  </header>)";
+
+    snprintf(temp, bufferSize,
+             headerTemplate,
+             reading.calibratedPH_mavg);
+    return temp;
+}
+
+static std::string renderFooter(char *temp, size_t bufferSize, const unsigned long renderTimeSec, const unsigned long uptimeMS) {
+    const auto footerTemplate = R"(
+        <footer class="row">
+          <div class="col">
+            Current time:
+            <span class="converted-time" data-epoch-sec="%lu">
+              %s
+            </span>, Uptime: %02d:%02d:%02d
+          </div>
+        </footer>)";
+
+    int millisSec = uptimeMS / 1000;
+    int millisMin = millisSec / 60;
+    int millisHr = millisMin / 60;
+
+    snprintf(temp, bufferSize,
+             footerTemplate,
+             renderTimeSec,
+             renderTime(temp, bufferSize, renderTimeSec).c_str(),
+             millisHr, millisMin % 60, millisSec % 60);
+    return temp;
+}
+
+static std::string renderAlerts(char *temp, size_t bufferSize, const unsigned long currentElapsedMeasurementTimeMS, const TriggerVal &triggered) {
+    std::string alertContent = "";
+    if (triggered == TriggerVal::SUCCESS) {
+        alertContent = R"(<section class="alert alert-success">Successfully triggered a measurement!</section>)";
+    } else if (triggered == TriggerVal::FAIL) {
+        alertContent = R"(<section class="alert alert-warning">Failed to trigger a measurement!</section>)";
+    }
+
+    if (currentElapsedMeasurementTimeMS != 0) {
+        const std::string measuringTemplate = R"(<section class="alert alert-primary">Currently measuring (for %us)</section>)";
+        snprintf(temp, bufferSize, measuringTemplate.c_str(), (unsigned int)(currentElapsedMeasurementTimeMS / 1000));
+        alertContent += temp;
+    }
+    return alertContent;
+}
+
+static void renderRoot(std::string &out, const unsigned long currentElapsedMeasurementTimeMS, const TriggerVal &triggered, const unsigned long renderTimeSec, const unsigned long uptimeMS, const std::vector<std::reference_wrapper<alk_measure::PersistedAlkReading>> &mostRecentReadings, const std::set<std::string> &recentTitles, const ph::PHReading &phReading) {
+    const size_t bufferSize = 2048;
+    char temp[bufferSize];
+    memset(temp, 0, bufferSize);
+
+    std::string mostRecentTitle = "";
+    if (mostRecentReadings.size() > 0) {
+        mostRecentTitle = mostRecentReadings.front().get().title;
+    }
+
+    out += R"(
+<!doctype html>
+<html lang="en">
+  <head>
+    <title>Buff</title>
+    <link rel="stylesheet" href="/static/app.css?v=)" WEB_ASSETS_VERSION R"(" />
+    <script src="/static/app.js?v=)" WEB_ASSETS_VERSION R"(" defer></script>
+    <meta name="viewport" content="width=device-width, initial-scale=1, maximum-scale=1, user-scalable=no">
+    <meta charset="utf-8">
+  </head>
+  <body>
+    <div class="container-fluid">
+    )";
+    out += renderHeader(temp, bufferSize, phReading);
+    out += renderAlerts(temp, bufferSize, currentElapsedMeasurementTimeMS, triggered);
+    out += renderTriggerForm(temp, bufferSize, renderTimeSec, mostRecentTitle, recentTitles);
+    out += renderMeasurementList(temp, bufferSize, mostRecentReadings);
+    out += renderFooter(temp, bufferSize, renderTimeSec, uptimeMS);
+    out += R"(
+      </div>
+  </body>
+</html>
+    )";
+}
+}  // namespace legacy
 
 #include <iostream>
 void TEST_CONTAINS_SUBSTRING(const std::string &expected, const std::string &actual) {
@@ -27,8 +199,93 @@ void testFormDefaultsToLatestTitle() {
     TEST_CONTAINS_SUBSTRING(R"(value="first")", out);
 }
 
+void testTitlesAreEscaped() {
+    auto readings = std::vector<std::reference_wrapper<alk_measure::PersistedAlkReading>>();
+    alk_measure::PersistedAlkReading reading = {.asOfAdjustedSec = 1, .alkReadingDKH = 8.1, .title = R"(<b>"hi"</b>)"};
+    readings.push_back(reading);
+    std::string out;
+    ph::PHReading phReading;
+    std::set<std::string> recentTitles = {reading.title};
+    ::buff::web_server::renderRoot(out, 0, buff::web_server::TriggerVal::NA, 1111, 2222, readings, recentTitles, phReading);
+    TEST_ASSERT_EQUAL(std::string::npos, out.find("<b>"));
+    TEST_CONTAINS_SUBSTRING("&lt;b&gt;&quot;hi&quot;&lt;/b&gt;", out);
+}
+
+void testTypedWriters() {
+    using namespace richiev::templates;
+    static constexpr auto t = RV_TEMPLATE("{}|{}|{}|{}|{}");
+    std::string out;
+    render(out, t, EpochTime(951782400ul), Padded(7, 3), Fixed(8.25, 1), -12, Escaped("a&b"));
+    TEST_ASSERT_EQUAL_STRING("2000-02-29 00:00:00|007|8.2|-12|a&amp;b", out.c_str());
+}
+
+struct BenchmarkData {
+    std::vector<alk_measure::PersistedAlkReading> storage;
+    std::vector<std::reference_wrapper<alk_measure::PersistedAlkReading>> readings;
+    std::set<std::string> recentTitles;
+    ph::PHReading phReading = {};
+
+    BenchmarkData() {
+        // a full reading store
+        storage.reserve(80);
+        for (int i = 0; i < 80; i++) {
+            storage.push_back({.asOfAdjustedSec = 1672531200ul + i * 3600, .alkReadingDKH = 7.5f + (i % 10) / 10.0f, .title = "reading " + std::to_string(i)});
+        }
+        for (auto &r : storage) {
+            readings.push_back(r);
+        }
+        recentTitles = {"morning", "evening", "after water change", "reading 79"};
+        phReading.calibratedPH_mavg = 8.23;
+    }
+};
+
+void testMatchesLegacyOutput() {
+    BenchmarkData data;
+    std::string current;
+    std::string baseline;
+    for (auto triggered : {TriggerVal::NA, TriggerVal::SUCCESS, TriggerVal::FAIL}) {
+        current.clear();
+        baseline.clear();
+        ::buff::web_server::renderRoot(current, 61000, triggered, 1672531200ul, 3723000, data.readings, data.recentTitles, data.phReading);
+        legacy::renderRoot(baseline, 61000, triggered, 1672531200ul, 3723000, data.readings, data.recentTitles, data.phReading);
+        TEST_ASSERT_EQUAL_STRING(baseline.c_str(), current.c_str());
+    }
+}
+
+template <typename F>
+double timeRendersUS(const int iterations, F &&renderFunc) {
+    std::string out;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        out.clear();
+        renderFunc(out);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+void benchmarkRenderRoot() {
+    BenchmarkData data;
+    const int iterations = 500;
+
+    const double currentUS = timeRendersUS(iterations, [&](std::string &out) {
+        ::buff::web_server::renderRoot(out, 61000, TriggerVal::NA, 1672531200ul, 3723000, data.readings, data.recentTitles, data.phReading);
+    });
+    const double baselineUS = timeRendersUS(iterations, [&](std::string &out) {
+        legacy::renderRoot(out, 61000, TriggerVal::NA, 1672531200ul, 3723000, data.readings, data.recentTitles, data.phReading);
+    });
+
+    char message[128];
+    snprintf(message, sizeof(message), "renderRoot (80 readings): %.1fus, snprintf baseline: %.1fus (%.2fx)", currentUS, baselineUS, baselineUS / currentUS);
+    TEST_MESSAGE(message);
+}
+
 }  // namespace web_server
 
 void runWebServerTests() {
     RUN_TEST(web_server::testFormDefaultsToLatestTitle);
+    RUN_TEST(web_server::testTitlesAreEscaped);
+    RUN_TEST(web_server::testTypedWriters);
+    RUN_TEST(web_server::testMatchesLegacyOutput);
+    RUN_TEST(web_server::benchmarkRenderRoot);
 }
@@ -0,0 +1,32 @@
+// Behaviour for the Buff pages. Plain JS so the page doesn't need jQuery or
+// luxon to be pulled from a CDN.
+(function () {
+  function pad(value) {
+    return value < 10 ? "0" + value : "" + value;
+  }
+
+  // Converts a Date into the browser's local time, eg 2023-05-01 13:01:02
+  function formatLocalTime(date) {
+    return date.getFullYear() + "-" + pad(date.getMonth() + 1) + "-" + pad(date.getDate()) +
+      " " + pad(date.getHours()) + ":" + pad(date.getMinutes()) + ":" + pad(date.getSeconds());
+  }
+
+  document.querySelectorAll(".converted-time").forEach(function (item) {
+    var epochSec = parseInt(item.dataset.epochSec, 10);
+    if (!isNaN(epochSec)) {
+      item.textContent = formatLocalTime(new Date(epochSec * 1000));
+    }
+  });
+
+  function selectTitle(event) {
+    event.preventDefault();
+    var titleInput = document.querySelector('.measurement-form input[id="title"]');
+    if (titleInput) {
+      titleInput.value = this.dataset.title;
+    }
+  }
+
+  document.querySelectorAll(".populate-title").forEach(function (link) {
+    link.addEventListener("click", selectTitle);
+  });
+})();